@@ -0,0 +1,503 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "drawing3d.h"
+
+// reproducible synthetic workloads rendered headlessly into an image buffer,
+// a headless window and through the svg and png exporters, the results are
+// written as json
+
+#define PI 3.14159265358979323846
+#define BENCH_SEED 0x5eed3d3d5eed3d3dULL
+
+typedef struct {
+	int width;
+	int height;
+	int frames;
+	double scale;
+	render_quality_t quality;
+	const char *tmpdir;
+	uint64_t rng;
+	camera_t *camera;
+	window_t *window;
+	uint8_t *buffer;
+	draw_list_t *draw_list;
+	// number of primitives and vertices rendered per frame
+	size_t primitives;
+	size_t vertices;
+	size_t instances;
+} bench_t;
+
+typedef struct {
+	const char *name;
+	int (*build)(bench_t *bench);
+	int (*frame)(bench_t *bench);
+} bench_scene_t;
+
+static double _bench_now()
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// splitmix64, uniform in [-1, 1)
+static double _bench_random(bench_t *bench)
+{
+	uint64_t z = (bench->rng += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	z ^= z >> 31;
+	return (z >> 11) * 0x1.0p-52 - 1.0;
+}
+
+static size_t _bench_count(bench_t *bench, size_t num)
+{
+	size_t count = (size_t)(num * bench->scale);
+	return count > 0 ? count : 1;
+}
+
+static int _bench_style(bench_t *bench, double r, double g, double b,
+			double width)
+{
+	bench->primitives++;
+	return draw_list_style2(bench->draw_list, r, g, b, 1.0, width);
+}
+
+static int _bench_background(bench_t *bench)
+{
+	if (_bench_style(bench, 1.0, 1.0, 1.0, 1.0))
+		return 1;
+	bench->primitives++;
+	return draw_list_clear(bench->draw_list);
+}
+
+static int _bench_points(bench_t *bench)
+{
+	size_t num = _bench_count(bench, 1000000);
+	double *points = malloc(num * 3 * sizeof(double));
+	if (points == NULL)
+		return 1;
+	for (size_t i = 0; i < num * 3; i++)
+		points[i] = _bench_random(bench);
+	int ret = _bench_background(bench) ||
+		  _bench_style(bench, 0.0, 0.0, 1.0, 2.0) ||
+		  draw_list_points(bench->draw_list, num, points);
+	free(points);
+	bench->primitives += num;
+	bench->vertices += num;
+	return ret;
+}
+
+static int _bench_lines_n(bench_t *bench, size_t num)
+{
+	double *lines = malloc(num * 6 * sizeof(double));
+	if (lines == NULL)
+		return 1;
+	for (size_t i = 0; i < num; i++) {
+		double *line = &lines[i * 6];
+		for (int j = 0; j < 3; j++) {
+			line[j] = _bench_random(bench);
+			line[j + 3] = line[j] + 0.1 * _bench_random(bench);
+		}
+	}
+	int ret = _bench_background(bench) ||
+		  _bench_style(bench, 1.0, 0.0, 0.0, 1.0) ||
+		  draw_list_lines(bench->draw_list, num, lines);
+	free(lines);
+	bench->primitives += num;
+	bench->vertices += num * 2;
+	return ret;
+}
+
+static int _bench_lines(bench_t *bench)
+{
+	return _bench_lines_n(bench, _bench_count(bench, 100000));
+}
+
+static int _bench_lines_export(bench_t *bench)
+{
+	return _bench_lines_n(bench, _bench_count(bench, 10000));
+}
+
+static int _bench_polylines(bench_t *bench)
+{
+	size_t num = _bench_count(bench, 100);
+	size_t length = 10000;
+	double *points = malloc(length * 3 * sizeof(double));
+	if (points == NULL)
+		return 1;
+	if (_bench_background(bench) ||
+	    _bench_style(bench, 0.0, 0.5, 0.0, 1.0))
+		goto error;
+	for (size_t i = 0; i < num; i++) {
+		// random walk starting inside the unit cube
+		for (int j = 0; j < 3; j++)
+			points[j] = _bench_random(bench);
+		for (size_t k = 3; k < length * 3; k++)
+			points[k] = points[k - 3] + 0.01 * _bench_random(bench);
+		if (draw_list_polyline(bench->draw_list, length, points))
+			goto error;
+	}
+	free(points);
+	bench->primitives += num;
+	bench->vertices += num * length;
+	return 0;
+error:
+	free(points);
+	return 1;
+}
+
+static int _bench_tracks(bench_t *bench)
+{
+	// many short random walks ingested as one multi-polyline
+	size_t num = _bench_count(bench, 20000);
+	size_t length = 10;
+	double *points = malloc(num * length * 3 * sizeof(double));
+	int *offsets = malloc((num + 1) * sizeof(int));
+	if (points == NULL || offsets == NULL)
+		goto error;
+	if (_bench_background(bench) ||
+	    _bench_style(bench, 0.5, 0.0, 0.5, 1.0))
+		goto error;
+	for (size_t i = 0; i < num; i++) {
+		double *p = points + i * length * 3;
+		offsets[i] = i * length;
+		for (int j = 0; j < 3; j++)
+			p[j] = _bench_random(bench);
+		for (size_t k = 3; k < length * 3; k++)
+			p[k] = p[k - 3] + 0.02 * _bench_random(bench);
+	}
+	offsets[num] = num * length;
+	if (draw_list_polylines(bench->draw_list, num, offsets, points))
+		goto error;
+	free(points);
+	free(offsets);
+	bench->primitives += 1;
+	bench->vertices += num * length;
+	return 0;
+error:
+	free(points);
+	free(offsets);
+	return 1;
+}
+
+static int _bench_polygons(bench_t *bench)
+{
+	size_t num = _bench_count(bench, 100000);
+	if (_bench_background(bench) ||
+	    _bench_style(bench, 0.5, 0.5, 0.0, 1.0))
+		return 1;
+	for (size_t i = 0; i < num; i++) {
+		double c[3], quad[4][3];
+		for (int j = 0; j < 3; j++)
+			c[j] = _bench_random(bench);
+		for (int k = 0; k < 4; k++) {
+			double a = k * PI / 2.0;
+			quad[k][0] = c[0] + 0.01 * cos(a);
+			quad[k][1] = c[1] + 0.01 * sin(a);
+			quad[k][2] = c[2];
+		}
+		if (draw_list_polygon(bench->draw_list, 4, (double *)quad))
+			return 1;
+	}
+	bench->primitives += num;
+	bench->vertices += num * 4;
+	return 0;
+}
+
+static int _bench_styles(bench_t *bench)
+{
+	size_t num = _bench_count(bench, 100000);
+	if (_bench_background(bench))
+		return 1;
+	for (size_t i = 0; i < num; i++) {
+		double p[3];
+		for (int j = 0; j < 3; j++)
+			p[j] = _bench_random(bench);
+		double r = (_bench_random(bench) + 1.0) / 2.0;
+		if (_bench_style(bench, r, 1.0 - r, 0.5, 1.0 + r) ||
+		    draw_list_line(bench->draw_list, p[0], p[1], p[2],
+				   p[0] + 0.05, p[1] + 0.05, p[2]))
+			return 1;
+	}
+	bench->primitives += num;
+	bench->vertices += num * 2;
+	return 0;
+}
+
+static int _bench_instanced(bench_t *bench)
+{
+	// a small wireframe sphere drawn at many poses
+	bench->instances = _bench_count(bench, 1000);
+	if (_bench_style(bench, 0.0, 0.0, 0.0, 1.0))
+		return 1;
+	int rings = 8, segments = 16;
+	for (int i = 0; i < rings; i++) {
+		double ring[17][3];
+		double phi = PI * (i + 0.5) / rings;
+		for (int j = 0; j <= segments; j++) {
+			double theta = 2.0 * PI * j / segments;
+			ring[j][0] = 0.05 * sin(phi) * cos(theta);
+			ring[j][1] = 0.05 * sin(phi) * sin(theta);
+			ring[j][2] = 0.05 * cos(phi);
+		}
+		if (draw_list_polyline(bench->draw_list, segments + 1,
+				       (double *)ring))
+			return 1;
+	}
+	bench->primitives += rings;
+	bench->vertices += rings * (segments + 1);
+	return 0;
+}
+
+static int _bench_frame_buffer(bench_t *bench)
+{
+	return draw_list_save_buffer(bench->draw_list, bench->buffer,
+				     bench->camera);
+}
+
+static int _bench_frame_instanced(bench_t *bench)
+{
+	// the full interactive frame loop on a headless window
+	uint64_t rng = bench->rng;
+	int ret = window_clear(bench->window);
+	for (size_t i = 0; i < bench->instances && !ret; i++) {
+		double x = _bench_random(bench), y = _bench_random(bench);
+		double z = _bench_random(bench), r = _bench_random(bench) * PI;
+		ret = window_render_at(bench->window, bench->draw_list, x, y,
+				       z, r, r, 0.0);
+	}
+	// the same poses every frame
+	bench->rng = rng;
+	return ret || window_render_end(bench->window);
+}
+
+static int _bench_frame_export(bench_t *bench, const char *extension)
+{
+	char filename[4096];
+	snprintf(filename, sizeof(filename), "%s/drawing3d-bench-%ld.%s",
+		 bench->tmpdir, (long)getpid(), extension);
+	int ret = strcmp(extension, "svg") == 0 ?
+			  draw_list_save_svg(bench->draw_list, filename,
+					     bench->camera) :
+			  draw_list_save_png(bench->draw_list, filename,
+					     bench->camera);
+	remove(filename);
+	return ret;
+}
+
+static int _bench_frame_svg(bench_t *bench)
+{
+	return _bench_frame_export(bench, "svg");
+}
+
+static int _bench_frame_png(bench_t *bench)
+{
+	return _bench_frame_export(bench, "png");
+}
+
+static const bench_scene_t scenes[] = {
+	{ "points", _bench_points, _bench_frame_buffer },
+	{ "lines", _bench_lines, _bench_frame_buffer },
+	{ "polylines", _bench_polylines, _bench_frame_buffer },
+	{ "tracks", _bench_tracks, _bench_frame_buffer },
+	{ "polygons", _bench_polygons, _bench_frame_buffer },
+	{ "styles", _bench_styles, _bench_frame_buffer },
+	{ "instanced", _bench_instanced, _bench_frame_instanced },
+	{ "svg", _bench_lines_export, _bench_frame_svg },
+	{ "png", _bench_lines_export, _bench_frame_png },
+};
+
+static int _bench_compare(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+// nearest rank percentile of sorted values
+static double _bench_percentile(double *values, int num, double p)
+{
+	int rank = (int)ceil(p / 100.0 * num);
+	return values[rank > 0 ? rank - 1 : 0];
+}
+
+static int _bench_run(bench_t *bench, const bench_scene_t *scene, FILE *out,
+		      bool first)
+{
+	bench->rng = BENCH_SEED;
+	bench->primitives = 0;
+	bench->vertices = 0;
+	bench->instances = 1;
+	draw_list_empty(bench->draw_list);
+
+	double start = _bench_now();
+	if (scene->build(bench))
+		return 1;
+	double build = _bench_now() - start;
+
+	// one warm up frame, then the measured ones
+	if (scene->frame(bench))
+		return 1;
+	double *times = malloc(bench->frames * sizeof(double));
+	if (times == NULL)
+		return 1;
+	double total = 0.0;
+	for (int i = 0; i < bench->frames; i++) {
+		start = _bench_now();
+		if (scene->frame(bench)) {
+			free(times);
+			return 1;
+		}
+		times[i] = _bench_now() - start;
+		total += times[i];
+	}
+	qsort(times, bench->frames, sizeof(double), _bench_compare);
+
+	double primitives = (double)bench->primitives * bench->instances;
+	double vertices = (double)bench->vertices * bench->instances;
+	fprintf(out, "%s\n    {\n", first ? "" : ",");
+	fprintf(out, "      \"name\": \"%s\",\n", scene->name);
+	fprintf(out, "      \"primitives\": %.0f,\n", primitives);
+	fprintf(out, "      \"vertices\": %.0f,\n", vertices);
+	fprintf(out, "      \"build_ms\": %.3f,\n", build * 1e3);
+	fprintf(out, "      \"ms_per_frame\": {\n");
+	fprintf(out, "        \"min\": %.3f,\n", times[0] * 1e3);
+	fprintf(out, "        \"mean\": %.3f,\n", total / bench->frames * 1e3);
+	fprintf(out, "        \"p50\": %.3f,\n",
+		_bench_percentile(times, bench->frames, 50.0) * 1e3);
+	fprintf(out, "        \"p90\": %.3f,\n",
+		_bench_percentile(times, bench->frames, 90.0) * 1e3);
+	fprintf(out, "        \"p99\": %.3f,\n",
+		_bench_percentile(times, bench->frames, 99.0) * 1e3);
+	fprintf(out, "        \"max\": %.3f\n",
+		times[bench->frames - 1] * 1e3);
+	fprintf(out, "      },\n");
+	fprintf(out, "      \"primitives_per_s\": %.0f,\n",
+		primitives * bench->frames / total);
+	fprintf(out, "      \"vertices_per_s\": %.0f\n",
+		vertices * bench->frames / total);
+	fprintf(out, "    }");
+	free(times);
+	return 0;
+}
+
+static void _bench_usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [-n frames] [-s scale] [-W width] [-H height]\n"
+		"          [-q quality] [-r scene] [-t tmpdir]\n"
+		"          [-o output.json]\n",
+		name);
+}
+
+int main(int argc, char **argv)
+{
+	bench_t bench = {
+		.width = 800,
+		.height = 600,
+		.frames = 20,
+		.scale = 1.0,
+		.tmpdir = "/tmp",
+	};
+	const char *only = NULL;
+	const char *output = NULL;
+	int opt;
+	while ((opt = getopt(argc, argv, "n:s:W:H:q:r:t:o:")) != -1) {
+		switch (opt) {
+		case 'n':
+			bench.frames = atoi(optarg);
+			break;
+		case 's':
+			bench.scale = atof(optarg);
+			break;
+		case 'W':
+			bench.width = atoi(optarg);
+			break;
+		case 'H':
+			bench.height = atoi(optarg);
+			break;
+		case 'q':
+			bench.quality = atoi(optarg);
+			break;
+		case 'r':
+			only = optarg;
+			break;
+		case 't':
+			bench.tmpdir = optarg;
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		default:
+			_bench_usage(argv[0]);
+			return 1;
+		}
+	}
+	if (bench.frames < 1 || bench.scale <= 0.0 || bench.width < 1 ||
+	    bench.height < 1 || bench.quality < RENDER_QUALITY_FULL ||
+	    bench.quality > RENDER_QUALITY_DIRECT) {
+		_bench_usage(argv[0]);
+		return 1;
+	}
+
+	FILE *out = output != NULL ? fopen(output, "w") : stdout;
+	if (out == NULL) {
+		fprintf(stderr, "could not open %s\n", output);
+		return 1;
+	}
+	double state[CAMERA_STATE_LEN];
+	bench.camera = camera_create();
+	camera_viewport_set(bench.camera, bench.width, bench.height);
+	camera_perspective(bench.camera, PI / 4.0, PI / 4.0);
+	camera_distance_set(bench.camera, 4.0);
+	camera_rotation_set(bench.camera, 0.3, 0.5, 0.0);
+	bench.window = window_create2(bench.width, bench.height, "bench",
+				      WINDOW_BACKEND_HEADLESS);
+	if (bench.window == NULL) {
+		fprintf(stderr, "could not create a headless window\n");
+		return 1;
+	}
+	camera_state_get(bench.camera, state);
+	camera_state_set(window_camera_get(bench.window), state);
+	bench.buffer = malloc((size_t)bench.width * bench.height * 4);
+	bench.draw_list = draw_list_create();
+	draw_list_quality_set(bench.draw_list, bench.quality);
+
+	int ret = 0;
+	bool first = true;
+	fprintf(out, "{\n");
+	fprintf(out, "  \"width\": %d,\n", bench.width);
+	fprintf(out, "  \"height\": %d,\n", bench.height);
+	fprintf(out, "  \"frames\": %d,\n", bench.frames);
+	fprintf(out, "  \"scale\": %g,\n", bench.scale);
+	fprintf(out, "  \"quality\": %d,\n", bench.quality);
+	fprintf(out, "  \"scenes\": [");
+	for (size_t i = 0; i < sizeof(scenes) / sizeof(scenes[0]); i++) {
+		if (only != NULL && strcmp(only, scenes[i].name) != 0)
+			continue;
+		fprintf(stderr, "bench: %s\n", scenes[i].name);
+		if (_bench_run(&bench, &scenes[i], out, first)) {
+			fprintf(stderr, "bench: %s failed\n", scenes[i].name);
+			ret = 1;
+			break;
+		}
+		first = false;
+	}
+	fprintf(out, "\n  ]\n}\n");
+
+	if (out != stdout)
+		fclose(out);
+	draw_list_destroy(bench.draw_list);
+	free(bench.buffer);
+	window_destroy(bench.window);
+	camera_destroy(bench.camera);
+	return ret;
+}
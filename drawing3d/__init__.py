@@ -1,8 +1,13 @@
 from .camera import Camera
 from .drawlist import DrawList
-from .eventlist import EventList
+from .recorder import Recorder, Player
+from .stream import StreamServer, StreamClient
+from .eventlist import EventList, EventScript
 from .window import Window
+from .scheduler import Scheduler
+from .pointcloud import PointCloud
 from .simple3d import Simple3D
+from .simd import get_isa, set_isa, isa_supported
 
 try:
     from .version import version as __version__
@@ -21,6 +21,7 @@ ldflags += get_output(["pkg-config", "--libs", "cairo"]).split()
 # check platform to emit fpic or equivalent
 if "linux" in get_output(["uname", "-s"]).lower():
     cflags.append("-fPIC")
+    ldflags.append("-lrt")
 
 ffibuilder.set_source(
     "drawing3d._drawing3d",
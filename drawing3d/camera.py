@@ -1,5 +1,6 @@
 from ._drawing3d import ffi, lib
-from .helpers import buffer_from
+import numpy as np
+from .helpers import buffer_from, points_from_np
 
 
 class Camera:
@@ -126,10 +127,36 @@ class Camera:
         m = buffer_from("double[]", m)
         lib.camera_projection_set(self.obj, m)
 
+    @property
+    def state(self):
+        state = ffi.new("double[]", lib.CAMERA_STATE_LEN)
+        lib.camera_state_get(self.obj, state)
+        return [state[i] for i in range(lib.CAMERA_STATE_LEN)]
+
+    @state.setter
+    def state(self, state):
+        state = buffer_from("double[]", state)
+        lib.camera_state_set(self.obj, state)
+
     def project(self, p1, p2):
         p1 = buffer_from("double[]", p1)
         p2 = buffer_from("double[]", p2)
         return lib.camera_project(self.obj, p1, p2)
 
+    def project_points(self, points):
+        num, points = points_from_np(points)
+        q = np.empty((num, 2), dtype=np.double)
+        depth = np.empty(num, dtype=np.double)
+        visible = np.empty(num, dtype=np.bool_)
+        lib.camera_project_points(
+            self.obj,
+            num,
+            points,
+            ffi.from_buffer("double[]", q),
+            ffi.from_buffer("double[]", depth),
+            ffi.from_buffer("bool[]", visible),
+        )
+        return q, depth, visible
+
     def update(self):
         return lib.camera_update(self.obj)
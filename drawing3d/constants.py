@@ -12,4 +12,29 @@ KEY_ACTION_RY_DEC = (1 << 9)
 KEY_ACTION_RZ_INC = (1 << 10)
 KEY_ACTION_RZ_DEC = (1 << 11)
 KEY_ACTION_DISTANCE_INC = (1 << 12)
-KEY_ACTION_DISTANCE_DEC = (1 << 13) 
+KEY_ACTION_DISTANCE_DEC = (1 << 13)
+
+# names of the frame_stats_t timers and counters, in enum order
+STATS_TIMERS = (
+    "frame",
+    "camera_update",
+    "occluders",
+    "sort",
+    "line",
+    "point",
+    "polygon",
+    "polyline",
+    "style",
+    "clear",
+    "procedural",
+    "window_clear",
+    "upload",
+    "present",
+)
+STATS_COUNTERS = (
+    "primitives",
+    "vertices",
+    "culled",
+    "strokes",
+    "fills",
+)
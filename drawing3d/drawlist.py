@@ -17,6 +17,85 @@ class DrawList:
     def load(self):
         return lib.draw_list_load(self.obj)
 
+    def clone(self):
+        obj = lib.draw_list_clone(self.obj)
+        if obj == ffi.NULL:
+            raise MemoryError("could not clone the draw list")
+        return DrawList(obj)
+
+    def restore(self, snapshot):
+        return lib.draw_list_restore(self.obj, snapshot.obj)
+
+    def checkpoint(self, name):
+        if lib.draw_list_checkpoint_push(self.obj, name.encode()):
+            raise MemoryError("could not create the checkpoint")
+
+    def rewind(self, name):
+        if lib.draw_list_checkpoint_rewind(self.obj, name.encode()):
+            raise KeyError(name)
+
+    def drop(self, name):
+        if lib.draw_list_checkpoint_drop(self.obj, name.encode()):
+            raise KeyError(name)
+
+    @property
+    def checkpoints(self):
+        num = lib.draw_list_checkpoint_count(self.obj)
+        return [
+            ffi.string(lib.draw_list_checkpoint_name(self.obj, i)).decode()
+            for i in range(num)
+        ]
+
+    @property
+    def depth_sort(self):
+        return bool(lib.draw_list_depth_sort_get(self.obj))
+
+    @depth_sort.setter
+    def depth_sort(self, depth_sort):
+        lib.draw_list_depth_sort_set(self.obj, bool(depth_sort))
+
+    @property
+    def occlusion(self):
+        return bool(lib.draw_list_occlusion_get(self.obj))
+
+    @occlusion.setter
+    def occlusion(self, occlusion):
+        lib.draw_list_occlusion_set(self.obj, bool(occlusion))
+
+    @property
+    def occluder_area(self):
+        return lib.draw_list_occluder_area_get(self.obj)
+
+    @occluder_area.setter
+    def occluder_area(self, area):
+        lib.draw_list_occluder_area_set(self.obj, area)
+
+    @property
+    def quality(self):
+        return lib.draw_list_quality_get(self.obj)
+
+    @quality.setter
+    def quality(self, quality):
+        if lib.draw_list_quality_set(self.obj, quality):
+            raise ValueError("invalid render quality")
+
+    @property
+    def decimation(self):
+        return lib.draw_list_decimation_get(self.obj)
+
+    @decimation.setter
+    def decimation(self, step):
+        if lib.draw_list_decimation_set(self.obj, step):
+            raise ValueError("step must be at least 1")
+
+    @property
+    def packed(self):
+        return bool(lib.draw_list_packed_get(self.obj))
+
+    @packed.setter
+    def packed(self, packed):
+        lib.draw_list_packed_set(self.obj, bool(packed))
+
     def empty(self):
         return lib.draw_list_empty(self.obj)
 
@@ -52,6 +131,41 @@ class DrawList:
         num_points, points = points_from_np(points)
         return lib.draw_list_polyline(self.obj, num_points, points)
 
+    def polylines(self, points, offsets=None):
+        # points is a list of (n, 3) arrays, one (n, 3) array split at the
+        # offsets, or one (n, 3) array with rows of nan between polylines
+        if offsets is None and isinstance(points, (list, tuple)):
+            if len(points) > 0 and np.ndim(points[0]) == 2:
+                offsets = np.cumsum([0] + [len(p) for p in points])
+                points = np.concatenate(points)
+        num_points, points = points_from_np(points)
+        if offsets is None:
+            return lib.draw_list_polylines2(self.obj, num_points, points)
+        offsets = np.ascontiguousarray(offsets, dtype=np.intc)
+        if offsets.ndim != 1 or len(offsets) < 2 or offsets[-1] != num_points:
+            raise ValueError("offsets must end with the number of points")
+        offsets_ffi = ffi.from_buffer("int[]", offsets)
+        return lib.draw_list_polylines(
+            self.obj, len(offsets) - 1, offsets_ffi, points
+        )
+
+    def grid(self, origin, u, v, nu, nv):
+        vectors = [doubles_from_np(x) for x in (origin, u, v)]
+        if any(num != 3 for num, _ in vectors):
+            raise ValueError("origin, u and v must be 3 length arrays")
+        origin, u, v = (x for _, x in vectors)
+        return lib.draw_list_grid(self.obj, origin, u, v, nu, nv)
+
+    def circle(self, center, normal, radius, segments=64):
+        num_center, center = doubles_from_np(center)
+        num_normal, normal = doubles_from_np(normal)
+        if num_center != 3 or num_normal != 3:
+            raise ValueError("center and normal must be 3 length arrays")
+        return lib.draw_list_circle(self.obj, center, normal, radius, segments)
+
+    def box(self, x0, y0, z0, x1, y1, z1):
+        return lib.draw_list_box(self.obj, x0, y0, z0, x1, y1, z1)
+
     def style(self, color, width):
         num, color = doubles_from_np(color)
         if num != 4:
@@ -64,9 +178,133 @@ class DrawList:
     def clear(self):
         return lib.draw_list_clear(self.obj)
 
+    def submit(self, commands):
+        # bytes-like or numpy buffer of records, see DrawList.commands
+        data = ffi.from_buffer(commands)
+        if lib.draw_list_submit(self.obj, data, len(data)):
+            raise ValueError("invalid command buffer")
+        return 0
+
+    @staticmethod
+    def commands(*groups):
+        # records for submit from (type, payloads) groups with one row of
+        # payload per item, the rows of all groups are interleaved so that
+        # e.g. a style and a point alternate
+        fields = []
+        values = []
+        for i, (type, payloads) in enumerate(groups):
+            payloads = np.asarray(payloads, dtype=np.double)
+            if payloads.ndim != 2:
+                raise ValueError("payloads must be 2D arrays")
+            fields += [
+                ("type%d" % i, "<u4"),
+                ("length%d" % i, "<u4"),
+                ("payload%d" % i, "<f8", (payloads.shape[1],)),
+            ]
+            values.append((type, payloads))
+        num = len(values[0][1])
+        if any(len(payloads) != num for _, payloads in values):
+            raise ValueError("all groups need the same number of rows")
+        records = np.empty(num, dtype=np.dtype(fields))
+        for i, (type, payloads) in enumerate(values):
+            records["type%d" % i] = type
+            records["length%d" % i] = payloads.shape[1]
+            records["payload%d" % i] = payloads
+        return records
+
+    def child_add(self, child, transform=None):
+        # the child is referenced and must not be destroyed before this list
+        if transform is None:
+            transform = ffi.NULL
+        else:
+            transform = np.ascontiguousarray(transform, dtype=np.double)
+            if transform.size != 16:
+                raise ValueError("transform must be a 4x4 matrix")
+            transform = ffi.from_buffer("double[]", transform)
+        return lib.draw_list_child_add(self.obj, child.obj, transform)
+
+    @property
+    def child_count(self):
+        return lib.draw_list_child_count(self.obj)
+
+    def child_transform_get(self, index):
+        m = ffi.new("double[16]")
+        if lib.draw_list_child_transform_get(self.obj, index, m):
+            raise IndexError("child index out of range")
+        return [m[i] for i in range(16)]
+
+    def child_transform_set(self, index, transform):
+        transform = np.ascontiguousarray(transform, dtype=np.double)
+        if transform.size != 16:
+            raise ValueError("transform must be a 4x4 matrix")
+        transform = ffi.from_buffer("double[]", transform)
+        return lib.draw_list_child_transform_set(self.obj, index, transform)
+
+    def child_pose_set(self, index, x, y, z, rx, ry, rz):
+        return lib.draw_list_child_pose_set(self.obj, index, x, y, z, rx, ry,
+                                            rz)
+
+    def child_world_get(self, index):
+        m = ffi.new("double[16]")
+        if lib.draw_list_child_world_get(self.obj, index, m):
+            raise IndexError("child index out of range")
+        return [m[i] for i in range(16)]
+
+    @property
+    def time(self):
+        # stamp of the primitives appended next, nan when untimed
+        return lib.draw_list_time_get(self.obj)
+
+    @time.setter
+    def time(self, time):
+        lib.draw_list_time_set(self.obj, time)
+
+    def points_timed(self, points, times):
+        num_points, points = points_from_np(points)
+        num_times, times = doubles_from_np(times)
+        if num_times != num_points:
+            raise ValueError("one time per point is required")
+        if lib.draw_list_points_timed(self.obj, num_points, points, times):
+            raise ValueError("times must not decrease")
+        return 0
+
+    def polyline_timed(self, points, times):
+        num_points, points = points_from_np(points)
+        num_times, times = doubles_from_np(times)
+        if num_times != num_points:
+            raise ValueError("one time per point is required")
+        if lib.draw_list_polyline_timed(self.obj, num_points, points, times):
+            raise ValueError("times must not decrease")
+        return 0
+
+    @property
+    def time_window(self):
+        t0 = ffi.new("double *")
+        t1 = ffi.new("double *")
+        lib.draw_list_time_window_get(self.obj, t0, t1)
+        return t0[0], t1[0]
+
+    @time_window.setter
+    def time_window(self, window):
+        # (t0, t1), None or infinite bounds leave that side open
+        t0, t1 = window
+        t0 = float("-inf") if t0 is None else t0
+        t1 = float("inf") if t1 is None else t1
+        if lib.draw_list_time_window_set(self.obj, t0, t1):
+            raise ValueError("t0 must not exceed t1")
+
     def render(self, cr, camera):
         return lib.draw_list_render(self.obj, cr, camera.obj)
 
+    def pick(self, camera, x, y, radius=5.0):
+        # (primitive, vertex) nearest to x, y within radius, or None
+        primitive = ffi.new("size_t *")
+        vertex = ffi.new("size_t *")
+        if lib.draw_list_pick(self.obj, camera.obj, x, y, radius, primitive,
+                              vertex):
+            return None
+        return primitive[0], vertex[0]
+
     def save_svg(self, filename, camera):
         return lib.draw_list_save_svg(self.obj, filename, camera.obj)
 
@@ -101,3 +339,45 @@ class DrawList:
         draw_lists = ffi.new("draw_list_t *[]", [dl.obj for dl in draw_lists])
         lib.draw_list_saves_buffer(num, draw_lists, buffer_ffi, camera.obj)
         return buffer
+
+    def write(self, filename):
+        return lib.draw_list_write(self.obj, filename)
+
+    @classmethod
+    def map(cls, filename):
+        obj = lib.draw_list_map(filename)
+        if obj == ffi.NULL:
+            raise OSError("could not map draw list file")
+        return cls(obj=obj)
+
+    def read_xyz(self, filename, single_precision=False):
+        if lib.draw_list_read_xyz(self.obj, filename, single_precision):
+            raise OSError("could not read xyz file")
+
+    def read_ply(self, filename, width=1.0):
+        if lib.draw_list_read_ply(self.obj, filename, width):
+            raise OSError("could not read ply file")
+
+    @classmethod
+    def shared_create(cls, name, capacity, buffer_capacity):
+        obj = lib.draw_list_shared_create(name, capacity, buffer_capacity)
+        if obj == ffi.NULL:
+            raise OSError("could not create shared draw list")
+        return cls(obj=obj)
+
+    @classmethod
+    def shared_open(cls, name):
+        obj = lib.draw_list_shared_open(name)
+        if obj == ffi.NULL:
+            raise OSError("could not open shared draw list")
+        return cls(obj=obj)
+
+    def publish(self):
+        return lib.draw_list_shared_publish(self.obj)
+
+    def poll(self):
+        return bool(lib.draw_list_shared_poll(self.obj))
+
+    @property
+    def sequence(self):
+        return lib.draw_list_shared_sequence(self.obj)
@@ -18,3 +18,36 @@ class EventList:
 
     def poll(self):
         return lib.event_list_poll(self.obj)
+
+
+class EventScript:
+    def __init__(self, obj=None):
+        if obj is None:
+            obj = lib.event_script_create()
+        if obj == ffi.NULL:
+            raise MemoryError("could not create event script")
+        self.obj = obj
+
+    @classmethod
+    def load(cls, filename):
+        obj = lib.event_script_load(filename)
+        if obj == ffi.NULL:
+            raise OSError("could not load event script")
+        return cls(obj)
+
+    def destroy(self):
+        return lib.event_script_destroy(self.obj)
+
+    def add(self, frame, command):
+        if lib.event_script_add(self.obj, frame, command.encode()):
+            raise ValueError("invalid event: " + command)
+
+    def rewind(self):
+        return lib.event_script_rewind(self.obj)
+
+    @property
+    def frame(self):
+        return lib.event_script_frame(self.obj)
+
+    def poll(self, event_list):
+        return lib.event_script_poll(self.obj, event_list.obj)
@@ -54,6 +54,6 @@ def doubles_from_np(obj):
     obj = np.ascontiguousarray(obj)
     if obj.ndim != 1:
         raise ValueError("obj must be 1D array")
-    obj = ffi.from_buffer("double[]", obj)
     num = obj.shape[0]
+    obj = ffi.from_buffer("double[]", obj)
     return num, obj
\ No newline at end of file
@@ -0,0 +1,65 @@
+from ._drawing3d import ffi, lib
+from .drawlist import DrawList
+from .helpers import *
+
+
+class PointCloud:
+    def __init__(self, obj):
+        self.obj = obj
+
+    @staticmethod
+    def build(filename, points, node_capacity=4096):
+        num_points, points = points_from_np(points)
+        if lib.point_cloud_build(filename, num_points, points, node_capacity):
+            raise OSError("could not build point cloud file")
+
+    @classmethod
+    def open(cls, filename):
+        obj = lib.point_cloud_open(filename)
+        if obj == ffi.NULL:
+            raise OSError("could not open point cloud file")
+        return cls(obj)
+
+    def destroy(self):
+        return lib.point_cloud_destroy(self.obj)
+
+    def __len__(self):
+        return lib.point_cloud_size(self.obj)
+
+    @property
+    def budget(self):
+        return lib.point_cloud_budget_get(self.obj)
+
+    @budget.setter
+    def budget(self, budget):
+        if lib.point_cloud_budget_set(self.obj, budget):
+            raise ValueError("budget must be at least 1")
+
+    @property
+    def cache(self):
+        return lib.point_cloud_cache_get(self.obj)
+
+    @cache.setter
+    def cache(self, cache):
+        lib.point_cloud_cache_set(self.obj, cache)
+
+    def style(self, color, width):
+        num, color = doubles_from_np(color)
+        if num != 4:
+            raise ValueError("color must be a 4 length array or equivalent")
+        return lib.point_cloud_style(self.obj, color, width)
+
+    def update(self, camera):
+        return lib.point_cloud_update(self.obj, camera.obj)
+
+    @property
+    def draw_list(self):
+        # owned by the point cloud, valid until it is destroyed
+        return DrawList(obj=lib.point_cloud_draw_list(self.obj))
+
+    @property
+    def drawn(self):
+        return lib.point_cloud_drawn(self.obj)
+
+    def render(self, cr, camera):
+        return lib.point_cloud_render(self.obj, cr, camera.obj)
@@ -0,0 +1,48 @@
+from ._drawing3d import ffi, lib
+from .camera import Camera
+from .drawlist import DrawList
+
+
+class Recorder:
+    def __init__(self, filename, compress=True):
+        self.obj = lib.recorder_create(filename, bool(compress))
+        if self.obj == ffi.NULL:
+            raise OSError("could not create recording")
+
+    def destroy(self):
+        return lib.recorder_destroy(self.obj)
+
+    def keyframe_interval_set(self, interval):
+        return lib.recorder_keyframe_interval_set(self.obj, interval)
+
+    def frame(self, camera, draw_lists):
+        num = len(draw_lists)
+        draw_lists = ffi.new("draw_list_t *[]", [dl.obj for dl in draw_lists])
+        return lib.recorder_frame(self.obj, camera.obj, num, draw_lists)
+
+
+class Player:
+    def __init__(self, filename):
+        self.obj = lib.player_open(filename)
+        if self.obj == ffi.NULL:
+            raise OSError("could not open recording")
+
+    def destroy(self):
+        return lib.player_destroy(self.obj)
+
+    def __len__(self):
+        return lib.player_length(self.obj)
+
+    def seek(self, frame):
+        return lib.player_seek(self.obj, frame)
+
+    @property
+    def draw_lists(self):
+        num = lib.player_draw_list_count(self.obj)
+        return [DrawList(lib.player_draw_list_get(self.obj, i)) for i in range(num)]
+
+    def camera_get(self, camera=None):
+        if camera is None:
+            camera = Camera()
+        lib.player_camera_get(self.obj, camera.obj)
+        return camera
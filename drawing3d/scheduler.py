@@ -0,0 +1,26 @@
+from ._drawing3d import ffi, lib
+
+PRIORITY_REQUIRED = lib.SCHEDULER_PRIORITY_REQUIRED
+
+
+class Scheduler:
+    def __init__(self, budget=1.0 / 60.0):
+        self.obj = lib.scheduler_create(budget)
+        if self.obj == ffi.NULL:
+            raise ValueError("budget must not be negative")
+
+    def destroy(self):
+        return lib.scheduler_destroy(self.obj)
+
+    @property
+    def budget(self):
+        return lib.scheduler_budget_get(self.obj)
+
+    @budget.setter
+    def budget(self, budget):
+        if lib.scheduler_budget_set(self.obj, budget):
+            raise ValueError("budget must not be negative")
+
+    @property
+    def skipped_count(self):
+        return lib.scheduler_skipped_count(self.obj)
@@ -0,0 +1,14 @@
+from ._drawing3d import ffi, lib
+
+
+def get_isa():
+    return ffi.string(lib.simd_isa_get()).decode()
+
+
+def set_isa(isa):
+    if lib.simd_isa_set(isa.encode()):
+        raise ValueError("instruction set not supported: " + isa)
+
+
+def isa_supported(isa):
+    return bool(lib.simd_isa_supported(isa.encode()))
@@ -4,12 +4,24 @@ from .drawlist import DrawList
 
 
 class Simple3D:
-    def __init__(self, size=(640, 480), fov=60, title="Drawing3D"):
-        self.window = Window(*size, title.encode())
+    def __init__(
+        self,
+        size=(640, 480),
+        fov=60,
+        title="Drawing3D",
+        threaded=False,
+        headless=None,
+        script=None,
+    ):
+        self.window = Window(*size, title.encode(), headless)
+        if threaded:
+            self.window.thread_start()
         self.camera = self.window.get_camera()
         self.camera.set_perspective(fov, fov)
         self.draw_list = DrawList()
         self.event_list = EventList()
+        # scripted events replace the polled ones when given
+        self.script = script
         self.quiting = False
 
         self.draw_list.style2(1.0, 1.0, 1.0, 1.0, 1.0)
@@ -19,7 +31,11 @@ class Simple3D:
     def __enter__(self):
         self.draw_list.load()
         self.event_list.reset()
-        self.event_list.poll()
+        if self.script is not None:
+            if self.script.poll(self.event_list):
+                self.quiting = True
+        else:
+            self.event_list.poll()
         return self.draw_list
 
     def __exit__(self, exc_type, exc_val, exc_tb):
@@ -0,0 +1,67 @@
+from ._drawing3d import ffi, lib
+from .drawlist import DrawList
+from .helpers import doubles_from_np
+
+
+class StreamServer:
+    def __init__(self, path):
+        self.obj = lib.stream_server_create(path)
+        if self.obj == ffi.NULL:
+            raise OSError("could not listen on stream socket")
+
+    def destroy(self):
+        return lib.stream_server_destroy(self.obj)
+
+    def poll(self, timeout=0):
+        return lib.stream_server_poll(self.obj, timeout)
+
+    @property
+    def budget(self):
+        return lib.stream_server_budget_get(self.obj)
+
+    @budget.setter
+    def budget(self, budget):
+        lib.stream_server_budget_set(self.obj, budget)
+
+    @property
+    def layers(self):
+        num = lib.stream_server_layer_count(self.obj)
+        return [
+            (
+                ffi.string(lib.stream_server_layer_name(self.obj, i)).decode(),
+                DrawList(lib.stream_server_layer_get(self.obj, i)),
+            )
+            for i in range(num)
+        ]
+
+    def layer(self, name):
+        obj = lib.stream_server_layer_find(self.obj, name)
+        if obj == ffi.NULL:
+            return None
+        return DrawList(obj)
+
+
+class StreamClient:
+    def __init__(self, path):
+        self.obj = lib.stream_client_connect(path)
+        if self.obj == ffi.NULL:
+            raise OSError("could not connect to stream socket")
+
+    def destroy(self):
+        return lib.stream_client_destroy(self.obj)
+
+    def layer(self, name):
+        return lib.stream_client_layer(self.obj, name)
+
+    def primitive(self, type, data):
+        num, data = doubles_from_np(data)
+        return lib.stream_client_primitive(self.obj, type, num, data)
+
+    def draw_list(self, draw_list):
+        return lib.stream_client_draw_list(self.obj, draw_list.obj)
+
+    def commit(self):
+        return lib.stream_client_commit(self.obj)
+
+    def flush(self):
+        return lib.stream_client_flush(self.obj)
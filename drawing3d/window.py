@@ -1,11 +1,20 @@
 from ._drawing3d import ffi, lib
 from .helpers import buffer_from
 from .camera import Camera
+from .constants import STATS_TIMERS, STATS_COUNTERS
 
 
 class Window:
-    def __init__(self, width, height, title):
-        self.obj = lib.window_create(width, height, title)
+    def __init__(self, width, height, title, headless=None):
+        if headless is None:
+            self.obj = lib.window_create(width, height, title)
+        else:
+            backend = (
+                lib.WINDOW_BACKEND_HEADLESS if headless else lib.WINDOW_BACKEND_SDL
+            )
+            self.obj = lib.window_create2(width, height, title, backend)
+        if self.obj == ffi.NULL:
+            raise OSError("could not create window")
 
     def destroy(self):
         return lib.window_destroy(self.obj)
@@ -22,6 +31,17 @@ class Window:
     def render(self, draw_list):
         return lib.window_render(self.obj, draw_list.obj)
 
+    def render_scheduled(self, scheduler, draw_lists, priorities):
+        # returns the draw lists that were skipped this frame
+        num = len(draw_lists)
+        objs = ffi.new("draw_list_t *[]", [dl.obj for dl in draw_lists])
+        skipped = ffi.new("bool[]", num)
+        if lib.window_render_scheduled(
+            self.obj, scheduler.obj, num, objs, list(priorities), skipped
+        ):
+            raise RuntimeError("scheduled render failed")
+        return [dl for dl, s in zip(draw_lists, skipped) if s]
+
     def render_end(self):
         return lib.window_render_end(self.obj)
 
@@ -30,6 +50,43 @@ class Window:
         rx, ry, rz = att
         return lib.window_render_at(self.obj, draw_list.obj, x, y, z, rx, ry, rz)
 
+    def thread_start(self, queue_length=2):
+        return lib.window_thread_start(self.obj, queue_length)
+
+    def thread_stop(self):
+        return lib.window_thread_stop(self.obj)
+
+    @property
+    def headless(self):
+        return lib.window_backend_get(self.obj) == lib.WINDOW_BACKEND_HEADLESS
+
+    @property
+    def threaded(self):
+        return bool(lib.window_threaded_get(self.obj))
+
+    @property
+    def frames_presented(self):
+        return lib.window_frames_presented_get(self.obj)
+
+    @property
+    def frames_dropped(self):
+        return lib.window_frames_dropped_get(self.obj)
+
+    @property
+    def stats(self):
+        stats = ffi.new("frame_stats_t[]", lib.STATS_FRAMES)
+        num = lib.window_stats_get(self.obj, lib.STATS_FRAMES, stats)
+        return [
+            {
+                "frame": stats[i].frame,
+                "timers": {n: stats[i].timers[j] for j, n in enumerate(STATS_TIMERS)},
+                "counters": {
+                    n: stats[i].counters[j] for j, n in enumerate(STATS_COUNTERS)
+                },
+            }
+            for i in range(num)
+        ]
+
     def handle_events(self, event_list):
         return lib.window_handle_events(self.obj, event_list.obj)
 
@@ -77,3 +134,33 @@ class Window:
     @key_sensitivity.setter
     def key_sensitivity(self, sensitivity):
         lib.window_key_sensitivity_set(self.obj, sensitivity)
+
+    @property
+    def progressive(self):
+        return lib.window_progressive_get(self.obj)
+
+    @progressive.setter
+    def progressive(self, progressive):
+        lib.window_progressive_set(self.obj, progressive)
+
+    @property
+    def progressive_delay(self):
+        return lib.window_progressive_delay_get(self.obj)
+
+    @progressive_delay.setter
+    def progressive_delay(self, delay):
+        if lib.window_progressive_delay_set(self.obj, delay):
+            raise ValueError("delay must not be negative")
+
+    @property
+    def progressive_step(self):
+        return lib.window_progressive_step_get(self.obj)
+
+    @progressive_step.setter
+    def progressive_step(self, step):
+        if lib.window_progressive_step_set(self.obj, step):
+            raise ValueError("step must be at least 1")
+
+    @property
+    def decimation(self):
+        return lib.window_decimation_get(self.obj)
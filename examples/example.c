@@ -7,26 +7,6 @@
 
 #define PI 3.14159265358979323846
 
-void draw_cube(draw_list_t *draw_list, double x0, double y0, double z0,
-	       double x1, double y1, double z1)
-{
-	double lines[12][2][3] = {
-		{ { x0, y0, z0 }, { x1, y0, z0 } },
-		{ { x1, y0, z0 }, { x1, y1, z0 } },
-		{ { x1, y1, z0 }, { x0, y1, z0 } },
-		{ { x0, y1, z0 }, { x0, y0, z0 } },
-		{ { x0, y0, z1 }, { x1, y0, z1 } },
-		{ { x1, y0, z1 }, { x1, y1, z1 } },
-		{ { x1, y1, z1 }, { x0, y1, z1 } },
-		{ { x0, y1, z1 }, { x0, y0, z1 } },
-		{ { x0, y0, z0 }, { x0, y0, z1 } },
-		{ { x1, y0, z0 }, { x1, y0, z1 } },
-		{ { x1, y1, z0 }, { x1, y1, z1 } },
-		{ { x0, y1, z0 }, { x0, y1, z1 } },
-	};
-	draw_list_lines(draw_list, 12, (double *)lines);
-}
-
 void draw_sin(draw_list_t *draw_list, double x0, double y0, double z0,
 	      double x1, double y1, double z1, double t)
 {
@@ -64,7 +44,7 @@ int main()
 	draw_list_polygon(draw_list_bg, 4, (double *)points);
 
 	draw_list_style2(draw_list_bg, 1.0, 0.0, 0.0, 1.0, 4.0);
-	draw_cube(draw_list_bg, -1.0, -1.0, -1.0, 1.0, 1.0, 1.0);
+	draw_list_box(draw_list_bg, -1.0, -1.0, -1.0, 1.0, 1.0, 1.0);
 
 	event_list_t *event_list = event_list_create();
 	window_t *window1 = window_create(720, 720, "1");
@@ -0,0 +1,32 @@
+#include <stdio.h>
+
+#include "drawing3d.h"
+
+// standalone viewer rendering the layers streamed into a unix socket
+int main(int argc, char **argv)
+{
+	const char *path = argc > 1 ? argv[1] : "/tmp/drawing3d.sock";
+	stream_server_t *server = stream_server_create(path);
+	if (server == NULL) {
+		fprintf(stderr, "could not listen on %s\n", path);
+		return 1;
+	}
+
+	event_list_t *event_list = event_list_create();
+	window_t *window = window_create(720, 720, "viewer");
+	while (!event_list_poll(event_list)) {
+		stream_server_poll(server, 0);
+		for (size_t i = 0; i < stream_server_layer_count(server); i++)
+			window_render(window,
+				      stream_server_layer_get(server, i));
+		window_render_end(window);
+		if (window_handle_events(window, event_list))
+			break;
+		event_list_reset(event_list);
+	}
+
+	window_destroy(window);
+	event_list_destroy(event_list);
+	stream_server_destroy(server);
+	return 0;
+}
@@ -2,6 +2,10 @@
 #define CAMERA_H
 
 #include <stdbool.h>
+#include <stddef.h>
+
+// number of doubles in a camera_state_get snapshot
+#define CAMERA_STATE_LEN 33
 
 struct camera_s;
 typedef struct camera_s camera_t; 
@@ -33,7 +37,13 @@ bool camera_preserve_ratio_get(camera_t *camera);
 int camera_preserve_ratio_set(camera_t *camera, bool preserve_ratio);
 int camera_projection_get(camera_t *camera, double m[16]);
 int camera_projection_set(camera_t *camera, double m[16]);
+int camera_state_get(camera_t *camera, double state[CAMERA_STATE_LEN]);
+int camera_state_set(camera_t *camera, double state[CAMERA_STATE_LEN]);
 bool camera_project(camera_t *camera, double *p1, double *p2);
+bool camera_project_depth(camera_t *camera, double *p, double *q,
+			  double *depth);
+int camera_project_points(camera_t *camera, size_t num, double *points,
+			  double *q, double *depth, bool *visible);
 int camera_update(camera_t *camera);
 
 #endif
\ No newline at end of file
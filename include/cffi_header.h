@@ -12,6 +12,20 @@ struct window_s;
 typedef struct window_s window_t;
 struct event_list_s;
 typedef struct event_list_s event_list_t;
+struct event_script_s;
+typedef struct event_script_s event_script_t;
+struct recorder_s;
+typedef struct recorder_s recorder_t;
+struct player_s;
+typedef struct player_s player_t;
+struct stream_server_s;
+typedef struct stream_server_s stream_server_t;
+struct stream_client_s;
+typedef struct stream_client_s stream_client_t;
+struct scheduler_s;
+typedef struct scheduler_s scheduler_t;
+struct point_cloud_s;
+typedef struct point_cloud_s point_cloud_t;
 
 typedef enum {
 	// a line segment between two points
@@ -31,10 +45,97 @@ typedef enum {
 	PRIMITIVE_TYPE_STYLE,
 	// clear (0 doubles)
 	PRIMITIVE_TYPE_CLEAR,
+	// a grid of nu by nv cells spanned by the edges u and v, expanded at
+	// render time and thinned out where the cells get small on screen
+	// origin, u, v, nu, nv (11 doubles)
+	PRIMITIVE_TYPE_GRID,
+	// a circle, expanded at render time with a segment count adapted to
+	// its size on screen
+	// center, normal, radius, max segments (8 doubles)
+	PRIMITIVE_TYPE_CIRCLE,
+	// the wireframe of an axis aligned box
+	// min corner, max corner (6 doubles)
+	PRIMITIVE_TYPE_BOX,
+	// many polylines rendered as one, a point with nan coordinates
+	// separates two polylines
+	// n points (3 * n doubles)
+	PRIMITIVE_TYPE_POLYLINES,
+	// a child draw list, drawn with its transform relative to this list
+	// child index (1 double)
+	PRIMITIVE_TYPE_CHILD,
 } primitive_type_t;
 
+// header of a draw_list_submit record, followed by length doubles of
+// payload as for draw_list_append; stream primitive records look the same
+typedef struct {
+	uint32_t type;
+	uint32_t length;
+} draw_list_command_t;
+
+typedef enum {
+	// antialiased cairo strokes with round caps
+	RENDER_QUALITY_FULL,
+	// cairo without antialiasing and with butt caps
+	RENDER_QUALITY_FAST,
+	// like fast, but lines and points up to one pixel wide are drawn
+	// straight into image surfaces without the cairo stroker
+	RENDER_QUALITY_DIRECT,
+} render_quality_t;
+
 typedef uint16_t key_action_t;
 
+typedef enum {
+	// a resizable sdl window with an accelerated renderer
+	WINDOW_BACKEND_SDL,
+	// an offscreen image surface, needs no display or gpu
+	WINDOW_BACKEND_HEADLESS,
+} window_backend_t;
+
+#define CAMERA_STATE_LEN 33
+
+// number of frames kept by a window, older frames are overwritten
+#define STATS_FRAMES 128
+#define SCHEDULER_PRIORITY_REQUIRED 0
+
+typedef enum {
+	// time between two presented frames
+	STATS_TIMER_FRAME,
+	STATS_TIMER_CAMERA_UPDATE,
+	// projection passes of occlusion culling and depth sorting
+	STATS_TIMER_OCCLUDERS,
+	STATS_TIMER_SORT,
+	// render stages, including the projection of their points
+	STATS_TIMER_LINE,
+	STATS_TIMER_POINT,
+	STATS_TIMER_POLYGON,
+	STATS_TIMER_POLYLINE,
+	STATS_TIMER_STYLE,
+	STATS_TIMER_CLEAR,
+	// grids, circles and boxes, expanded at render time
+	STATS_TIMER_PROCEDURAL,
+	STATS_TIMER_WINDOW_CLEAR,
+	STATS_TIMER_UPLOAD,
+	STATS_TIMER_PRESENT,
+	STATS_TIMER_COUNT,
+} stats_timer_t;
+
+typedef enum {
+	STATS_COUNTER_PRIMITIVES,
+	STATS_COUNTER_VERTICES,
+	// vertices behind the camera or hidden by occluders
+	STATS_COUNTER_CULLED,
+	STATS_COUNTER_STROKES,
+	STATS_COUNTER_FILLS,
+	STATS_COUNTER_COUNT,
+} stats_counter_t;
+
+typedef struct {
+	uint64_t frame;
+	// seconds
+	double timers[STATS_TIMER_COUNT];
+	uint64_t counters[STATS_COUNTER_COUNT];
+} frame_stats_t;
+
 camera_t *camera_create();
 int camera_destroy(camera_t *camera);
 int camera_position_set(camera_t *camera, double x, double y, double z);
@@ -62,29 +163,88 @@ bool camera_preserve_ratio_get(camera_t *camera);
 int camera_preserve_ratio_set(camera_t *camera, bool preserve_ratio);
 int camera_projection_get(camera_t *camera, double m[16]);
 int camera_projection_set(camera_t *camera, double m[16]);
+int camera_state_get(camera_t *camera, double state[CAMERA_STATE_LEN]);
+int camera_state_set(camera_t *camera, double state[CAMERA_STATE_LEN]);
 bool camera_project(camera_t *camera, double *p1, double *p2);
+bool camera_project_depth(camera_t *camera, double *p, double *q,
+			  double *depth);
+int camera_project_points(camera_t *camera, size_t num, double *points,
+			  double *q, double *depth, bool *visible);
 int camera_update(camera_t *camera);
 
 draw_list_t *draw_list_create();
 int draw_list_destroy(draw_list_t *draw_list);
 int draw_list_save(draw_list_t *draw_list);
 int draw_list_load(draw_list_t *draw_list);
+draw_list_t *draw_list_clone(draw_list_t *draw_list);
+int draw_list_restore(draw_list_t *draw_list, draw_list_t *snapshot);
+int draw_list_checkpoint_push(draw_list_t *draw_list, const char *name);
+int draw_list_checkpoint_rewind(draw_list_t *draw_list, const char *name);
+int draw_list_checkpoint_drop(draw_list_t *draw_list, const char *name);
+size_t draw_list_checkpoint_count(draw_list_t *draw_list);
+const char *draw_list_checkpoint_name(draw_list_t *draw_list, size_t index);
+bool draw_list_depth_sort_get(draw_list_t *draw_list);
+int draw_list_depth_sort_set(draw_list_t *draw_list, bool depth_sort);
+bool draw_list_occlusion_get(draw_list_t *draw_list);
+int draw_list_occlusion_set(draw_list_t *draw_list, bool occlusion);
+double draw_list_occluder_area_get(draw_list_t *draw_list);
+int draw_list_occluder_area_set(draw_list_t *draw_list, double area);
+render_quality_t draw_list_quality_get(draw_list_t *draw_list);
+int draw_list_quality_set(draw_list_t *draw_list, render_quality_t quality);
+size_t draw_list_decimation_get(draw_list_t *draw_list);
+int draw_list_decimation_set(draw_list_t *draw_list, size_t step);
+bool draw_list_packed_get(draw_list_t *draw_list);
+int draw_list_packed_set(draw_list_t *draw_list, bool packed);
 int draw_list_empty(draw_list_t *draw_list);
 int draw_list_buffer_allocate(draw_list_t *draw_list, size_t num);
 int draw_list_buffer_copy(draw_list_t *draw_list, size_t num, double *src);
 int draw_list_append(draw_list_t *draw_list, primitive_type_t type, size_t num);
-int draw_list_points(draw_list_t *draw_list, int num_points, double *points);
+int draw_list_points(draw_list_t *draw_list, size_t num_points,
+		     double *points);
 int draw_list_lines(draw_list_t *draw_list, int num_lines, double *lines);
 int draw_list_line(draw_list_t *draw_list, double x1, double y1, double z1,
 		   double x2, double y2, double z2);
 int draw_list_point(draw_list_t *draw_list, double x, double y, double z);
 int draw_list_polygon(draw_list_t *draw_list, int num_points, double *points);
 int draw_list_polyline(draw_list_t *draw_list, int num_points, double *points);
+int draw_list_polylines(draw_list_t *draw_list, int num_polylines,
+			int *offsets, double *points);
+int draw_list_polylines2(draw_list_t *draw_list, int num_points,
+			 double *points);
+int draw_list_grid(draw_list_t *draw_list, double origin[3], double u[3],
+		   double v[3], int nu, int nv);
+int draw_list_circle(draw_list_t *draw_list, double center[3],
+		     double normal[3], double radius, int segments);
+int draw_list_box(draw_list_t *draw_list, double x0, double y0, double z0,
+		  double x1, double y1, double z1);
 int draw_list_style(draw_list_t *draw_list, double color[4], double width);
 int draw_list_style2(draw_list_t *draw_list, double r, double g, double b,
 		     double a, double width);
 int draw_list_clear(draw_list_t *draw_list);
+int draw_list_submit(draw_list_t *draw_list, const void *data, size_t size);
+int draw_list_child_add(draw_list_t *draw_list, draw_list_t *child,
+			double transform[16]);
+size_t draw_list_child_count(draw_list_t *draw_list);
+int draw_list_child_transform_get(draw_list_t *draw_list, size_t index,
+				  double transform[16]);
+int draw_list_child_transform_set(draw_list_t *draw_list, size_t index,
+				  double transform[16]);
+int draw_list_child_pose_set(draw_list_t *draw_list, size_t index, double x,
+			     double y, double z, double rx, double ry,
+			     double rz);
+int draw_list_child_world_get(draw_list_t *draw_list, size_t index,
+			      double world[16]);
+int draw_list_time_set(draw_list_t *draw_list, double time);
+double draw_list_time_get(draw_list_t *draw_list);
+int draw_list_points_timed(draw_list_t *draw_list, int num_points,
+			   double *points, double *times);
+int draw_list_polyline_timed(draw_list_t *draw_list, int num_points,
+			     double *points, double *times);
+int draw_list_time_window_set(draw_list_t *draw_list, double t0, double t1);
+int draw_list_time_window_get(draw_list_t *draw_list, double *t0, double *t1);
 int draw_list_render(draw_list_t *draw_list, cairo_t *cr, camera_t *camera);
+int draw_list_pick(draw_list_t *draw_list, camera_t *camera, double x,
+		   double y, double radius, size_t *primitive, size_t *vertex);
 int draw_list_save_svg(draw_list_t *draw_list, const char *filename,
 		       camera_t *camera);
 int draw_list_saves_svg(size_t num, draw_list_t **draw_list,
@@ -97,8 +257,22 @@ int draw_list_save_buffer(draw_list_t *draw_list, uint8_t *buffer,
 			  camera_t *camera);
 int draw_list_saves_buffer(size_t num, draw_list_t **draw_list,
 			   uint8_t *buffer, camera_t *camera);
+int draw_list_write(draw_list_t *draw_list, const char *filename);
+draw_list_t *draw_list_map(const char *filename);
+int draw_list_read_xyz(draw_list_t *draw_list, const char *filename,
+		       bool single_precision);
+int draw_list_read_ply(draw_list_t *draw_list, const char *filename,
+		       double width);
+draw_list_t *draw_list_shared_create(const char *name, size_t capacity,
+				     size_t buffer_capacity);
+draw_list_t *draw_list_shared_open(const char *name);
+int draw_list_shared_publish(draw_list_t *draw_list);
+bool draw_list_shared_poll(draw_list_t *draw_list);
+uint64_t draw_list_shared_sequence(draw_list_t *draw_list);
 
 window_t *window_create(int width, int height, char *title);
+window_t *window_create2(int width, int height, char *title,
+			 window_backend_t backend);
 int window_destroy(window_t *window);
 int window_surface_init(window_t *window);
 int window_surface_destroy(window_t *window);
@@ -106,7 +280,17 @@ int window_clear(window_t *window);
 int window_render(window_t *window, draw_list_t *draw_list);
 int window_render_at(window_t *window, draw_list_t *draw_list, double x,
 		     double y, double z, double rx, double ry, double rz);
+int window_render_scheduled(window_t *window, scheduler_t *scheduler,
+			    size_t num, draw_list_t **draw_lists,
+			    const int *priorities, bool *skipped);
 int window_render_end(window_t *window);
+int window_thread_start(window_t *window, size_t queue_length);
+int window_thread_stop(window_t *window);
+window_backend_t window_backend_get(window_t *window);
+bool window_threaded_get(window_t *window);
+size_t window_frames_presented_get(window_t *window);
+size_t window_frames_dropped_get(window_t *window);
+size_t window_stats_get(window_t *window, size_t num, frame_stats_t *stats);
 int window_handle_events(window_t *window, event_list_t *event_list);
 int window_do_key_action(window_t *window, key_action_t action);
 camera_t *window_camera_get(window_t *window);
@@ -120,6 +304,13 @@ double window_wheel_sensitivity_get(window_t *window);
 int window_wheel_sensitivity_set(window_t *window, double sensitivity);
 double window_key_sensitivity_get(window_t *window);
 int window_key_sensitivity_set(window_t *window, double sensitivity);
+bool window_progressive_get(window_t *window);
+int window_progressive_set(window_t *window, bool progressive);
+double window_progressive_delay_get(window_t *window);
+int window_progressive_delay_set(window_t *window, double delay);
+size_t window_progressive_step_get(window_t *window);
+int window_progressive_step_set(window_t *window, size_t step);
+size_t window_decimation_get(window_t *window);
 
 event_list_t *event_list_create();
 int event_list_destroy(event_list_t *event_list);
@@ -128,3 +319,78 @@ int event_list_append(event_list_t *event_list, SDL_Event *event);
 int event_list_length(event_list_t *event_list);
 int event_list_get(event_list_t *event_list, int index, SDL_Event *event);
 int event_list_poll(event_list_t *event_list);
+event_script_t *event_script_create();
+event_script_t *event_script_load(const char *filename);
+int event_script_destroy(event_script_t *script);
+int event_script_add(event_script_t *script, size_t frame,
+		     const char *command);
+int event_script_rewind(event_script_t *script);
+size_t event_script_frame(event_script_t *script);
+int event_script_poll(event_script_t *script, event_list_t *event_list);
+
+recorder_t *recorder_create(const char *filename, bool compress);
+int recorder_destroy(recorder_t *recorder);
+int recorder_keyframe_interval_set(recorder_t *recorder, size_t interval);
+int recorder_frame(recorder_t *recorder, camera_t *camera, size_t num,
+		   draw_list_t **draw_lists);
+
+player_t *player_open(const char *filename);
+int player_destroy(player_t *player);
+size_t player_length(player_t *player);
+int player_seek(player_t *player, size_t frame);
+size_t player_draw_list_count(player_t *player);
+draw_list_t *player_draw_list_get(player_t *player, size_t index);
+int player_camera_get(player_t *player, camera_t *camera);
+
+stream_server_t *stream_server_create(const char *path);
+int stream_server_destroy(stream_server_t *server);
+int stream_server_poll(stream_server_t *server, int timeout);
+size_t stream_server_budget_get(stream_server_t *server);
+int stream_server_budget_set(stream_server_t *server, size_t budget);
+size_t stream_server_layer_count(stream_server_t *server);
+const char *stream_server_layer_name(stream_server_t *server, size_t index);
+draw_list_t *stream_server_layer_get(stream_server_t *server, size_t index);
+draw_list_t *stream_server_layer_find(stream_server_t *server,
+				      const char *name);
+
+stream_client_t *stream_client_connect(const char *path);
+int stream_client_destroy(stream_client_t *client);
+int stream_client_layer(stream_client_t *client, const char *name);
+int stream_client_primitive(stream_client_t *client, primitive_type_t type,
+			    size_t num, double *data);
+int stream_client_draw_list(stream_client_t *client, draw_list_t *draw_list);
+int stream_client_commit(stream_client_t *client);
+int stream_client_flush(stream_client_t *client);
+
+int stats_begin(frame_stats_t *stats);
+int stats_end();
+
+const char *simd_isa_get();
+int simd_isa_set(const char *isa);
+bool simd_isa_supported(const char *isa);
+
+scheduler_t *scheduler_create(double budget);
+int scheduler_destroy(scheduler_t *scheduler);
+double scheduler_budget_get(scheduler_t *scheduler);
+int scheduler_budget_set(scheduler_t *scheduler, double budget);
+int scheduler_render(scheduler_t *scheduler, cairo_t *cr, camera_t *camera,
+		     size_t num, draw_list_t **draw_lists,
+		     const int *priorities, bool *skipped);
+size_t scheduler_skipped_count(scheduler_t *scheduler);
+
+int point_cloud_build(const char *filename, size_t num_points, double *points,
+		      size_t node_capacity);
+point_cloud_t *point_cloud_open(const char *filename);
+int point_cloud_destroy(point_cloud_t *point_cloud);
+size_t point_cloud_size(point_cloud_t *point_cloud);
+size_t point_cloud_budget_get(point_cloud_t *point_cloud);
+int point_cloud_budget_set(point_cloud_t *point_cloud, size_t budget);
+size_t point_cloud_cache_get(point_cloud_t *point_cloud);
+int point_cloud_cache_set(point_cloud_t *point_cloud, size_t cache);
+int point_cloud_style(point_cloud_t *point_cloud, double color[4],
+		      double width);
+int point_cloud_update(point_cloud_t *point_cloud, camera_t *camera);
+draw_list_t *point_cloud_draw_list(point_cloud_t *point_cloud);
+size_t point_cloud_drawn(point_cloud_t *point_cloud);
+int point_cloud_render(point_cloud_t *point_cloud, cairo_t *cr,
+		       camera_t *camera);
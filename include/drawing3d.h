@@ -5,6 +5,13 @@
 #include "camera.h"
 #include "drawlist.h"
 #include "eventlist.h"
+#include "hiz.h"
 #include "keymapping.h"
+#include "pointcloud.h"
+#include "recorder.h"
+#include "scheduler.h"
+#include "simd.h"
+#include "stats.h"
+#include "stream.h"
 
 #endif
\ No newline at end of file
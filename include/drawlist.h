@@ -32,28 +32,116 @@ typedef enum {
 	PRIMITIVE_TYPE_STYLE,
 	// clear (0 doubles)
 	PRIMITIVE_TYPE_CLEAR,
+	// a grid of nu by nv cells spanned by the edges u and v, expanded at
+	// render time and thinned out where the cells get small on screen
+	// origin, u, v, nu, nv (11 doubles)
+	PRIMITIVE_TYPE_GRID,
+	// a circle, expanded at render time with a segment count adapted to
+	// its size on screen
+	// center, normal, radius, max segments (8 doubles)
+	PRIMITIVE_TYPE_CIRCLE,
+	// the wireframe of an axis aligned box
+	// min corner, max corner (6 doubles)
+	PRIMITIVE_TYPE_BOX,
+	// many polylines rendered as one, a point with nan coordinates
+	// separates two polylines
+	// n points (3 * n doubles)
+	PRIMITIVE_TYPE_POLYLINES,
+	// a child draw list, drawn with its transform relative to this list
+	// child index (1 double)
+	PRIMITIVE_TYPE_CHILD,
 } primitive_type_t;
 
+// header of a draw_list_submit record, followed by length doubles of
+// payload as for draw_list_append; stream primitive records look the same
+typedef struct {
+	uint32_t type;
+	uint32_t length;
+} draw_list_command_t;
+
+typedef enum {
+	// antialiased cairo strokes with round caps
+	RENDER_QUALITY_FULL,
+	// cairo without antialiasing and with butt caps
+	RENDER_QUALITY_FAST,
+	// like fast, but lines and points up to one pixel wide are drawn
+	// straight into image surfaces without the cairo stroker
+	RENDER_QUALITY_DIRECT,
+} render_quality_t;
+
 draw_list_t *draw_list_create();
 int draw_list_destroy(draw_list_t *draw_list);
 int draw_list_save(draw_list_t *draw_list);
 int draw_list_load(draw_list_t *draw_list);
+draw_list_t *draw_list_clone(draw_list_t *draw_list);
+int draw_list_restore(draw_list_t *draw_list, draw_list_t *snapshot);
+int draw_list_checkpoint_push(draw_list_t *draw_list, const char *name);
+int draw_list_checkpoint_rewind(draw_list_t *draw_list, const char *name);
+int draw_list_checkpoint_drop(draw_list_t *draw_list, const char *name);
+size_t draw_list_checkpoint_count(draw_list_t *draw_list);
+const char *draw_list_checkpoint_name(draw_list_t *draw_list, size_t index);
+bool draw_list_depth_sort_get(draw_list_t *draw_list);
+int draw_list_depth_sort_set(draw_list_t *draw_list, bool depth_sort);
+bool draw_list_occlusion_get(draw_list_t *draw_list);
+int draw_list_occlusion_set(draw_list_t *draw_list, bool occlusion);
+double draw_list_occluder_area_get(draw_list_t *draw_list);
+int draw_list_occluder_area_set(draw_list_t *draw_list, double area);
+render_quality_t draw_list_quality_get(draw_list_t *draw_list);
+int draw_list_quality_set(draw_list_t *draw_list, render_quality_t quality);
+size_t draw_list_decimation_get(draw_list_t *draw_list);
+int draw_list_decimation_set(draw_list_t *draw_list, size_t step);
+bool draw_list_packed_get(draw_list_t *draw_list);
+int draw_list_packed_set(draw_list_t *draw_list, bool packed);
 int draw_list_empty(draw_list_t *draw_list);
 int draw_list_buffer_allocate(draw_list_t *draw_list, size_t num);
 int draw_list_buffer_copy(draw_list_t *draw_list, size_t num, double *src);
 int draw_list_append(draw_list_t *draw_list, primitive_type_t type, size_t num);
-int draw_list_points(draw_list_t *draw_list, int num_points, double *points);
+int draw_list_points(draw_list_t *draw_list, size_t num_points,
+		     double *points);
 int draw_list_lines(draw_list_t *draw_list, int num_lines, double *lines);
 int draw_list_line(draw_list_t *draw_list, double x1, double y1, double z1,
 		   double x2, double y2, double z2);
 int draw_list_point(draw_list_t *draw_list, double x, double y, double z);
 int draw_list_polygon(draw_list_t *draw_list, int num_points, double *points);
 int draw_list_polyline(draw_list_t *draw_list, int num_points, double *points);
+int draw_list_polylines(draw_list_t *draw_list, int num_polylines,
+			int *offsets, double *points);
+int draw_list_polylines2(draw_list_t *draw_list, int num_points,
+			 double *points);
+int draw_list_grid(draw_list_t *draw_list, double origin[3], double u[3],
+		   double v[3], int nu, int nv);
+int draw_list_circle(draw_list_t *draw_list, double center[3],
+		     double normal[3], double radius, int segments);
+int draw_list_box(draw_list_t *draw_list, double x0, double y0, double z0,
+		  double x1, double y1, double z1);
 int draw_list_style(draw_list_t *draw_list, double color[4], double width);
 int draw_list_style2(draw_list_t *draw_list, double r, double g, double b,
 		     double a, double width);
 int draw_list_clear(draw_list_t *draw_list);
+int draw_list_submit(draw_list_t *draw_list, const void *data, size_t size);
+int draw_list_child_add(draw_list_t *draw_list, draw_list_t *child,
+			double transform[16]);
+size_t draw_list_child_count(draw_list_t *draw_list);
+int draw_list_child_transform_get(draw_list_t *draw_list, size_t index,
+				  double transform[16]);
+int draw_list_child_transform_set(draw_list_t *draw_list, size_t index,
+				  double transform[16]);
+int draw_list_child_pose_set(draw_list_t *draw_list, size_t index, double x,
+			     double y, double z, double rx, double ry,
+			     double rz);
+int draw_list_child_world_get(draw_list_t *draw_list, size_t index,
+			      double world[16]);
+int draw_list_time_set(draw_list_t *draw_list, double time);
+double draw_list_time_get(draw_list_t *draw_list);
+int draw_list_points_timed(draw_list_t *draw_list, int num_points,
+			   double *points, double *times);
+int draw_list_polyline_timed(draw_list_t *draw_list, int num_points,
+			     double *points, double *times);
+int draw_list_time_window_set(draw_list_t *draw_list, double t0, double t1);
+int draw_list_time_window_get(draw_list_t *draw_list, double *t0, double *t1);
 int draw_list_render(draw_list_t *draw_list, cairo_t *cr, camera_t *camera);
+int draw_list_pick(draw_list_t *draw_list, camera_t *camera, double x,
+		   double y, double radius, size_t *primitive, size_t *vertex);
 int draw_list_save_svg(draw_list_t *draw_list, const char *filename,
 		       camera_t *camera);
 int draw_list_saves_svg(size_t num, draw_list_t **draw_list,
@@ -66,5 +154,17 @@ int draw_list_save_buffer(draw_list_t *draw_list, uint8_t *buffer,
 			  camera_t *camera);
 int draw_list_saves_buffer(size_t num, draw_list_t **draw_list,
 			   uint8_t *buffer, camera_t *camera);
+int draw_list_write(draw_list_t *draw_list, const char *filename);
+draw_list_t *draw_list_map(const char *filename);
+int draw_list_read_xyz(draw_list_t *draw_list, const char *filename,
+		       bool single_precision);
+int draw_list_read_ply(draw_list_t *draw_list, const char *filename,
+		       double width);
+draw_list_t *draw_list_shared_create(const char *name, size_t capacity,
+				     size_t buffer_capacity);
+draw_list_t *draw_list_shared_open(const char *name);
+int draw_list_shared_publish(draw_list_t *draw_list);
+bool draw_list_shared_poll(draw_list_t *draw_list);
+uint64_t draw_list_shared_sequence(draw_list_t *draw_list);
 
 #endif
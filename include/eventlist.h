@@ -5,6 +5,8 @@
 
 struct event_list_s;
 typedef struct event_list_s event_list_t;
+struct event_script_s;
+typedef struct event_script_s event_script_t;
 
 event_list_t *event_list_create();
 int event_list_destroy(event_list_t *event_list);
@@ -13,5 +15,13 @@ int event_list_append(event_list_t *event_list, SDL_Event *event);
 int event_list_length(event_list_t *event_list);
 int event_list_get(event_list_t *event_list, int index, SDL_Event *event);
 int event_list_poll(event_list_t *event_list);
+event_script_t *event_script_create();
+event_script_t *event_script_load(const char *filename);
+int event_script_destroy(event_script_t *script);
+int event_script_add(event_script_t *script, size_t frame,
+		     const char *command);
+int event_script_rewind(event_script_t *script);
+size_t event_script_frame(event_script_t *script);
+int event_script_poll(event_script_t *script, event_list_t *event_list);
 
 #endif
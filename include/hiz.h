@@ -0,0 +1,19 @@
+#ifndef HIZ_H
+#define HIZ_H
+
+#include <stdbool.h>
+
+// low resolution hierarchical depth buffer for coarse occlusion culling,
+// larger depth values are farther away
+struct hiz_s;
+typedef struct hiz_s hiz_t;
+
+hiz_t *hiz_create();
+int hiz_destroy(hiz_t *hiz);
+int hiz_reset(hiz_t *hiz, int width, int height);
+int hiz_occluder(hiz_t *hiz, int num_points, double *points, double depth);
+int hiz_build(hiz_t *hiz);
+bool hiz_occluded(hiz_t *hiz, double x0, double y0, double x1, double y1,
+		  double depth);
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef POINTCLOUD_H
+#define POINTCLOUD_H
+
+#include <cairo/cairo.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "camera.h"
+#include "drawlist.h"
+
+struct point_cloud_s;
+typedef struct point_cloud_s point_cloud_t;
+
+int point_cloud_build(const char *filename, size_t num_points, double *points,
+		      size_t node_capacity);
+point_cloud_t *point_cloud_open(const char *filename);
+int point_cloud_destroy(point_cloud_t *point_cloud);
+size_t point_cloud_size(point_cloud_t *point_cloud);
+size_t point_cloud_budget_get(point_cloud_t *point_cloud);
+int point_cloud_budget_set(point_cloud_t *point_cloud, size_t budget);
+size_t point_cloud_cache_get(point_cloud_t *point_cloud);
+int point_cloud_cache_set(point_cloud_t *point_cloud, size_t cache);
+int point_cloud_style(point_cloud_t *point_cloud, double color[4],
+		      double width);
+int point_cloud_update(point_cloud_t *point_cloud, camera_t *camera);
+draw_list_t *point_cloud_draw_list(point_cloud_t *point_cloud);
+size_t point_cloud_drawn(point_cloud_t *point_cloud);
+int point_cloud_render(point_cloud_t *point_cloud, cairo_t *cr,
+		       camera_t *camera);
+
+#endif
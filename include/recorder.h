@@ -0,0 +1,29 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "camera.h"
+#include "drawlist.h"
+
+struct recorder_s;
+typedef struct recorder_s recorder_t;
+struct player_s;
+typedef struct player_s player_t;
+
+recorder_t *recorder_create(const char *filename, bool compress);
+int recorder_destroy(recorder_t *recorder);
+int recorder_keyframe_interval_set(recorder_t *recorder, size_t interval);
+int recorder_frame(recorder_t *recorder, camera_t *camera, size_t num,
+		   draw_list_t **draw_lists);
+
+player_t *player_open(const char *filename);
+int player_destroy(player_t *player);
+size_t player_length(player_t *player);
+int player_seek(player_t *player, size_t frame);
+size_t player_draw_list_count(player_t *player);
+draw_list_t *player_draw_list_get(player_t *player, size_t index);
+int player_camera_get(player_t *player, camera_t *camera);
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <cairo/cairo.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "camera.h"
+#include "drawlist.h"
+
+struct scheduler_s;
+typedef struct scheduler_s scheduler_t;
+
+// lists of this priority are drawn every frame, larger values are optional
+// and less important
+#define SCHEDULER_PRIORITY_REQUIRED 0
+
+scheduler_t *scheduler_create(double budget);
+int scheduler_destroy(scheduler_t *scheduler);
+double scheduler_budget_get(scheduler_t *scheduler);
+int scheduler_budget_set(scheduler_t *scheduler, double budget);
+int scheduler_render(scheduler_t *scheduler, cairo_t *cr, camera_t *camera,
+		     size_t num, draw_list_t **draw_lists,
+		     const int *priorities, bool *skipped);
+size_t scheduler_skipped_count(scheduler_t *scheduler);
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stdbool.h>
+
+// the vector kernels are built for several instruction sets, the best one
+// supported by the cpu is picked at load time unless DRAWING3D_ISA names
+// another one (sse2, avx2, avx512 on x86_64, neon on aarch64, generic)
+const char *simd_isa_get();
+int simd_isa_set(const char *isa);
+bool simd_isa_supported(const char *isa);
+
+#endif
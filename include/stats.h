@@ -0,0 +1,51 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+
+// number of frames kept by a window, older frames are overwritten
+#define STATS_FRAMES 128
+
+typedef enum {
+	// time between two presented frames
+	STATS_TIMER_FRAME,
+	STATS_TIMER_CAMERA_UPDATE,
+	// projection passes of occlusion culling and depth sorting
+	STATS_TIMER_OCCLUDERS,
+	STATS_TIMER_SORT,
+	// render stages, including the projection of their points
+	STATS_TIMER_LINE,
+	STATS_TIMER_POINT,
+	STATS_TIMER_POLYGON,
+	STATS_TIMER_POLYLINE,
+	STATS_TIMER_STYLE,
+	STATS_TIMER_CLEAR,
+	// grids, circles and boxes, expanded at render time
+	STATS_TIMER_PROCEDURAL,
+	STATS_TIMER_WINDOW_CLEAR,
+	STATS_TIMER_UPLOAD,
+	STATS_TIMER_PRESENT,
+	STATS_TIMER_COUNT,
+} stats_timer_t;
+
+typedef enum {
+	STATS_COUNTER_PRIMITIVES,
+	STATS_COUNTER_VERTICES,
+	// vertices behind the camera or hidden by occluders
+	STATS_COUNTER_CULLED,
+	STATS_COUNTER_STROKES,
+	STATS_COUNTER_FILLS,
+	STATS_COUNTER_COUNT,
+} stats_counter_t;
+
+typedef struct {
+	uint64_t frame;
+	// seconds
+	double timers[STATS_TIMER_COUNT];
+	uint64_t counters[STATS_COUNTER_COUNT];
+} frame_stats_t;
+
+int stats_begin(frame_stats_t *stats);
+int stats_end();
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "drawlist.h"
+
+struct stream_server_s;
+typedef struct stream_server_s stream_server_t;
+struct stream_client_s;
+typedef struct stream_client_s stream_client_t;
+
+stream_server_t *stream_server_create(const char *path);
+int stream_server_destroy(stream_server_t *server);
+int stream_server_poll(stream_server_t *server, int timeout);
+size_t stream_server_budget_get(stream_server_t *server);
+int stream_server_budget_set(stream_server_t *server, size_t budget);
+size_t stream_server_layer_count(stream_server_t *server);
+const char *stream_server_layer_name(stream_server_t *server, size_t index);
+draw_list_t *stream_server_layer_get(stream_server_t *server, size_t index);
+draw_list_t *stream_server_layer_find(stream_server_t *server,
+				      const char *name);
+
+stream_client_t *stream_client_connect(const char *path);
+int stream_client_destroy(stream_client_t *client);
+int stream_client_layer(stream_client_t *client, const char *name);
+int stream_client_primitive(stream_client_t *client, primitive_type_t type,
+			    size_t num, double *data);
+int stream_client_draw_list(stream_client_t *client, draw_list_t *draw_list);
+int stream_client_commit(stream_client_t *client);
+int stream_client_flush(stream_client_t *client);
+
+#endif
@@ -5,11 +5,22 @@
 #include "eventlist.h"
 #include "drawlist.h"
 #include "keymapping.h"
+#include "scheduler.h"
+#include "stats.h"
 
 struct window_s;
 typedef struct window_s window_t;
 
+typedef enum {
+	// a resizable sdl window with an accelerated renderer
+	WINDOW_BACKEND_SDL,
+	// an offscreen image surface, needs no display or gpu
+	WINDOW_BACKEND_HEADLESS,
+} window_backend_t;
+
 window_t *window_create(int width, int height, char *title);
+window_t *window_create2(int width, int height, char *title,
+			 window_backend_t backend);
 int window_destroy(window_t *window);
 int window_surface_init(window_t *window);
 int window_surface_destroy(window_t *window);
@@ -17,7 +28,17 @@ int window_clear(window_t *window);
 int window_render(window_t *window, draw_list_t *draw_list);
 int window_render_at(window_t *window, draw_list_t *draw_list, double x,
 		     double y, double z, double rx, double ry, double rz);
+int window_render_scheduled(window_t *window, scheduler_t *scheduler,
+			    size_t num, draw_list_t **draw_lists,
+			    const int *priorities, bool *skipped);
 int window_render_end(window_t *window);
+int window_thread_start(window_t *window, size_t queue_length);
+int window_thread_stop(window_t *window);
+window_backend_t window_backend_get(window_t *window);
+bool window_threaded_get(window_t *window);
+size_t window_frames_presented_get(window_t *window);
+size_t window_frames_dropped_get(window_t *window);
+size_t window_stats_get(window_t *window, size_t num, frame_stats_t *stats);
 int window_handle_events(window_t *window, event_list_t *event_list);
 int window_do_key_action(window_t *window, key_action_t action);
 camera_t *window_camera_get(window_t *window);
@@ -31,5 +52,12 @@ double window_wheel_sensitivity_get(window_t *window);
 int window_wheel_sensitivity_set(window_t *window, double sensitivity);
 double window_key_sensitivity_get(window_t *window);
 int window_key_sensitivity_set(window_t *window, double sensitivity);
+bool window_progressive_get(window_t *window);
+int window_progressive_set(window_t *window, bool progressive);
+double window_progressive_delay_get(window_t *window);
+int window_progressive_delay_set(window_t *window, double delay);
+size_t window_progressive_step_get(window_t *window);
+int window_progressive_step_set(window_t *window, size_t step);
+size_t window_decimation_get(window_t *window);
 
 #endif
\ No newline at end of file
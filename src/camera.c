@@ -1,4 +1,6 @@
 #include "camera.h"
+#include "camera_private.h"
+#include "simd_private.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -272,6 +274,49 @@ int camera_preserve_ratio_set(camera_t *camera, bool preserve_ratio)
 	return 0;
 }
 
+int camera_state_get(camera_t *camera, double state[CAMERA_STATE_LEN])
+{
+	// flat snapshot of every parameter, in a fixed order
+	double *s = state;
+	*s++ = camera->width;
+	*s++ = camera->height;
+	memcpy(s, camera->position, sizeof(double) * 3);
+	s += 3;
+	memcpy(s, camera->rotation, sizeof(double) * 3);
+	s += 3;
+	memcpy(s, camera->wposition, sizeof(double) * 3);
+	s += 3;
+	memcpy(s, camera->wrotation, sizeof(double) * 3);
+	s += 3;
+	*s++ = camera->distance;
+	memcpy(s, camera->mi, sizeof(double) * 16);
+	s += 16;
+	*s++ = camera->preserve_ratio ? 1.0 : 0.0;
+	*s++ = camera->ratio;
+	return 0;
+}
+
+int camera_state_set(camera_t *camera, double state[CAMERA_STATE_LEN])
+{
+	double *s = state;
+	camera->width = *s++;
+	camera->height = *s++;
+	memcpy(camera->position, s, sizeof(double) * 3);
+	s += 3;
+	memcpy(camera->rotation, s, sizeof(double) * 3);
+	s += 3;
+	memcpy(camera->wposition, s, sizeof(double) * 3);
+	s += 3;
+	memcpy(camera->wrotation, s, sizeof(double) * 3);
+	s += 3;
+	camera->distance = *s++;
+	memcpy(camera->mi, s, sizeof(double) * 16);
+	s += 16;
+	camera->preserve_ratio = *s++ != 0.0;
+	camera->ratio = *s++;
+	return 0;
+}
+
 bool camera_project(camera_t *camera, double *p, double *q)
 {
 	double p1[4] = { p[0], p[1], p[2], 1.0 };
@@ -282,6 +327,26 @@ bool camera_project(camera_t *camera, double *p, double *q)
 	return p2[3] > 0.0;
 }
 
+bool camera_project_depth(camera_t *camera, double *p, double *q,
+			  double *depth)
+{
+	double p1[4] = { p[0], p[1], p[2], 1.0 };
+	double p2[4] = { 0.0, 0.0, 0.0, 0.0 };
+	matmul(camera->m, p1, p2, 4, 4, 1);
+	q[0] = p2[0] / p2[3];
+	q[1] = p2[1] / p2[3];
+	// view space depth, valid for both perspective and orthographic
+	*depth = p2[2];
+	return p2[3] > 0.0;
+}
+
+int camera_project_points(camera_t *camera, size_t num, double *points,
+			  double *q, double *depth, bool *visible)
+{
+	_simd->project(camera->m, num, points, q, depth, visible);
+	return 0;
+}
+
 int camera_update(camera_t *camera)
 {
 	double acc[16];
@@ -342,6 +407,20 @@ int camera_update(camera_t *camera)
 	return 0;
 }
 
+void _camera_matmul4(const double *a, const double *b, double *c)
+{
+	matmul((double *)a, (double *)b, c, 4, 4, 4);
+}
+
+void _camera_pose_matrix(double m[16], double x, double y, double z,
+			 double rx, double ry, double rz)
+{
+	double r[16], t[16];
+	rotxyz(r, rx, ry, rz);
+	translate(t, x, y, z);
+	matmul(t, r, m, 4, 4, 4);
+}
+
 static int matmul(double *a, double *b, double *restrict c, int n, int m, int r)
 {
 	// a: n x m
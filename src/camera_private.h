@@ -0,0 +1,15 @@
+#ifndef CAMERA_PRIVATE_H
+#define CAMERA_PRIVATE_H
+
+// camera internals shared between the library sources, not installed
+
+#include "camera.h"
+
+// c = a * b for row major 4x4 matrices
+void _camera_matmul4(const double *a, const double *b, double *c);
+
+// translation after a rotation about x, y and z, like the object pose
+void _camera_pose_matrix(double m[16], double x, double y, double z,
+			 double rx, double ry, double rz);
+
+#endif
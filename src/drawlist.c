@@ -1,24 +1,56 @@
 #include "drawlist.h"
+#include "camera_private.h"
+#include "drawlist_private.h"
+#include "hiz.h"
+#include "stats_private.h"
 
+#include <fcntl.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-struct primitive_s {
-	primitive_type_t type;
-	size_t index;
-	size_t length;
-};
-
-struct draw_list_s {
-	size_t length;
-	size_t length_saved;
-	size_t capacity;
-	size_t buffer_length;
-	size_t buffer_length_saved;
-	size_t buffer_capacity;
-	primitive_t *primitives;
-	double *buffer;
-};
+#define DRAW_LIST_FILE_MAGIC "D3DLIST"
+#define DRAW_LIST_FILE_VERSION 1
+#define DRAW_LIST_FILE_ALIGN 64
+// points projected at once, small enough to stay in the l1 cache
+#define DRAW_LIST_PROJECT_BATCH 256
+// smallest on screen spacing of grid lines and length of circle segments
+#define DRAW_LIST_GRID_SPACING 4.0
+#define DRAW_LIST_ARC_PIXELS 4.0
+
+#define PI 3.14159265358979323846
+
+typedef struct {
+	double q[DRAW_LIST_PROJECT_BATCH * 2];
+	// gathered input points of decimated primitives
+	double p[DRAW_LIST_PROJECT_BATCH * 3];
+	double depth[DRAW_LIST_PROJECT_BATCH];
+	bool visible[DRAW_LIST_PROJECT_BATCH];
+} projection_batch_t;
+
+// little-endian on-disk layout, the primitive table and the buffer follow
+// at aligned offsets and are stored exactly as they are in memory
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t header_size;
+	uint64_t length;
+	uint64_t buffer_length;
+	uint64_t primitives_offset;
+	uint64_t buffer_offset;
+	uint32_t primitive_size;
+	uint32_t reserved0;
+	uint64_t reserved1;
+} draw_list_file_header_t;
+
+static atomic_ullong _draw_list_serials;
+// bumped on any change of any list or child transform
+static atomic_ullong _draw_list_epoch;
 
 draw_list_t *draw_list_create()
 {
@@ -32,262 +64,2811 @@ draw_list_t *draw_list_create()
 	draw_list->buffer_length_saved = 0;
 	draw_list->buffer_capacity = 4;
 	draw_list->buffer = malloc(sizeof(double) * draw_list->buffer_capacity);
+	draw_list->depth_sort = false;
+	draw_list->sort_length = 0;
+	draw_list->sort_capacity = 0;
+	draw_list->sort_items = NULL;
+	draw_list->sort_keys = NULL;
+	draw_list->sort_keys_tmp = NULL;
+	draw_list->sort_order = NULL;
+	draw_list->sort_order_tmp = NULL;
+	draw_list->sort_points_length = 0;
+	draw_list->sort_points_capacity = 0;
+	draw_list->sort_points = NULL;
+	draw_list->occlusion = false;
+	draw_list->occluder_area = 4096.0;
+	draw_list->hiz = NULL;
+	draw_list->hiz_active = false;
+	draw_list->quality = RENDER_QUALITY_FULL;
+	draw_list->raster_active = false;
+	draw_list->decimation = 1;
+	draw_list->packed = false;
+	draw_list->num_runs = 0;
+	draw_list->runs_capacity = 0;
+	draw_list->runs = NULL;
+	draw_list->num_spans = 0;
+	draw_list->spans_capacity = 0;
+	draw_list->spans = NULL;
+	draw_list->runs_version = 0;
+	draw_list->runs_valid = false;
+	draw_list->num_children = 0;
+	draw_list->num_children_saved = 0;
+	draw_list->children_capacity = 0;
+	draw_list->children = NULL;
+	draw_list->copies_capacity = 0;
+	draw_list->copies = NULL;
+	draw_list->world = NULL;
+	draw_list->view = NULL;
+	draw_list->bounds_version = 0;
+	draw_list->bounds_valid = false;
+	draw_list->subtree_epoch = 0;
+	draw_list->subtree_valid = false;
+	draw_list->time = NAN;
+	draw_list->times_length = 0;
+	draw_list->times_length_saved = 0;
+	draw_list->times_capacity = 0;
+	draw_list->times = NULL;
+	draw_list->vertex_times_length = 0;
+	draw_list->vertex_times_length_saved = 0;
+	draw_list->vertex_times_capacity = 0;
+	draw_list->vertex_times = NULL;
+	draw_list->times_sorted = true;
+	draw_list->times_sorted_saved = true;
+	draw_list->untimed_prefix = 0;
+	draw_list->untimed_prefix_saved = 0;
+	draw_list->time_window[0] = -INFINITY;
+	draw_list->time_window[1] = INFINITY;
+	_pick_index_init(&draw_list->pick);
+	draw_list->expanded_capacity = 0;
+	draw_list->expanded = NULL;
+	draw_list->mapping = NULL;
+	draw_list->mapping_size = 0;
+	draw_list->storage = NULL;
+	draw_list->num_checkpoints = 0;
+	draw_list->checkpoints_capacity = 0;
+	draw_list->checkpoints = NULL;
+	draw_list->version = 0;
+	draw_list->serial = atomic_fetch_add(&_draw_list_serials, 1) + 1;
+	draw_list->shared = NULL;
+	draw_list->shared_size = 0;
+	draw_list->shared_name = NULL;
+	draw_list->shared_slot = 0;
+	draw_list->shared_writer = false;
+	draw_list->shared_slot_offset = 0;
+	draw_list->shared_slot_size = 0;
+	draw_list->shared_buffer_offset = 0;
+	draw_list->shared_low = 0;
+	draw_list->shared_buffer_low = 0;
+	memset(draw_list->shared_kept, 0, sizeof(draw_list->shared_kept));
+	memset(draw_list->shared_buffer_kept, 0,
+	       sizeof(draw_list->shared_buffer_kept));
 	return draw_list;
 }
 
+static void _draw_list_storage_release(draw_list_storage_t *storage)
+{
+	if (atomic_fetch_sub(&storage->references, 1) > 1)
+		return;
+	if (storage->mapping != NULL) {
+		munmap(storage->mapping, storage->mapping_size);
+	} else {
+		free(storage->primitives);
+		free(storage->buffer);
+	}
+	free(storage);
+}
+
 int draw_list_destroy(draw_list_t *draw_list)
 {
-	free(draw_list->primitives);
-	free(draw_list->buffer);
+	for (size_t i = 0; i < draw_list->num_checkpoints; i++) {
+		free(draw_list->checkpoints[i].name);
+		draw_list_destroy(draw_list->checkpoints[i].snapshot);
+	}
+	free(draw_list->checkpoints);
+	if (draw_list->storage != NULL) {
+		_draw_list_storage_release(draw_list->storage);
+	} else if (draw_list->mapping != NULL) {
+		munmap(draw_list->mapping, draw_list->mapping_size);
+	} else if (draw_list->shared != NULL) {
+		_draw_list_shared_close(draw_list);
+	} else {
+		free(draw_list->primitives);
+		free(draw_list->buffer);
+	}
+	free(draw_list->sort_items);
+	free(draw_list->sort_keys);
+	free(draw_list->sort_keys_tmp);
+	free(draw_list->sort_order);
+	free(draw_list->sort_order_tmp);
+	free(draw_list->sort_points);
+	free(draw_list->expanded);
+	free(draw_list->runs);
+	free(draw_list->spans);
+	free(draw_list->children);
+	for (size_t i = 0; i < draw_list->copies_capacity; i++) {
+		if (draw_list->copies[i] != NULL)
+			draw_list_destroy(draw_list->copies[i]);
+	}
+	free(draw_list->copies);
+	free(draw_list->times);
+	free(draw_list->vertex_times);
+	_pick_index_free(&draw_list->pick);
+	if (draw_list->hiz != NULL)
+		hiz_destroy(draw_list->hiz);
 	free(draw_list);
 	return 0;
 }
 
+void _draw_list_changed(draw_list_t *draw_list)
+{
+	draw_list->version++;
+	atomic_fetch_add(&_draw_list_epoch, 1);
+}
+
 int draw_list_save(draw_list_t *draw_list)
 {
 	draw_list->length_saved = draw_list->length;
 	draw_list->buffer_length_saved = draw_list->buffer_length;
+	draw_list->num_children_saved = draw_list->num_children;
+	draw_list->times_length_saved = draw_list->times_length;
+	draw_list->vertex_times_length_saved = draw_list->vertex_times_length;
+	draw_list->times_sorted_saved = draw_list->times_sorted;
+	draw_list->untimed_prefix_saved = draw_list->untimed_prefix;
+	return 0;
+}
+
+int draw_list_load(draw_list_t *draw_list)
+{
+	// the contents up to the saved lengths never change, so nothing is
+	// restored when nothing was appended since
+	bool changed =
+		draw_list->length != draw_list->length_saved ||
+		draw_list->buffer_length != draw_list->buffer_length_saved ||
+		draw_list->num_children != draw_list->num_children_saved ||
+		draw_list->times_length != draw_list->times_length_saved ||
+		draw_list->vertex_times_length !=
+			draw_list->vertex_times_length_saved;
+	draw_list->length = draw_list->length_saved;
+	draw_list->buffer_length = draw_list->buffer_length_saved;
+	draw_list->num_children = draw_list->num_children_saved;
+	draw_list->times_length = draw_list->times_length_saved;
+	draw_list->vertex_times_length = draw_list->vertex_times_length_saved;
+	draw_list->times_sorted = draw_list->times_sorted_saved;
+	draw_list->untimed_prefix = draw_list->untimed_prefix_saved;
+	if (changed)
+		_draw_list_changed(draw_list);
+	_draw_list_shared_truncated(draw_list);
+	return 0;
+}
+
+bool draw_list_depth_sort_get(draw_list_t *draw_list)
+{
+	return draw_list->depth_sort;
+}
+
+int draw_list_depth_sort_set(draw_list_t *draw_list, bool depth_sort)
+{
+	draw_list->depth_sort = depth_sort;
+	draw_list->sort_length = 0;
+	return 0;
+}
+
+bool draw_list_occlusion_get(draw_list_t *draw_list)
+{
+	return draw_list->occlusion;
+}
+
+int draw_list_occlusion_set(draw_list_t *draw_list, bool occlusion)
+{
+	if (occlusion && draw_list->hiz == NULL) {
+		draw_list->hiz = hiz_create();
+		if (draw_list->hiz == NULL)
+			return 1;
+	}
+	draw_list->occlusion = occlusion;
+	return 0;
+}
+
+double draw_list_occluder_area_get(draw_list_t *draw_list)
+{
+	return draw_list->occluder_area;
+}
+
+int draw_list_occluder_area_set(draw_list_t *draw_list, double area)
+{
+	draw_list->occluder_area = area;
+	return 0;
+}
+
+render_quality_t draw_list_quality_get(draw_list_t *draw_list)
+{
+	return draw_list->quality;
+}
+
+int draw_list_quality_set(draw_list_t *draw_list, render_quality_t quality)
+{
+	if (quality < RENDER_QUALITY_FULL || quality > RENDER_QUALITY_DIRECT)
+		return 1;
+	draw_list->quality = quality;
+	return 0;
+}
+
+size_t draw_list_decimation_get(draw_list_t *draw_list)
+{
+	return draw_list->decimation;
+}
+
+int draw_list_decimation_set(draw_list_t *draw_list, size_t step)
+{
+	if (step < 1)
+		return 1;
+	draw_list->decimation = step;
+	return 0;
+}
+
+bool draw_list_packed_get(draw_list_t *draw_list)
+{
+	return draw_list->packed;
+}
+
+int draw_list_packed_set(draw_list_t *draw_list, bool packed)
+{
+	draw_list->packed = packed;
+	return 0;
+}
+
+static int _draw_list_unmap(draw_list_t *draw_list)
+{
+	// move the mapped contents to the heap before the first modification
+	size_t capacity = draw_list->length > 2 ? draw_list->length * 2 : 4;
+	size_t buffer_capacity =
+		draw_list->buffer_length > 2 ? draw_list->buffer_length * 2 : 4;
+	primitive_t *primitives = malloc(sizeof(primitive_t) * capacity);
+	double *buffer = malloc(sizeof(double) * buffer_capacity);
+	if (primitives == NULL || buffer == NULL) {
+		free(primitives);
+		free(buffer);
+		return 1;
+	}
+	memcpy(primitives, draw_list->primitives,
+	       sizeof(primitive_t) * draw_list->length);
+	memcpy(buffer, draw_list->buffer,
+	       sizeof(double) * draw_list->buffer_length);
+	munmap(draw_list->mapping, draw_list->mapping_size);
+	draw_list->mapping = NULL;
+	draw_list->mapping_size = 0;
+	draw_list->primitives = primitives;
+	draw_list->capacity = capacity;
+	draw_list->buffer = buffer;
+	draw_list->buffer_capacity = buffer_capacity;
+	return 0;
+}
+
+static bool _draw_list_claim(atomic_size_t *written, size_t from, size_t to)
+{
+	// writing from the end of everything written so far leaves the other
+	// lists alone, claiming the range keeps them from writing there too
+	if (to <= from)
+		return true;
+	return atomic_compare_exchange_strong(written, &from, to);
+}
+
+static int _draw_list_unshare(draw_list_t *draw_list, size_t length,
+			      size_t buffer_length, bool tail)
+{
+	// make the arrays writable up to length primitives and buffer_length
+	// doubles, tail writes only start at the current lengths and must fit
+	// without growing, as the storage arrays are never moved
+	draw_list_storage_t *storage = draw_list->storage;
+	if (atomic_load(&storage->references) == 1) {
+		draw_list->mapping = storage->mapping;
+		draw_list->mapping_size = storage->mapping_size;
+		draw_list->storage = NULL;
+		free(storage);
+		return 0;
+	}
+	if (tail && storage->mapping == NULL &&
+	    length < storage->capacity &&
+	    buffer_length < storage->buffer_capacity &&
+	    _draw_list_claim(&storage->length, draw_list->length, length) &&
+	    _draw_list_claim(&storage->buffer_length, draw_list->buffer_length,
+			     buffer_length))
+		return 0;
+	if (length < draw_list->length)
+		length = draw_list->length;
+	if (buffer_length < draw_list->buffer_length)
+		buffer_length = draw_list->buffer_length;
+	size_t capacity = length > 2 ? length * 2 : 4;
+	size_t buffer_capacity = buffer_length > 2 ? buffer_length * 2 : 4;
+	primitive_t *primitives = malloc(sizeof(primitive_t) * capacity);
+	double *buffer = malloc(sizeof(double) * buffer_capacity);
+	if (primitives == NULL || buffer == NULL) {
+		free(primitives);
+		free(buffer);
+		return 1;
+	}
+	memcpy(primitives, draw_list->primitives,
+	       sizeof(primitive_t) * draw_list->length);
+	memcpy(buffer, draw_list->buffer,
+	       sizeof(double) * draw_list->buffer_length);
+	_draw_list_storage_release(storage);
+	draw_list->storage = NULL;
+	draw_list->primitives = primitives;
+	draw_list->capacity = capacity;
+	draw_list->buffer = buffer;
+	draw_list->buffer_capacity = buffer_capacity;
+	return 0;
+}
+
+int draw_list_empty(draw_list_t *draw_list)
+{
+	draw_list->length = 0;
+	draw_list->buffer_length = 0;
+	draw_list->length_saved = 0;
+	draw_list->buffer_length_saved = 0;
+	draw_list->num_children = 0;
+	draw_list->num_children_saved = 0;
+	draw_list->times_length = 0;
+	draw_list->times_length_saved = 0;
+	draw_list->vertex_times_length = 0;
+	draw_list->vertex_times_length_saved = 0;
+	draw_list->times_sorted = true;
+	draw_list->times_sorted_saved = true;
+	draw_list->untimed_prefix = 0;
+	draw_list->untimed_prefix_saved = 0;
+	_draw_list_changed(draw_list);
+	_draw_list_shared_truncated(draw_list);
+	if (draw_list->storage != NULL &&
+	    _draw_list_unshare(draw_list, 0, 0, false))
+		return 1;
+	if (draw_list->mapping != NULL)
+		return _draw_list_unmap(draw_list);
+	return 0;
+}
+
+int draw_list_buffer_allocate(draw_list_t *draw_list, size_t num)
+{
+	if (num > SIZE_MAX / sizeof(double) / 4 - draw_list->buffer_length)
+		return 1;
+	if (draw_list->storage != NULL &&
+	    _draw_list_unshare(draw_list, draw_list->length,
+			       draw_list->buffer_length + num, true))
+		return 1;
+	if (draw_list->mapping != NULL && _draw_list_unmap(draw_list))
+		return 1;
+	// shared segments have a fixed size and are read-only for viewers
+	if (draw_list->shared != NULL)
+		return !draw_list->shared_writer ||
+		       draw_list->buffer_length + num >=
+			       draw_list->buffer_capacity;
+	if (draw_list->buffer_length + num >= draw_list->buffer_capacity) {
+		// growing moves the array, so it has to be our own first
+		if (draw_list->storage != NULL &&
+		    _draw_list_unshare(draw_list, draw_list->length,
+				       draw_list->buffer_length + num, false))
+			return 1;
+		size_t capacity = draw_list->buffer_capacity;
+		while (draw_list->buffer_length + num >= capacity)
+			capacity *= 2;
+		double *buffer =
+			realloc(draw_list->buffer, sizeof(double) * capacity);
+		if (buffer == NULL)
+			return 1;
+		draw_list->buffer = buffer;
+		draw_list->buffer_capacity = capacity;
+	}
+	return 0;
+}
+
+int _draw_list_reserve(draw_list_t *draw_list, size_t length,
+		       size_t buffer_length)
+{
+	if (draw_list->storage != NULL &&
+	    _draw_list_unshare(draw_list, length, buffer_length, false))
+		return 1;
+	if (draw_list->mapping != NULL && _draw_list_unmap(draw_list))
+		return 1;
+	if (draw_list->shared != NULL)
+		return !draw_list->shared_writer ||
+		       length > draw_list->capacity ||
+		       buffer_length >= draw_list->buffer_capacity;
+	if (length > draw_list->capacity) {
+		size_t capacity = draw_list->capacity;
+		while (length > capacity)
+			capacity *= 2;
+		primitive_t *primitives = realloc(
+			draw_list->primitives, sizeof(primitive_t) * capacity);
+		if (primitives == NULL)
+			return 1;
+		draw_list->primitives = primitives;
+		draw_list->capacity = capacity;
+	}
+	if (buffer_length >= draw_list->buffer_capacity) {
+		size_t capacity = draw_list->buffer_capacity;
+		while (buffer_length >= capacity)
+			capacity *= 2;
+		double *buffer =
+			realloc(draw_list->buffer, sizeof(double) * capacity);
+		if (buffer == NULL)
+			return 1;
+		draw_list->buffer = buffer;
+		draw_list->buffer_capacity = capacity;
+	}
+	return 0;
+}
+
+static void _draw_list_times_move(draw_list_t *dst, draw_list_t *src)
+{
+	// timestamps follow the primitives they belong to
+	dst->times_length = src->times_length;
+	dst->times_length_saved = src->times_length_saved;
+	dst->times_capacity = src->times_capacity;
+	dst->times = src->times;
+	dst->vertex_times_length = src->vertex_times_length;
+	dst->vertex_times_length_saved = src->vertex_times_length_saved;
+	dst->vertex_times_capacity = src->vertex_times_capacity;
+	dst->vertex_times = src->vertex_times;
+	dst->times_sorted = src->times_sorted;
+	dst->times_sorted_saved = src->times_sorted_saved;
+	dst->untimed_prefix = src->untimed_prefix;
+	dst->untimed_prefix_saved = src->untimed_prefix_saved;
+}
+
+static int _draw_list_times_copy(draw_list_t *dst, draw_list_t *src)
+{
+	if (src->times_length > dst->times_capacity) {
+		size_t size = sizeof(primitive_time_t) * src->times_length;
+		primitive_time_t *times = realloc(dst->times, size);
+		if (times == NULL)
+			return 1;
+		dst->times = times;
+		dst->times_capacity = src->times_length;
+	}
+	if (src->vertex_times_length > dst->vertex_times_capacity) {
+		double *vertex_times =
+			realloc(dst->vertex_times,
+				sizeof(double) * src->vertex_times_length);
+		if (vertex_times == NULL)
+			return 1;
+		dst->vertex_times = vertex_times;
+		dst->vertex_times_capacity = src->vertex_times_length;
+	}
+	if (src->times_length > 0)
+		memcpy(dst->times, src->times,
+		       sizeof(primitive_time_t) * src->times_length);
+	if (src->vertex_times_length > 0)
+		memcpy(dst->vertex_times, src->vertex_times,
+		       sizeof(double) * src->vertex_times_length);
+	dst->times_length = src->times_length;
+	dst->times_length_saved = src->times_length_saved;
+	dst->vertex_times_length = src->vertex_times_length;
+	dst->vertex_times_length_saved = src->vertex_times_length_saved;
+	dst->times_sorted = src->times_sorted;
+	dst->times_sorted_saved = src->times_sorted_saved;
+	dst->untimed_prefix = src->untimed_prefix;
+	dst->untimed_prefix_saved = src->untimed_prefix_saved;
+	return 0;
+}
+
+static bool _draw_list_reachable(draw_list_t *from, draw_list_t *to)
+{
+	if (from == to)
+		return true;
+	for (size_t i = 0; i < from->num_children; i++) {
+		if (_draw_list_reachable(from->children[i].draw_list, to))
+			return true;
+	}
+	return false;
+}
+
+int _draw_list_swap(draw_list_t *a, draw_list_t *b)
+{
+	if (a->mapping != NULL || b->mapping != NULL || a->shared != NULL ||
+	    b->shared != NULL)
+		return 1;
+	// the children move along and must not end up below themselves
+	for (size_t i = 0; i < a->num_children; i++) {
+		if (_draw_list_reachable(a->children[i].draw_list, b))
+			return 1;
+	}
+	for (size_t i = 0; i < b->num_children; i++) {
+		if (_draw_list_reachable(b->children[i].draw_list, a))
+			return 1;
+	}
+	draw_list_t tmp = *a;
+	a->length = b->length;
+	a->length_saved = b->length_saved;
+	a->capacity = b->capacity;
+	a->primitives = b->primitives;
+	a->buffer_length = b->buffer_length;
+	a->buffer_length_saved = b->buffer_length_saved;
+	a->buffer_capacity = b->buffer_capacity;
+	a->buffer = b->buffer;
+	a->storage = b->storage;
+	a->num_children = b->num_children;
+	a->num_children_saved = b->num_children_saved;
+	a->children_capacity = b->children_capacity;
+	a->children = b->children;
+	a->copies_capacity = b->copies_capacity;
+	a->copies = b->copies;
+	_draw_list_times_move(a, b);
+	_draw_list_changed(a);
+	b->length = tmp.length;
+	b->length_saved = tmp.length_saved;
+	b->capacity = tmp.capacity;
+	b->primitives = tmp.primitives;
+	b->buffer_length = tmp.buffer_length;
+	b->buffer_length_saved = tmp.buffer_length_saved;
+	b->buffer_capacity = tmp.buffer_capacity;
+	b->buffer = tmp.buffer;
+	b->storage = tmp.storage;
+	b->num_children = tmp.num_children;
+	b->num_children_saved = tmp.num_children_saved;
+	b->children_capacity = tmp.children_capacity;
+	b->children = tmp.children;
+	b->copies_capacity = tmp.copies_capacity;
+	b->copies = tmp.copies;
+	_draw_list_times_move(b, &tmp);
+	_draw_list_changed(b);
+	return 0;
+}
+
+static int _draw_list_children_reserve(draw_list_t *draw_list, size_t num)
+{
+	if (num <= draw_list->children_capacity)
+		return 0;
+	size_t capacity =
+		draw_list->children_capacity > 0 ? draw_list->children_capacity
+						 : 4;
+	while (num > capacity)
+		capacity *= 2;
+	draw_list_child_t *children = realloc(
+		draw_list->children, sizeof(draw_list_child_t) * capacity);
+	if (children == NULL)
+		return 1;
+	draw_list->children = children;
+	draw_list->children_capacity = capacity;
+	return 0;
+}
+
+static int _draw_list_settings_copy(draw_list_t *dst, draw_list_t *src)
+{
+	dst->depth_sort = src->depth_sort;
+	dst->occluder_area = src->occluder_area;
+	dst->quality = src->quality;
+	dst->decimation = src->decimation;
+	dst->packed = src->packed;
+	dst->time = src->time;
+	dst->time_window[0] = src->time_window[0];
+	dst->time_window[1] = src->time_window[1];
+	return draw_list_occlusion_set(dst, src->occlusion);
+}
+
+static int _draw_list_copies(draw_list_t *dst, draw_list_t *src)
+{
+	// every edge gets its own copy of the child, also when several edges
+	// refer to the same list
+	size_t num = src->num_children;
+	if (num > dst->copies_capacity) {
+		draw_list_t **copies =
+			realloc(dst->copies, sizeof(draw_list_t *) * num);
+		if (copies == NULL)
+			return 1;
+		for (size_t i = dst->copies_capacity; i < num; i++)
+			copies[i] = NULL;
+		dst->copies = copies;
+		dst->copies_capacity = num;
+	}
+	if (num > 0)
+		memcpy(dst->children, src->children,
+		       sizeof(draw_list_child_t) * num);
+	dst->num_children = num;
+	dst->num_children_saved = src->num_children_saved;
+	for (size_t i = 0; i < num; i++) {
+		if (dst->copies[i] == NULL) {
+			dst->copies[i] = draw_list_create();
+			if (dst->copies[i] == NULL)
+				return 1;
+		}
+		if (_draw_list_copy(dst->copies[i],
+				    src->children[i].draw_list))
+			return 1;
+		dst->children[i].draw_list = dst->copies[i];
+	}
+	return 0;
+}
+
+int _draw_list_copy(draw_list_t *dst, draw_list_t *src)
+{
+	if (_draw_list_reserve(dst, src->length, src->buffer_length) ||
+	    _draw_list_children_reserve(dst, src->num_children) ||
+	    _draw_list_times_copy(dst, src))
+		return 1;
+	if (_draw_list_copies(dst, src))
+		return 1;
+	memcpy(dst->primitives, src->primitives,
+	       sizeof(primitive_t) * src->length);
+	memcpy(dst->buffer, src->buffer, sizeof(double) * src->buffer_length);
+	dst->length = src->length;
+	dst->length_saved = src->length_saved;
+	dst->buffer_length = src->buffer_length;
+	dst->buffer_length_saved = src->buffer_length_saved;
+	_draw_list_changed(dst);
+	return _draw_list_settings_copy(dst, src);
+}
+
+static int _draw_list_share(draw_list_t *dst, draw_list_t *src)
+{
+	// dst drops its contents and references those of src, the arrays are
+	// copied by whichever list writes to them first
+	if (dst->shared != NULL || src->shared != NULL)
+		return 1;
+	if (dst == src)
+		return 0;
+	if (_draw_list_children_reserve(dst, src->num_children) ||
+	    _draw_list_times_copy(dst, src))
+		return 1;
+	if (src->storage == NULL) {
+		draw_list_storage_t *storage = malloc(sizeof(*storage));
+		if (storage == NULL)
+			return 1;
+		atomic_init(&storage->references, 1);
+		storage->primitives = src->primitives;
+		storage->capacity = src->capacity;
+		storage->buffer = src->buffer;
+		storage->buffer_capacity = src->buffer_capacity;
+		atomic_init(&storage->length, src->length);
+		atomic_init(&storage->buffer_length, src->buffer_length);
+		storage->mapping = src->mapping;
+		storage->mapping_size = src->mapping_size;
+		src->mapping = NULL;
+		src->mapping_size = 0;
+		src->storage = storage;
+	}
+	atomic_fetch_add(&src->storage->references, 1);
+	if (dst->storage != NULL) {
+		_draw_list_storage_release(dst->storage);
+	} else if (dst->mapping != NULL) {
+		munmap(dst->mapping, dst->mapping_size);
+	} else {
+		free(dst->primitives);
+		free(dst->buffer);
+	}
+	dst->mapping = NULL;
+	dst->mapping_size = 0;
+	dst->storage = src->storage;
+	dst->primitives = src->primitives;
+	dst->capacity = src->capacity;
+	dst->buffer = src->buffer;
+	dst->buffer_capacity = src->buffer_capacity;
+	dst->length = src->length;
+	dst->length_saved = src->length_saved;
+	dst->buffer_length = src->buffer_length;
+	dst->buffer_length_saved = src->buffer_length_saved;
+	if (src->num_children > 0)
+		memcpy(dst->children, src->children,
+		       sizeof(draw_list_child_t) * src->num_children);
+	dst->num_children = src->num_children;
+	dst->num_children_saved = src->num_children_saved;
+	_draw_list_changed(dst);
+	return 0;
+}
+
+static void _draw_list_storage_trim(draw_list_t *draw_list)
+{
+	// when the storage is only referenced by the list and its checkpoints,
+	// everything past their lengths is unused and may be appended to again
+	draw_list_storage_t *storage = draw_list->storage;
+	if (storage == NULL)
+		return;
+	size_t references = 1;
+	size_t length = draw_list->length;
+	size_t buffer_length = draw_list->buffer_length;
+	for (size_t i = 0; i < draw_list->num_checkpoints; i++) {
+		draw_list_t *snapshot = draw_list->checkpoints[i].snapshot;
+		if (snapshot->storage != storage)
+			continue;
+		references++;
+		if (snapshot->length > length)
+			length = snapshot->length;
+		if (snapshot->buffer_length > buffer_length)
+			buffer_length = snapshot->buffer_length;
+	}
+	if (atomic_load(&storage->references) != references)
+		return;
+	atomic_store(&storage->length, length);
+	atomic_store(&storage->buffer_length, buffer_length);
+}
+
+draw_list_t *draw_list_clone(draw_list_t *draw_list)
+{
+	// constant time, the contents are shared until either list writes
+	draw_list_t *clone = draw_list_create();
+	if (clone == NULL)
+		return NULL;
+	if (_draw_list_share(clone, draw_list) ||
+	    _draw_list_settings_copy(clone, draw_list)) {
+		draw_list_destroy(clone);
+		return NULL;
+	}
+	return clone;
+}
+
+int draw_list_restore(draw_list_t *draw_list, draw_list_t *snapshot)
+{
+	// the contents of snapshot, usually a clone, replace the own ones
+	if (_draw_list_share(draw_list, snapshot))
+		return 1;
+	_draw_list_storage_trim(draw_list);
+	return 0;
+}
+
+static size_t _draw_list_checkpoint_find(draw_list_t *draw_list,
+					 const char *name)
+{
+	// the latest checkpoint of that name
+	for (size_t i = draw_list->num_checkpoints; i > 0; i--) {
+		if (strcmp(draw_list->checkpoints[i - 1].name, name) == 0)
+			return i - 1;
+	}
+	return SIZE_MAX;
+}
+
+int draw_list_checkpoint_push(draw_list_t *draw_list, const char *name)
+{
+	if (draw_list->num_checkpoints == draw_list->checkpoints_capacity) {
+		size_t capacity = draw_list->checkpoints_capacity > 0 ?
+					  draw_list->checkpoints_capacity * 2 :
+					  4;
+		draw_list_checkpoint_t *checkpoints =
+			realloc(draw_list->checkpoints,
+				sizeof(draw_list_checkpoint_t) * capacity);
+		if (checkpoints == NULL)
+			return 1;
+		draw_list->checkpoints = checkpoints;
+		draw_list->checkpoints_capacity = capacity;
+	}
+	draw_list_checkpoint_t *checkpoint =
+		&draw_list->checkpoints[draw_list->num_checkpoints];
+	checkpoint->name = malloc(strlen(name) + 1);
+	checkpoint->snapshot = draw_list_clone(draw_list);
+	if (checkpoint->name == NULL || checkpoint->snapshot == NULL) {
+		free(checkpoint->name);
+		if (checkpoint->snapshot != NULL)
+			draw_list_destroy(checkpoint->snapshot);
+		return 1;
+	}
+	strcpy(checkpoint->name, name);
+	draw_list->num_checkpoints++;
+	return 0;
+}
+
+int draw_list_checkpoint_rewind(draw_list_t *draw_list, const char *name)
+{
+	// the checkpoint and the ones after it are kept
+	size_t index = _draw_list_checkpoint_find(draw_list, name);
+	if (index == SIZE_MAX)
+		return 1;
+	return draw_list_restore(draw_list,
+				 draw_list->checkpoints[index].snapshot);
+}
+
+int draw_list_checkpoint_drop(draw_list_t *draw_list, const char *name)
+{
+	size_t index = _draw_list_checkpoint_find(draw_list, name);
+	if (index == SIZE_MAX)
+		return 1;
+	free(draw_list->checkpoints[index].name);
+	draw_list_destroy(draw_list->checkpoints[index].snapshot);
+	memmove(&draw_list->checkpoints[index],
+		&draw_list->checkpoints[index + 1],
+		sizeof(draw_list_checkpoint_t) *
+			(draw_list->num_checkpoints - index - 1));
+	draw_list->num_checkpoints--;
+	_draw_list_storage_trim(draw_list);
+	return 0;
+}
+
+size_t draw_list_checkpoint_count(draw_list_t *draw_list)
+{
+	return draw_list->num_checkpoints;
+}
+
+const char *draw_list_checkpoint_name(draw_list_t *draw_list, size_t index)
+{
+	if (index >= draw_list->num_checkpoints)
+		return NULL;
+	return draw_list->checkpoints[index].name;
+}
+
+bool _draw_list_length_valid(primitive_type_t type, size_t length)
+{
+	switch (type) {
+	case PRIMITIVE_TYPE_LINE:
+		return length >= 6 && length % 6 == 0;
+	case PRIMITIVE_TYPE_POINT:
+	case PRIMITIVE_TYPE_POLYLINES:
+		return length >= 3 && length % 3 == 0;
+	case PRIMITIVE_TYPE_POLYGON:
+		return length >= 9 && length % 3 == 0;
+	case PRIMITIVE_TYPE_POLYLINE:
+		return length >= 6 && length % 3 == 0;
+	case PRIMITIVE_TYPE_STYLE:
+		return length == 5;
+	case PRIMITIVE_TYPE_CLEAR:
+		return length == 0;
+	case PRIMITIVE_TYPE_GRID:
+		return length == 11;
+	case PRIMITIVE_TYPE_CIRCLE:
+		return length == 8;
+	case PRIMITIVE_TYPE_BOX:
+		return length == 6;
+	case PRIMITIVE_TYPE_CHILD:
+		return length == 1;
+	default:
+		return false;
+	}
+}
+
+int draw_list_buffer_copy(draw_list_t *draw_list, size_t num, double *src)
+{
+	if (draw_list_buffer_allocate(draw_list, num))
+		return 1;
+	memcpy(draw_list->buffer + draw_list->buffer_length, src,
+	       sizeof(double) * num);
+	draw_list->buffer_length += num;
+	_draw_list_changed(draw_list);
+	return 0;
+}
+
+static void _draw_list_time_entry(draw_list_t *draw_list, size_t i,
+				  double begin, double end, size_t vertices)
+{
+	primitive_time_t *time = &draw_list->times[i];
+	double reach = i > 0 ? draw_list->times[i - 1].reach : -INFINITY;
+	time->vertices = vertices;
+	if (!isnan(begin)) {
+		if (i > draw_list->untimed_prefix &&
+		    begin < draw_list->times[i - 1].begin)
+			draw_list->times_sorted = false;
+		time->begin = begin;
+		time->end = end;
+		time->reach = fmax(reach, end);
+		return;
+	}
+	time->reach = reach;
+	if (i == draw_list->untimed_prefix) {
+		draw_list->untimed_prefix++;
+	} else if (draw_list->primitives[i].type == PRIMITIVE_TYPE_STYLE) {
+		// styles apply whatever the window, borrowing the previous
+		// begin keeps the order
+		time->begin = draw_list->times[i - 1].begin;
+		time->end = -INFINITY;
+		return;
+	} else {
+		draw_list->times_sorted = false;
+	}
+	time->begin = -INFINITY;
+	time->end = INFINITY;
+}
+
+static int _draw_list_time_record(draw_list_t *draw_list, double begin,
+				  double end, size_t vertices)
+{
+	// stamps the last primitive, the ones appended before the first
+	// timed primitive or written directly are untimed
+	size_t n = draw_list->length;
+	if (n > draw_list->times_capacity) {
+		size_t capacity = draw_list->times_capacity > 0 ?
+					  draw_list->times_capacity :
+					  64;
+		while (n > capacity)
+			capacity *= 2;
+		primitive_time_t *times = realloc(
+			draw_list->times, sizeof(primitive_time_t) * capacity);
+		if (times == NULL)
+			return 1;
+		draw_list->times = times;
+		draw_list->times_capacity = capacity;
+	}
+	if (draw_list->times_length >= n) {
+		draw_list->times_length = n - 1;
+		if (draw_list->untimed_prefix > n - 1)
+			draw_list->untimed_prefix = n - 1;
+	}
+	for (size_t i = draw_list->times_length; i + 1 < n; i++)
+		_draw_list_time_entry(draw_list, i, NAN, NAN, SIZE_MAX);
+	_draw_list_time_entry(draw_list, n - 1, begin, end, vertices);
+	draw_list->times_length = n;
+	return 0;
+}
+
+static int _draw_list_append_timed(draw_list_t *draw_list,
+				   primitive_type_t type, size_t num,
+				   double begin, double end, size_t vertices)
+{
+	if (draw_list->storage != NULL &&
+	    _draw_list_unshare(draw_list, draw_list->length + 1,
+			       draw_list->buffer_length, true))
+		return 1;
+	if (draw_list->mapping != NULL && _draw_list_unmap(draw_list))
+		return 1;
+	if (draw_list->shared != NULL &&
+	    (!draw_list->shared_writer ||
+	     draw_list->length == draw_list->capacity))
+		return 1;
+	if (draw_list->length == draw_list->capacity) {
+		if (draw_list->storage != NULL &&
+		    _draw_list_unshare(draw_list, draw_list->length + 1,
+				       draw_list->buffer_length, false))
+			return 1;
+	}
+	if (draw_list->length == draw_list->capacity) {
+		primitive_t *primitives =
+			realloc(draw_list->primitives,
+				sizeof(primitive_t) * draw_list->capacity * 2);
+		if (primitives == NULL)
+			return 1;
+		draw_list->primitives = primitives;
+		draw_list->capacity *= 2;
+	}
+	draw_list->primitives[draw_list->length].type = type;
+	draw_list->primitives[draw_list->length].index =
+		draw_list->buffer_length - num;
+	draw_list->primitives[draw_list->length].length = num;
+	draw_list->length++;
+	if ((draw_list->times != NULL || !isnan(begin)) &&
+	    _draw_list_time_record(draw_list, begin, end, vertices)) {
+		draw_list->length--;
+		return 1;
+	}
+	_draw_list_changed(draw_list);
 	return 0;
 }
 
-int draw_list_load(draw_list_t *draw_list)
+int draw_list_append(draw_list_t *draw_list, primitive_type_t type, size_t num)
+{
+	return _draw_list_append_timed(draw_list, type, num, draw_list->time,
+				       draw_list->time, SIZE_MAX);
+}
+
+int draw_list_points(draw_list_t *draw_list, size_t num_points,
+		     double *points)
+{
+	if (num_points < 1 || num_points > SIZE_MAX / 3)
+		return 1;
+	if (draw_list_buffer_copy(draw_list, num_points * 3, (double *)points))
+		return 1;
+	return draw_list_append(draw_list, PRIMITIVE_TYPE_POINT,
+				num_points * 3);
+}
+
+static int _draw_list_vertices_timed(draw_list_t *draw_list,
+				     primitive_type_t type, int num_points,
+				     double *points, double *times)
+{
+	// one stamp per vertex, nondecreasing so that the vertices inside a
+	// window are found by binary search
+	for (int i = 0; i < num_points; i++) {
+		if (isnan(times[i]) || (i > 0 && times[i] < times[i - 1]))
+			return 1;
+	}
+	size_t offset = draw_list->vertex_times_length;
+	size_t needed = offset + num_points;
+	if (needed > draw_list->vertex_times_capacity) {
+		size_t capacity = draw_list->vertex_times_capacity > 0 ?
+					  draw_list->vertex_times_capacity :
+					  256;
+		while (needed > capacity)
+			capacity *= 2;
+		double *vertex_times = realloc(draw_list->vertex_times,
+					       sizeof(double) * capacity);
+		if (vertex_times == NULL)
+			return 1;
+		draw_list->vertex_times = vertex_times;
+		draw_list->vertex_times_capacity = capacity;
+	}
+	memcpy(draw_list->vertex_times + offset, times,
+	       sizeof(double) * num_points);
+	if (draw_list_buffer_copy(draw_list, num_points * 3, points) ||
+	    _draw_list_append_timed(draw_list, type, num_points * 3, times[0],
+				    times[num_points - 1], offset))
+		return 1;
+	draw_list->vertex_times_length = needed;
+	return 0;
+}
+
+int draw_list_points_timed(draw_list_t *draw_list, int num_points,
+			   double *points, double *times)
+{
+	if (num_points < 1)
+		return 1;
+	return _draw_list_vertices_timed(draw_list, PRIMITIVE_TYPE_POINT,
+					 num_points, points, times);
+}
+
+int draw_list_polyline_timed(draw_list_t *draw_list, int num_points,
+			     double *points, double *times)
+{
+	if (num_points < 2)
+		return 1;
+	return _draw_list_vertices_timed(draw_list, PRIMITIVE_TYPE_POLYLINE,
+					 num_points, points, times);
+}
+
+int draw_list_lines(draw_list_t *draw_list, int num_lines, double *lines)
+{
+	if (num_lines < 1)
+		return 1;
+	if (draw_list_buffer_copy(draw_list, num_lines * 6, (double *)lines))
+		return 1;
+	return draw_list_append(draw_list, PRIMITIVE_TYPE_LINE, num_lines * 6);
+}
+
+int draw_list_line(draw_list_t *draw_list, double x1, double y1, double z1,
+		   double x2, double y2, double z2)
+{
+	double points[2][3] = { { x1, y1, z1 }, { x2, y2, z2 } };
+	if (draw_list_buffer_copy(draw_list, 6, (double *)points))
+		return 1;
+	return draw_list_append(draw_list, PRIMITIVE_TYPE_LINE, 6);
+}
+
+int draw_list_point(draw_list_t *draw_list, double x, double y, double z)
+{
+	double point[3] = { x, y, z };
+	if (draw_list_buffer_copy(draw_list, 3, (double *)point))
+		return 1;
+	return draw_list_append(draw_list, PRIMITIVE_TYPE_POINT, 3);
+}
+
+int draw_list_polygon(draw_list_t *draw_list, int num_points, double *points)
+{
+	if (num_points < 3)
+		return 1;
+	if (draw_list_buffer_copy(draw_list, num_points * 3, (double *)points))
+		return 1;
+	return draw_list_append(draw_list, PRIMITIVE_TYPE_POLYGON,
+				num_points * 3);
+}
+
+int draw_list_polyline(draw_list_t *draw_list, int num_points, double *points)
+{
+	if (num_points < 2)
+		return 1;
+	if (draw_list_buffer_copy(draw_list, num_points * 3, (double *)points))
+		return 1;
+	return draw_list_append(draw_list, PRIMITIVE_TYPE_POLYLINE,
+				num_points * 3);
+}
+
+int draw_list_polylines(draw_list_t *draw_list, int num_polylines,
+			int *offsets, double *points)
+{
+	// offsets[i] is the first point of polyline i, offsets[num_polylines]
+	// the total number of points; polylines of less than two points draw
+	// nothing and are skipped, at least one has to remain
+	if (num_polylines < 1 || offsets[0] != 0)
+		return 1;
+	size_t runs = 0, vertices = 0;
+	for (int i = 0; i < num_polylines; i++) {
+		if (offsets[i + 1] < offsets[i])
+			return 1;
+		if (offsets[i + 1] - offsets[i] >= 2) {
+			runs++;
+			vertices += offsets[i + 1] - offsets[i];
+		}
+	}
+	if (runs == 0)
+		return 1;
+	size_t num = (vertices + runs - 1) * 3;
+	if (draw_list_buffer_allocate(draw_list, num))
+		return 1;
+	double *dst = draw_list->buffer + draw_list->buffer_length;
+	for (int i = 0; i < num_polylines; i++) {
+		size_t n = (size_t)(offsets[i + 1] - offsets[i]) * 3;
+		if (n < 6)
+			continue;
+		if (dst != draw_list->buffer + draw_list->buffer_length) {
+			dst[0] = dst[1] = dst[2] = NAN;
+			dst += 3;
+		}
+		memcpy(dst, points + (size_t)offsets[i] * 3,
+		       sizeof(double) * n);
+		dst += n;
+	}
+	draw_list->buffer_length += num;
+	_draw_list_changed(draw_list);
+	return draw_list_append(draw_list, PRIMITIVE_TYPE_POLYLINES, num);
+}
+
+int draw_list_polylines2(draw_list_t *draw_list, int num_points,
+			 double *points)
+{
+	if (num_points < 2)
+		return 1;
+	if (draw_list_buffer_copy(draw_list, num_points * 3, points))
+		return 1;
+	return draw_list_append(draw_list, PRIMITIVE_TYPE_POLYLINES,
+				num_points * 3);
+}
+
+int draw_list_grid(draw_list_t *draw_list, double origin[3], double u[3],
+		   double v[3], int nu, int nv)
+{
+	if (nu < 1 || nv < 1)
+		return 1;
+	double counts[2] = { nu, nv };
+	if (draw_list_buffer_copy(draw_list, 3, origin) ||
+	    draw_list_buffer_copy(draw_list, 3, u) ||
+	    draw_list_buffer_copy(draw_list, 3, v) ||
+	    draw_list_buffer_copy(draw_list, 2, counts))
+		return 1;
+	return draw_list_append(draw_list, PRIMITIVE_TYPE_GRID, 11);
+}
+
+int draw_list_circle(draw_list_t *draw_list, double center[3],
+		     double normal[3], double radius, int segments)
+{
+	double n = sqrt(normal[0] * normal[0] + normal[1] * normal[1] +
+			normal[2] * normal[2]);
+	if (segments < 3 || !(radius > 0.0) || !(n > 0.0))
+		return 1;
+	double params[2] = { radius, segments };
+	if (draw_list_buffer_copy(draw_list, 3, center) ||
+	    draw_list_buffer_copy(draw_list, 3, normal) ||
+	    draw_list_buffer_copy(draw_list, 2, params))
+		return 1;
+	return draw_list_append(draw_list, PRIMITIVE_TYPE_CIRCLE, 8);
+}
+
+int draw_list_box(draw_list_t *draw_list, double x0, double y0, double z0,
+		  double x1, double y1, double z1)
+{
+	double corners[6] = { x0, y0, z0, x1, y1, z1 };
+	if (draw_list_buffer_copy(draw_list, 6, corners))
+		return 1;
+	return draw_list_append(draw_list, PRIMITIVE_TYPE_BOX, 6);
+}
+
+int draw_list_style(draw_list_t *draw_list, double color[4], double width)
+{
+	if (draw_list_buffer_copy(draw_list, 4, color) ||
+	    draw_list_buffer_copy(draw_list, 1, &width))
+		return 1;
+	return draw_list_append(draw_list, PRIMITIVE_TYPE_STYLE, 5);
+}
+
+int draw_list_style2(draw_list_t *draw_list, double r, double g, double b,
+		     double a, double width)
+{
+	double color[4] = { r, g, b, a };
+	if (draw_list_buffer_copy(draw_list, 4, color) ||
+	    draw_list_buffer_copy(draw_list, 1, &width))
+		return 1;
+	return draw_list_append(draw_list, PRIMITIVE_TYPE_STYLE, 5);
+}
+
+int draw_list_clear(draw_list_t *draw_list)
+{
+	return draw_list_append(draw_list, PRIMITIVE_TYPE_CLEAR, 0);
+}
+
+int draw_list_submit(draw_list_t *draw_list, const void *data, size_t size)
+{
+	// the whole buffer is checked first so that a bad record appends
+	// nothing, children are only added by draw_list_child_add
+	const uint8_t *p = data;
+	size_t num = 0, doubles = 0;
+	draw_list_command_t command;
+	for (size_t offset = 0; offset < size;) {
+		if (size - offset < sizeof(command))
+			return 1;
+		memcpy(&command, p + offset, sizeof(command));
+		offset += sizeof(command);
+		if (command.type >= PRIMITIVE_TYPE_CHILD ||
+		    !_draw_list_length_valid(command.type, command.length) ||
+		    command.length > (size - offset) / sizeof(double))
+			return 1;
+		offset += sizeof(double) * command.length;
+		num++;
+		doubles += command.length;
+	}
+	size_t length = draw_list->length;
+	size_t buffer_length = draw_list->buffer_length;
+	if (_draw_list_reserve(draw_list, length + num,
+			       buffer_length + doubles))
+		return 1;
+	for (size_t offset = 0; offset < size;) {
+		memcpy(&command, p + offset, sizeof(command));
+		offset += sizeof(command);
+		memcpy(draw_list->buffer + draw_list->buffer_length, p + offset,
+		       sizeof(double) * command.length);
+		offset += sizeof(double) * command.length;
+		draw_list->buffer_length += command.length;
+		if (draw_list_append(draw_list, command.type, command.length)) {
+			draw_list->length = length;
+			draw_list->buffer_length = buffer_length;
+			_draw_list_changed(draw_list);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int draw_list_child_add(draw_list_t *draw_list, draw_list_t *child,
+			double transform[16])
+{
+	// the child is referenced, not copied, and must outlive this list;
+	// a child that contains this list would recurse forever
+	if (child == NULL || _draw_list_reachable(child, draw_list))
+		return 1;
+	if (_draw_list_children_reserve(draw_list, draw_list->num_children + 1))
+		return 1;
+	double index = draw_list->num_children;
+	if (draw_list_buffer_copy(draw_list, 1, &index) ||
+	    draw_list_append(draw_list, PRIMITIVE_TYPE_CHILD, 1))
+		return 1;
+	draw_list_child_t *edge = &draw_list->children[draw_list->num_children];
+	edge->draw_list = child;
+	if (transform != NULL) {
+		memcpy(edge->local, transform, sizeof(edge->local));
+	} else {
+		for (int i = 0; i < 16; i++)
+			edge->local[i] = i % 5 == 0 ? 1.0 : 0.0;
+	}
+	memcpy(edge->world, edge->local, sizeof(edge->world));
+	edge->dirty = true;
+	draw_list->num_children++;
+	return 0;
+}
+
+size_t draw_list_child_count(draw_list_t *draw_list)
+{
+	return draw_list->num_children;
+}
+
+int draw_list_child_transform_get(draw_list_t *draw_list, size_t index,
+				  double transform[16])
+{
+	if (index >= draw_list->num_children)
+		return 1;
+	memcpy(transform, draw_list->children[index].local,
+	       sizeof(double) * 16);
+	return 0;
+}
+
+int draw_list_child_transform_set(draw_list_t *draw_list, size_t index,
+				  double transform[16])
+{
+	// only the world matrices below this child are recomputed
+	if (index >= draw_list->num_children)
+		return 1;
+	memcpy(draw_list->children[index].local, transform,
+	       sizeof(double) * 16);
+	draw_list->children[index].dirty = true;
+	atomic_fetch_add(&_draw_list_epoch, 1);
+	return 0;
+}
+
+int _draw_list_children_load(draw_list_t *draw_list, size_t num,
+			     draw_list_t **children, const double *locals)
+{
+	// only a different set of children changes the version, transforms
+	// are updated like by draw_list_child_transform_set
+	if (_draw_list_children_reserve(draw_list, num))
+		return 1;
+	bool changed = num != draw_list->num_children;
+	for (size_t i = 0; i < num; i++) {
+		draw_list_child_t *edge = &draw_list->children[i];
+		const double *local = locals + 16 * i;
+		if (i >= draw_list->num_children ||
+		    edge->draw_list != children[i]) {
+			edge->draw_list = children[i];
+			changed = true;
+		} else if (memcmp(edge->local, local, sizeof(edge->local)) ==
+			   0) {
+			continue;
+		}
+		memcpy(edge->local, local, sizeof(edge->local));
+		edge->dirty = true;
+		atomic_fetch_add(&_draw_list_epoch, 1);
+	}
+	draw_list->num_children = num;
+	draw_list->num_children_saved = num;
+	if (changed)
+		_draw_list_changed(draw_list);
+	return 0;
+}
+
+int draw_list_child_pose_set(draw_list_t *draw_list, size_t index, double x,
+			     double y, double z, double rx, double ry,
+			     double rz)
+{
+	double transform[16];
+	_camera_pose_matrix(transform, x, y, z, rx, ry, rz);
+	return draw_list_child_transform_set(draw_list, index, transform);
+}
+
+int draw_list_child_world_get(draw_list_t *draw_list, size_t index,
+			      double world[16])
+{
+	// world matrix of the child as of the last render
+	if (index >= draw_list->num_children)
+		return 1;
+	memcpy(world, draw_list->children[index].world, sizeof(double) * 16);
+	return 0;
+}
+
+int draw_list_time_set(draw_list_t *draw_list, double time)
+{
+	// stamps the primitives appended from now on, nan for untimed ones
+	draw_list->time = time;
+	return 0;
+}
+
+double draw_list_time_get(draw_list_t *draw_list)
+{
+	return draw_list->time;
+}
+
+int draw_list_time_window_set(draw_list_t *draw_list, double t0, double t1)
+{
+	// only primitives overlapping [t0, t1] are drawn, infinite bounds
+	// leave that side open
+	if (isnan(t0) || isnan(t1) || t0 > t1)
+		return 1;
+	draw_list->time_window[0] = t0;
+	draw_list->time_window[1] = t1;
+	return 0;
+}
+
+int draw_list_time_window_get(draw_list_t *draw_list, double *t0, double *t1)
+{
+	*t0 = draw_list->time_window[0];
+	*t1 = draw_list->time_window[1];
+	return 0;
+}
+
+bool _draw_list_time_window_active(draw_list_t *draw_list)
+{
+	return draw_list->times != NULL &&
+	       (draw_list->time_window[0] > -INFINITY ||
+		draw_list->time_window[1] < INFINITY);
+}
+
+bool _draw_list_time_visible(draw_list_t *draw_list, size_t i)
+{
+	if (i >= draw_list->times_length ||
+	    draw_list->primitives[i].type == PRIMITIVE_TYPE_STYLE)
+		return true;
+	primitive_time_t *time = &draw_list->times[i];
+	return time->begin <= draw_list->time_window[1] &&
+	       time->end >= draw_list->time_window[0];
+}
+
+static size_t _draw_list_time_search(const double *values, size_t start,
+				     size_t end, double value, bool inclusive)
+{
+	// first index in [start, end) whose value is >= value, or > value
+	// when inclusive is false, values must not decrease
+	while (start < end) {
+		size_t mid = start + (end - start) / 2;
+		double v = values[mid];
+		if (v < value || (!inclusive && v == value))
+			start = mid + 1;
+		else
+			end = mid;
+	}
+	return start;
+}
+
+static void _draw_list_time_range(draw_list_t *draw_list, size_t *first,
+				  size_t *last)
+{
+	// primitives before first end before the window and the ones from
+	// last on begin after it
+	primitive_time_t *times = draw_list->times;
+	size_t lo = draw_list->untimed_prefix, hi = draw_list->times_length;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (times[mid].reach < draw_list->time_window[0])
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	*first = lo;
+	lo = draw_list->untimed_prefix;
+	hi = draw_list->times_length;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (times[mid].begin <= draw_list->time_window[1])
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	*last = lo;
+}
+
+primitive_t *_draw_list_time_trim(draw_list_t *draw_list, size_t i,
+				  primitive_t *trimmed)
+{
+	// narrows a primitive with vertex stamps to the vertices inside the
+	// window, NULL when too few are left to draw
+	primitive_t *primitive = &draw_list->primitives[i];
+	if (i >= draw_list->times_length ||
+	    draw_list->times[i].vertices == SIZE_MAX)
+		return primitive;
+	const double *times =
+		draw_list->vertex_times + draw_list->times[i].vertices;
+	size_t num = primitive->length / 3;
+	size_t lo = _draw_list_time_search(times, 0, num,
+					   draw_list->time_window[0], true);
+	size_t hi = _draw_list_time_search(times, lo, num,
+					   draw_list->time_window[1], false);
+	size_t min = primitive->type == PRIMITIVE_TYPE_POLYLINE ? 2 : 1;
+	if (hi - lo < min)
+		return NULL;
+	*trimmed = *primitive;
+	trimmed->index += lo * 3;
+	trimmed->length = (hi - lo) * 3;
+	return trimmed;
+}
+
+static bool _draw_list_occluded(draw_list_t *draw_list, cairo_t *cr,
+				double x0, double y0, double x1, double y1,
+				double depth)
+{
+	// strokes extend half of the line width beyond the projected points
+	double r = cairo_get_line_width(cr) / 2.0;
+	return hiz_occluded(draw_list->hiz, x0 - r, y0 - r, x1 + r, y1 + r,
+			    depth);
+}
+
+static size_t _draw_list_project(camera_t *camera, double *points, size_t num,
+				 size_t start, projection_batch_t *batch)
+{
+	// project the next batch of points from start, returns its size
+	size_t n = num - start;
+	if (n > DRAW_LIST_PROJECT_BATCH)
+		n = DRAW_LIST_PROJECT_BATCH;
+	camera_project_points(camera, n, &points[start * 3], batch->q,
+			      batch->depth, batch->visible);
+	return n;
+}
+
+static size_t _draw_list_decimated(size_t num, size_t group, size_t step)
+{
+	// points left when keeping every step-th group of points
+	return (num / group + step - 1) / step * group;
+}
+
+static size_t _draw_list_project_every(camera_t *camera, double *points,
+				       size_t num, size_t group, size_t step,
+				       size_t start, size_t selected,
+				       projection_batch_t *batch)
+{
+	// like _draw_list_project over every step-th group of points, start
+	// and selected count the kept points, the index past the end of a
+	// decimated polyline picks its last point
+	if (step == 1)
+		return _draw_list_project(camera, points, selected, start,
+					  batch);
+	size_t n = selected - start;
+	if (n > DRAW_LIST_PROJECT_BATCH)
+		n = DRAW_LIST_PROJECT_BATCH;
+	for (size_t j = 0; j < n; j++) {
+		size_t k = start + j;
+		size_t src = k / group * step * group + k % group;
+		if (src >= num)
+			src = num - 1;
+		memcpy(&batch->p[j * 3], &points[src * 3], sizeof(double) * 3);
+	}
+	camera_project_points(camera, n, batch->p, batch->q, batch->depth,
+			      batch->visible);
+	return n;
+}
+
+static bool _draw_list_occluded_points(draw_list_t *draw_list, cairo_t *cr,
+				       camera_t *camera, double *points,
+				       size_t num_points)
+{
+	double x0 = INFINITY, y0 = INFINITY, x1 = -INFINITY, y1 = -INFINITY;
+	double depth = INFINITY;
+	projection_batch_t batch;
+	for (size_t i = 0, n; i < num_points; i += n) {
+		n = _draw_list_project(camera, points, num_points, i, &batch);
+		for (size_t j = 0; j < n; j++) {
+			if (!batch.visible[j])
+				return false;
+			x0 = fmin(x0, batch.q[j * 2]);
+			y0 = fmin(y0, batch.q[j * 2 + 1]);
+			x1 = fmax(x1, batch.q[j * 2]);
+			y1 = fmax(y1, batch.q[j * 2 + 1]);
+			depth = fmin(depth, batch.depth[j]);
+		}
+	}
+	return _draw_list_occluded(draw_list, cr, x0, y0, x1, y1, depth);
+}
+
+static void _draw_list_render_segments(draw_list_t *draw_list, cairo_t *cr,
+				       camera_t *camera, double *points,
+				       size_t num_points)
+{
+	// independent line segments between pairs of points
+	size_t step = draw_list->decimation;
+	size_t num = _draw_list_decimated(num_points, 2, step) / 2;
+	size_t culled = 0;
+	projection_batch_t batch;
+	raster_t *raster = &draw_list->raster;
+	bool direct = draw_list->raster_active && _raster_begin(raster, cr);
+	// the batch size is even, so both ends of a line share a batch
+	for (size_t i = 0, n; i < num * 2; i += n) {
+		n = _draw_list_project_every(camera, points, num_points, 2,
+					     step, i, num * 2, &batch);
+		for (size_t j = 0; j < n; j += 2) {
+			double *p1 = &batch.q[j * 2], *p2 = &batch.q[j * 2 + 2];
+			if (!batch.visible[j] || !batch.visible[j + 1] ||
+			    (draw_list->hiz_active &&
+			     _draw_list_occluded(
+				     draw_list, cr, fmin(p1[0], p2[0]),
+				     fmin(p1[1], p2[1]), fmax(p1[0], p2[0]),
+				     fmax(p1[1], p2[1]),
+				     fmin(batch.depth[j],
+					  batch.depth[j + 1])))) {
+				culled++;
+				continue;
+			}
+			if (direct) {
+				_raster_line(raster, p1[0], p1[1], p2[0], p2[1],
+					     false);
+				continue;
+			}
+			cairo_move_to(cr, p1[0], p1[1]);
+			cairo_line_to(cr, p2[0], p2[1]);
+			cairo_stroke(cr);
+		}
+	}
+	if (direct)
+		_raster_end(raster);
+	STATS_COUNT(STATS_COUNTER_VERTICES, num * 2);
+	STATS_COUNT(STATS_COUNTER_CULLED, culled * 2);
+	STATS_COUNT(STATS_COUNTER_STROKES, num - culled);
+}
+
+void _draw_list_render_line(draw_list_t *draw_list, primitive_t *primitive,
+			    cairo_t *cr, camera_t *camera)
+{
+	_draw_list_render_segments(draw_list, cr, camera,
+				   draw_list->buffer + primitive->index,
+				   primitive->length / 3);
+}
+
+static void _draw_list_render_points(draw_list_t *draw_list, cairo_t *cr,
+				     camera_t *camera, double *points,
+				     size_t num)
+{
+	size_t step = draw_list->decimation;
+	size_t num_points = _draw_list_decimated(num, 1, step);
+	size_t culled = 0;
+	projection_batch_t batch;
+	raster_t *raster = &draw_list->raster;
+	bool direct = draw_list->raster_active && _raster_begin(raster, cr);
+	// butt caps draw nothing for a zero length line, so points are filled
+	// squares below full quality
+	bool square = draw_list->quality != RENDER_QUALITY_FULL;
+	double w = cairo_get_line_width(cr);
+	for (size_t i = 0, n; i < num_points; i += n) {
+		n = _draw_list_project_every(camera, points, num, 1, step, i,
+					     num_points, &batch);
+		for (size_t j = 0; j < n; j++) {
+			double *p = &batch.q[j * 2];
+			if (!batch.visible[j] ||
+			    (draw_list->hiz_active &&
+			     _draw_list_occluded(draw_list, cr, p[0], p[1],
+						 p[0], p[1], batch.depth[j]))) {
+				culled++;
+				continue;
+			}
+			if (direct) {
+				_raster_point(raster, p[0], p[1]);
+			} else if (square) {
+				cairo_rectangle(cr, p[0] - w / 2.0,
+						p[1] - w / 2.0, w, w);
+				cairo_fill(cr);
+			} else {
+				cairo_move_to(cr, p[0], p[1]);
+				cairo_line_to(cr, p[0], p[1]);
+				cairo_stroke(cr);
+			}
+		}
+	}
+	if (direct)
+		_raster_end(raster);
+	STATS_COUNT(STATS_COUNTER_VERTICES, num_points);
+	STATS_COUNT(STATS_COUNTER_CULLED, culled);
+	if (square && !direct)
+		STATS_COUNT(STATS_COUNTER_FILLS, num_points - culled);
+	else
+		STATS_COUNT(STATS_COUNTER_STROKES, num_points - culled);
+}
+
+void _draw_list_render_point(draw_list_t *draw_list, primitive_t *primitive,
+			     cairo_t *cr, camera_t *camera)
+{
+	_draw_list_render_points(draw_list, cr, camera,
+				 draw_list->buffer + primitive->index,
+				 primitive->length / 3);
+}
+
+void _draw_list_render_polygon(draw_list_t *draw_list, primitive_t *primitive,
+			       cairo_t *cr, camera_t *camera)
+{
+	double *points = draw_list->buffer + primitive->index;
+	size_t num_points = primitive->length / 3;
+	bool b = false;
+	size_t culled = 0;
+	projection_batch_t batch;
+	STATS_COUNT(STATS_COUNTER_VERTICES, num_points);
+	if (draw_list->hiz_active &&
+	    _draw_list_occluded_points(draw_list, cr, camera, points,
+				       num_points)) {
+		STATS_COUNT(STATS_COUNTER_CULLED, num_points);
+		return;
+	}
+	for (size_t i = 0, n; i < num_points; i += n) {
+		n = _draw_list_project(camera, points, num_points, i, &batch);
+		for (size_t j = 0; j < n; j++) {
+			b = batch.visible[j];
+			if (!b) {
+				culled++;
+				continue;
+			}
+			cairo_line_to(cr, batch.q[j * 2], batch.q[j * 2 + 1]);
+		}
+	}
+	STATS_COUNT(STATS_COUNTER_CULLED, culled);
+	if (b) {
+		cairo_close_path(cr);
+		cairo_fill(cr);
+		STATS_COUNT(STATS_COUNTER_FILLS, 1);
+	} else {
+		cairo_stroke(cr);
+		STATS_COUNT(STATS_COUNTER_STROKES, 1);
+	}
+}
+
+static void _draw_list_render_path(draw_list_t *draw_list, cairo_t *cr,
+				   camera_t *camera, double *points,
+				   size_t num_points)
+{
+	// decimated polylines keep their last point
+	size_t step = draw_list->decimation;
+	size_t selected =
+		num_points > 0 ?
+			_draw_list_decimated(num_points - 1, 1, step) + 1 :
+			0;
+	bool b1 = false, b2;
+	size_t culled = 0, strokes = 1;
+	projection_batch_t batch;
+	raster_t *raster = &draw_list->raster;
+	double last[2] = { 0.0, 0.0 };
+	bool run = false;
+	STATS_COUNT(STATS_COUNTER_VERTICES, selected);
+	if (draw_list->hiz_active &&
+	    _draw_list_occluded_points(draw_list, cr, camera, points,
+				       num_points)) {
+		STATS_COUNT(STATS_COUNTER_CULLED, num_points);
+		return;
+	}
+	bool direct = draw_list->raster_active && _raster_begin(raster, cr);
+	for (size_t i = 0, n; i < selected; i += n) {
+		n = _draw_list_project_every(camera, points, num_points, 1,
+					     step, i, selected, &batch);
+		if (i == 0)
+			b1 = batch.visible[0];
+		for (size_t j = 0; j < n; j++) {
+			double *p = &batch.q[j * 2];
+			b2 = batch.visible[j];
+			if (!(b1 && b2)) {
+				if (direct && run)
+					_raster_point(raster, last[0], last[1]);
+				if (!direct) {
+					cairo_stroke(cr);
+					// points that are not visible may
+					// project to nan
+					if (b2)
+						cairo_move_to(cr, p[0], p[1]);
+				}
+				run = false;
+				strokes++;
+			} else if (direct) {
+				// segments skip their last pixel so that joints
+				// are blended once, the end of a run is added
+				if (i + j > 0) {
+					_raster_line(raster, last[0], last[1],
+						     p[0], p[1], true);
+					run = true;
+				}
+			} else {
+				cairo_line_to(cr, p[0], p[1]);
+			}
+			culled += !b2;
+			b1 = b2;
+			last[0] = p[0];
+			last[1] = p[1];
+		}
+	}
+	if (direct) {
+		if (run)
+			_raster_point(raster, last[0], last[1]);
+		_raster_end(raster);
+	} else {
+		cairo_stroke(cr);
+	}
+	STATS_COUNT(STATS_COUNTER_CULLED, culled);
+	STATS_COUNT(STATS_COUNTER_STROKES, strokes);
+}
+
+void _draw_list_render_polyline(draw_list_t *draw_list, primitive_t *primitive,
+				cairo_t *cr, camera_t *camera)
+{
+	_draw_list_render_path(draw_list, cr, camera,
+			       draw_list->buffer + primitive->index,
+			       primitive->length / 3);
+}
+
+void _draw_list_render_polylines(draw_list_t *draw_list,
+				 primitive_t *primitive, cairo_t *cr,
+				 camera_t *camera)
+{
+	// nan points project as not visible, which breaks the path
+	double *points = draw_list->buffer + primitive->index;
+	size_t num_points = primitive->length / 3;
+	if (draw_list->decimation == 1) {
+		_draw_list_render_path(draw_list, cr, camera, points,
+				       num_points);
+		return;
+	}
+	// decimation must not skip the breaks, each polyline is decimated on
+	// its own
+	size_t start = 0;
+	for (size_t i = 0; i <= num_points; i++) {
+		if (i < num_points && !isnan(points[i * 3]))
+			continue;
+		if (i > start)
+			_draw_list_render_path(draw_list, cr, camera,
+					       points + start * 3, i - start);
+		start = i + 1;
+	}
+}
+
+static double *_draw_list_expanded_reserve(draw_list_t *draw_list,
+					   size_t num)
+{
+	if (num <= draw_list->expanded_capacity)
+		return draw_list->expanded;
+	size_t capacity = draw_list->expanded_capacity ?
+				  draw_list->expanded_capacity :
+				  256;
+	while (capacity < num)
+		capacity *= 2;
+	double *expanded =
+		realloc(draw_list->expanded, sizeof(double) * capacity);
+	if (expanded == NULL)
+		return NULL;
+	draw_list->expanded = expanded;
+	draw_list->expanded_capacity = capacity;
+	return expanded;
+}
+
+static double _draw_list_screen_length(camera_t *camera, double *a,
+				       double *b)
+{
+	// projected distance of two points, infinite if either is not visible
+	double p[6] = { a[0], a[1], a[2], b[0], b[1], b[2] };
+	double q[4], depth[2];
+	bool visible[2];
+	camera_project_points(camera, 2, p, q, depth, visible);
+	if (!visible[0] || !visible[1])
+		return INFINITY;
+	return hypot(q[2] - q[0], q[3] - q[1]);
+}
+
+static double _draw_list_cell_spacing(camera_t *camera, const double *m,
+				      const double *a, const double *b,
+				      double cells)
+{
+	// distance in pixels between the cell borders along ab, on the part
+	// of ab in front of the camera and inside the viewport; nan when none
+	// of it is visible
+	int width, height;
+	camera_viewport_get(camera, &width, &height);
+	double pa[4], pb[4];
+	for (int i = 0; i < 4; i++) {
+		pa[i] = m[i * 4] * a[0] + m[i * 4 + 1] * a[1] +
+			m[i * 4 + 2] * a[2] + m[i * 4 + 3];
+		pb[i] = m[i * 4] * b[0] + m[i * 4 + 1] * b[1] +
+			m[i * 4 + 2] * b[2] + m[i * 4 + 3];
+	}
+	// each bound is linear in the homogeneous coordinates, so the edge is
+	// clipped against w > 0 and the viewport in one pass
+	double f0[5] = { pa[3] - 1e-9, pa[0], width * pa[3] - pa[0], pa[1],
+			 height * pa[3] - pa[1] };
+	double f1[5] = { pb[3] - 1e-9, pb[0], width * pb[3] - pb[0], pb[1],
+			 height * pb[3] - pb[1] };
+	double t0 = 0.0, t1 = 1.0;
+	for (int i = 0; i < 5; i++) {
+		if (f0[i] < 0.0 && f1[i] < 0.0)
+			return NAN;
+		double t = f0[i] / (f0[i] - f1[i]);
+		if (f0[i] < 0.0)
+			t0 = fmax(t0, t);
+		else if (f1[i] < 0.0)
+			t1 = fmin(t1, t);
+	}
+	if (!(t1 - t0 > 1e-9))
+		return NAN;
+	// measured where the visible part is halved on screen, the nearer
+	// half has wider cells and the farther half narrower ones
+	double w0 = pa[3] + t0 * (pb[3] - pa[3]);
+	double w1 = pa[3] + t1 * (pb[3] - pa[3]);
+	double t = t0 + (t1 - t0) * w0 / (w0 + w1);
+	double x = pa[0] + t * (pb[0] - pa[0]);
+	double y = pa[1] + t * (pb[1] - pa[1]);
+	double w = pa[3] + t * (pb[3] - pa[3]);
+	double dw = pb[3] - pa[3];
+	double dx = ((pb[0] - pa[0]) * w - x * dw) / (w * w);
+	double dy = ((pb[1] - pa[1]) * w - y * dw) / (w * w);
+	return hypot(dx, dy) / cells;
+}
+
+static size_t _draw_list_grid_step(camera_t *camera, const double *o,
+				   const double *u, const double *v,
+				   double cells)
+{
+	// every step-th line across u is drawn so that the visible cells
+	// along the sparsest of the border and middle lines in direction u
+	// stay DRAW_LIST_GRID_SPACING pixels apart; grids around the camera
+	// are measured on screen only, not up to where they pass behind it
+	double m[16];
+	camera_projection_get(camera, m);
+	double spacing = NAN;
+	for (int i = 0; i < 3; i++) {
+		double a[3], b[3];
+		for (int k = 0; k < 3; k++) {
+			a[k] = o[k] + i * 0.5 * v[k];
+			b[k] = a[k] + u[k];
+		}
+		double s = _draw_list_cell_spacing(camera, m, a, b, cells);
+		if (!isnan(s))
+			spacing = isnan(spacing) ? s : fmax(spacing, s);
+	}
+	// lines off screen or edge-on can not be measured, such grids only
+	// get their borders
+	if (!isfinite(spacing))
+		spacing = 0.0;
+	size_t step = 1;
+	while (spacing * step < DRAW_LIST_GRID_SPACING && step < cells)
+		step *= 2;
+	return step;
+}
+
+void _draw_list_render_grid(draw_list_t *draw_list, primitive_t *primitive,
+			    cairo_t *cr, camera_t *camera)
+{
+	double *g = draw_list->buffer + primitive->index;
+	double *o = g, *u = g + 3, *v = g + 6;
+	if (!(g[9] >= 1.0 && g[9] <= INT_MAX && g[10] >= 1.0 &&
+	      g[10] <= INT_MAX))
+		return;
+	size_t nu = (size_t)g[9], nv = (size_t)g[10];
+	size_t su = _draw_list_grid_step(camera, o, u, v, nu);
+	size_t sv = _draw_list_grid_step(camera, o, v, u, nv);
+	// the lines at multiples of the step and the far border
+	size_t lu = (nu + su - 1) / su + 1, lv = (nv + sv - 1) / sv + 1;
+	double *lines = _draw_list_expanded_reserve(draw_list, (lu + lv) * 6);
+	if (lines == NULL)
+		return;
+	double *p = lines;
+	for (size_t i = 0; i < lu; i++) {
+		double t = (i * su < nu ? i * su : nu) / (double)nu;
+		for (int k = 0; k < 3; k++) {
+			p[k] = o[k] + t * u[k];
+			p[k + 3] = p[k] + v[k];
+		}
+		p += 6;
+	}
+	for (size_t i = 0; i < lv; i++) {
+		double t = (i * sv < nv ? i * sv : nv) / (double)nv;
+		for (int k = 0; k < 3; k++) {
+			p[k] = o[k] + t * v[k];
+			p[k + 3] = p[k] + u[k];
+		}
+		p += 6;
+	}
+	_draw_list_render_segments(draw_list, cr, camera, lines,
+				   (lu + lv) * 2);
+}
+
+void _draw_list_render_circle(draw_list_t *draw_list, primitive_t *primitive,
+			      cairo_t *cr, camera_t *camera)
+{
+	double *c = draw_list->buffer + primitive->index;
+	double *n = c + 3, radius = c[6];
+	double len = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+	if (!(c[7] >= 3.0 && c[7] <= INT_MAX) || !(len > 0.0))
+		return;
+	size_t max_segments = (size_t)c[7];
+	// orthonormal basis of the circle plane
+	double w[3] = { n[0] / len, n[1] / len, n[2] / len };
+	double a[3] = { 1.0, 0.0, 0.0 };
+	if (fabs(w[0]) > 0.9) {
+		a[0] = 0.0;
+		a[1] = 1.0;
+	}
+	double e1[3] = { a[1] * w[2] - a[2] * w[1], a[2] * w[0] - a[0] * w[2],
+			 a[0] * w[1] - a[1] * w[0] };
+	len = sqrt(e1[0] * e1[0] + e1[1] * e1[1] + e1[2] * e1[2]);
+	for (int k = 0; k < 3; k++)
+		e1[k] /= len;
+	double e2[3] = { w[1] * e1[2] - w[2] * e1[1],
+			 w[2] * e1[0] - w[0] * e1[2],
+			 w[0] * e1[1] - w[1] * e1[0] };
+	double p1[3], p2[3];
+	for (int k = 0; k < 3; k++) {
+		p1[k] = c[k] + radius * e1[k];
+		p2[k] = c[k] + radius * e2[k];
+	}
+	double r = fmax(_draw_list_screen_length(camera, c, p1),
+			_draw_list_screen_length(camera, c, p2));
+	size_t segments = max_segments;
+	if (isfinite(r)) {
+		double adapted = ceil(2.0 * PI * r / DRAW_LIST_ARC_PIXELS);
+		if (adapted < (double)segments)
+			segments = adapted > 8.0 ? (size_t)adapted : 8;
+		if (segments > max_segments)
+			segments = max_segments;
+	}
+	double *points = _draw_list_expanded_reserve(draw_list,
+						     (segments + 1) * 3);
+	if (points == NULL)
+		return;
+	for (size_t i = 0; i <= segments; i++) {
+		double t = 2.0 * PI * (i % segments) / segments;
+		double ct = cos(t) * radius, st = sin(t) * radius;
+		for (int k = 0; k < 3; k++)
+			points[i * 3 + k] = c[k] + ct * e1[k] + st * e2[k];
+	}
+	_draw_list_render_path(draw_list, cr, camera, points, segments + 1);
+}
+
+void _draw_list_render_box(draw_list_t *draw_list, primitive_t *primitive,
+			   cairo_t *cr, camera_t *camera)
+{
+	double *b = draw_list->buffer + primitive->index;
+	// corner i takes x, y and z from the max corner for bits 0, 1 and 2
+	static const int edges[12][2] = {
+		{ 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 }, { 0, 2 }, { 1, 3 },
+		{ 4, 6 }, { 5, 7 }, { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 },
+	};
+	double lines[12 * 6];
+	for (int i = 0; i < 12; i++) {
+		for (int j = 0; j < 2; j++) {
+			int corner = edges[i][j];
+			for (int k = 0; k < 3; k++)
+				lines[i * 6 + j * 3 + k] =
+					b[k + ((corner >> k) & 1) * 3];
+		}
+	}
+	_draw_list_render_segments(draw_list, cr, camera, lines, 24);
+}
+
+void _draw_list_render_style(draw_list_t *draw_list, primitive_t *primitive,
+			     cairo_t *cr, camera_t *camera)
+{
+	(void)camera;
+	double *color = draw_list->buffer + primitive->index;
+	double width = draw_list->buffer[primitive->index + 4];
+	cairo_set_source_rgba(cr, color[0], color[1], color[2], color[3]);
+	cairo_set_line_width(cr, width);
+}
+
+void _draw_list_render_clear(draw_list_t *draw_list, primitive_t *primitive,
+			     cairo_t *cr, camera_t *camera)
+{
+	(void)primitive;
+	(void)camera;
+	(void)draw_list;
+	int width, height;
+	camera_viewport_get(camera, &width, &height);
+	cairo_rectangle(cr, 0, 0, width, height);
+	cairo_fill(cr);
+}
+
+static uint32_t _depth_key(double depth)
 {
-	draw_list->length = draw_list->length_saved;
-	draw_list->buffer_length = draw_list->buffer_length_saved;
-	return 0;
+	// flip the float bits so that unsigned comparison matches the float
+	// order, then invert it so that the farthest polygon comes first
+	float f = (float)depth;
+	uint32_t u;
+	memcpy(&u, &f, sizeof(u));
+	u = (u & 0x80000000u) ? ~u : (u | 0x80000000u);
+	return ~u;
 }
 
-int draw_list_empty(draw_list_t *draw_list)
+static void _radix_sort(uint64_t **keys, uint32_t **values,
+			uint64_t **keys_tmp, uint32_t **values_tmp, size_t n)
 {
-	draw_list->length = 0;
-	draw_list->buffer_length = 0;
-	draw_list->length_saved = 0;
-	draw_list->buffer_length_saved = 0;
-	return 0;
+	size_t counts[256];
+	for (int shift = 0; shift < 64; shift += 8) {
+		uint64_t *k = *keys;
+		uint32_t *v = *values;
+		memset(counts, 0, sizeof(counts));
+		for (size_t i = 0; i < n; i++)
+			counts[(k[i] >> shift) & 0xff]++;
+		// skip the pass if every key has the same digit here
+		if (counts[(k[0] >> shift) & 0xff] == n)
+			continue;
+		size_t sum = 0;
+		for (int i = 0; i < 256; i++) {
+			size_t c = counts[i];
+			counts[i] = sum;
+			sum += c;
+		}
+		uint64_t *kt = *keys_tmp;
+		uint32_t *vt = *values_tmp;
+		for (size_t i = 0; i < n; i++) {
+			size_t j = counts[(k[i] >> shift) & 0xff]++;
+			kt[j] = k[i];
+			vt[j] = v[i];
+		}
+		*keys = kt;
+		*keys_tmp = k;
+		*values = vt;
+		*values_tmp = v;
+	}
 }
 
-int draw_list_buffer_allocate(draw_list_t *draw_list, size_t num)
+static bool _insertion_sort(uint64_t *keys, uint32_t *values, size_t n,
+			    size_t budget)
 {
-	if (draw_list->buffer_length + num >= draw_list->buffer_capacity) {
-		while (draw_list->buffer_length + num >=
-		       draw_list->buffer_capacity) {
-			draw_list->buffer_capacity *= 2;
+	// cheap for the nearly sorted order left by the previous frame, gives
+	// up once the number of moves exceeds the budget
+	for (size_t i = 1; i < n; i++) {
+		uint64_t k = keys[i];
+		uint32_t v = values[i];
+		size_t j = i;
+		while (j > 0 && keys[j - 1] > k) {
+			keys[j] = keys[j - 1];
+			values[j] = values[j - 1];
+			j--;
+			if (budget-- == 0) {
+				keys[j] = k;
+				values[j] = v;
+				return false;
+			}
 		}
-		draw_list->buffer =
-			realloc(draw_list->buffer,
-				sizeof(double) * draw_list->buffer_capacity);
+		keys[j] = k;
+		values[j] = v;
 	}
-	return 0;
+	return true;
 }
 
-int draw_list_buffer_copy(draw_list_t *draw_list, size_t num, double *src)
+static int _draw_list_sort_reserve(draw_list_t *draw_list, size_t num)
 {
-	draw_list_buffer_allocate(draw_list, num);
-	memcpy(draw_list->buffer + draw_list->buffer_length, src,
-	       sizeof(double) * num);
-	draw_list->buffer_length += num;
+	if (num <= draw_list->sort_capacity)
+		return 0;
+	size_t capacity = draw_list->sort_capacity ? draw_list->sort_capacity :
+						     64;
+	while (capacity < num)
+		capacity *= 2;
+	draw_list->sort_items = realloc(draw_list->sort_items,
+					sizeof(sort_item_t) * capacity);
+	draw_list->sort_keys =
+		realloc(draw_list->sort_keys, sizeof(uint64_t) * capacity);
+	draw_list->sort_keys_tmp =
+		realloc(draw_list->sort_keys_tmp, sizeof(uint64_t) * capacity);
+	draw_list->sort_order =
+		realloc(draw_list->sort_order, sizeof(uint32_t) * capacity);
+	draw_list->sort_order_tmp =
+		realloc(draw_list->sort_order_tmp, sizeof(uint32_t) * capacity);
+	draw_list->sort_capacity = capacity;
 	return 0;
 }
 
-int draw_list_append(draw_list_t *draw_list, primitive_type_t type, size_t num)
+static int _draw_list_sort_points_reserve(draw_list_t *draw_list, size_t num)
 {
-	if (draw_list->length == draw_list->capacity) {
-		draw_list->capacity *= 2;
-		draw_list->primitives =
-			realloc(draw_list->primitives,
-				sizeof(primitive_t) * draw_list->capacity);
-	}
-	draw_list->primitives[draw_list->length].type = type;
-	draw_list->primitives[draw_list->length].index =
-		draw_list->buffer_length - num;
-	draw_list->primitives[draw_list->length].length = num;
-	draw_list->length++;
+	size_t needed = draw_list->sort_points_length + num;
+	if (needed <= draw_list->sort_points_capacity)
+		return 0;
+	size_t capacity = draw_list->sort_points_capacity ?
+				  draw_list->sort_points_capacity :
+				  256;
+	while (capacity < needed)
+		capacity *= 2;
+	draw_list->sort_points =
+		realloc(draw_list->sort_points, sizeof(double) * capacity);
+	draw_list->sort_points_capacity = capacity;
 	return 0;
 }
 
-int draw_list_points(draw_list_t *draw_list, int num_points, double *points)
+void _draw_list_depth_sort(draw_list_t *draw_list, camera_t *camera)
 {
-	if (num_points < 1)
-		return 1;
-	draw_list_buffer_copy(draw_list, num_points * 3, (double *)points);
-	draw_list_append(draw_list, PRIMITIVE_TYPE_POINT, num_points * 3);
-	;
-	return 0;
-}
+	// project every polygon once, keeping the screen points for rendering
+	// and the mean view depth as the sort key
+	size_t num = 0;
+	size_t style = SIZE_MAX;
+	uint64_t segment = 0;
+	projection_batch_t batch;
+	bool window = _draw_list_time_window_active(draw_list);
+	draw_list->sort_points_length = 0;
+	for (size_t i = 0; i < draw_list->length; i++) {
+		primitive_t *primitive = &draw_list->primitives[i];
+		if (primitive->type == PRIMITIVE_TYPE_STYLE) {
+			style = i;
+			continue;
+		}
+		if (primitive->type == PRIMITIVE_TYPE_CLEAR) {
+			segment++;
+			continue;
+		}
+		if (primitive->type != PRIMITIVE_TYPE_POLYGON ||
+		    (window && !_draw_list_time_visible(draw_list, i)))
+			continue;
+		double *points = draw_list->buffer + primitive->index;
+		size_t num_points = primitive->length / 3;
+		_draw_list_sort_reserve(draw_list, num + 1);
+		_draw_list_sort_points_reserve(draw_list, num_points * 2);
+		sort_item_t *item = &draw_list->sort_items[num];
+		item->primitive = i;
+		item->style = style;
+		item->points = draw_list->sort_points_length;
+		item->num_points = 0;
+		item->closed = false;
+		double *q = draw_list->sort_points + item->points;
+		double depth = 0.0;
+		item->depth_min = INFINITY;
+		for (size_t j = 0, n; j < num_points; j += n) {
+			n = _draw_list_project(camera, points, num_points, j,
+					       &batch);
+			for (size_t k = 0; k < n; k++) {
+				double d = batch.depth[k];
+				depth += d;
+				item->depth_min = fmin(item->depth_min, d);
+				item->closed = batch.visible[k];
+				if (!item->closed)
+					continue;
+				double *p = &q[item->num_points * 2];
+				p[0] = batch.q[k * 2];
+				p[1] = batch.q[k * 2 + 1];
+				item->num_points++;
+			}
+		}
+		draw_list->sort_points_length += item->num_points * 2;
+		item->key = segment << 32 | _depth_key(depth / num_points);
+		STATS_COUNT(STATS_COUNTER_VERTICES, num_points);
+		STATS_COUNT(STATS_COUNTER_CULLED,
+			    num_points - item->num_points);
+		num++;
+	}
 
-int draw_list_lines(draw_list_t *draw_list, int num_lines, double *lines)
-{
-	if (num_lines < 1)
-		return 1;
-	draw_list_buffer_copy(draw_list, num_lines * 6, (double *)lines);
-	draw_list_append(draw_list, PRIMITIVE_TYPE_LINE, num_lines * 6);
-	return 0;
+	// the previous order is still a valid permutation if the polygon count
+	// did not change, and for small camera motions it is nearly sorted
+	bool sorted = false;
+	if (num > 0 && num == draw_list->sort_length) {
+		for (size_t j = 0; j < num; j++) {
+			draw_list->sort_keys[j] =
+				draw_list->sort_items[draw_list->sort_order[j]]
+					.key;
+		}
+		sorted = _insertion_sort(draw_list->sort_keys,
+					 draw_list->sort_order, num, num * 8);
+	}
+	if (!sorted && num > 0) {
+		for (size_t j = 0; j < num; j++) {
+			draw_list->sort_keys[j] = draw_list->sort_items[j].key;
+			draw_list->sort_order[j] = j;
+		}
+		_radix_sort(&draw_list->sort_keys, &draw_list->sort_order,
+			    &draw_list->sort_keys_tmp,
+			    &draw_list->sort_order_tmp, num);
+	}
+	draw_list->sort_length = num;
 }
 
-int draw_list_line(draw_list_t *draw_list, double x1, double y1, double z1,
-		   double x2, double y2, double z2)
+static size_t _draw_list_render_sorted(draw_list_t *draw_list, size_t start,
+				       uint64_t segment, size_t style,
+				       cairo_t *cr, camera_t *camera)
 {
-	double points[2][3] = { { x1, y1, z1 }, { x2, y2, z2 } };
-	draw_list_buffer_copy(draw_list, 6, (double *)points);
-	draw_list_append(draw_list, PRIMITIVE_TYPE_LINE, 6);
-	return 0;
+	// draw the polygons of one clear segment back to front, switching
+	// styles as needed and restoring the style in effect afterwards
+	size_t applied = style;
+	size_t j = start;
+	cairo_save(cr);
+	for (; j < draw_list->sort_length; j++) {
+		if (draw_list->sort_keys[j] >> 32 != segment)
+			break;
+		if (draw_list->sort_order[j] % draw_list->decimation)
+			continue;
+		sort_item_t *item =
+			&draw_list->sort_items[draw_list->sort_order[j]];
+		if (item->style != applied) {
+			if (item->style == style) {
+				cairo_restore(cr);
+				cairo_save(cr);
+			} else {
+				_draw_list_render_style(
+					draw_list,
+					&draw_list->primitives[item->style],
+					cr, camera);
+			}
+			applied = item->style;
+		}
+		double *q = draw_list->sort_points + item->points;
+		if (draw_list->hiz_active && item->num_points > 0) {
+			double x0 = q[0], y0 = q[1], x1 = q[0], y1 = q[1];
+			for (size_t k = 1; k < item->num_points; k++) {
+				x0 = fmin(x0, q[k * 2]);
+				y0 = fmin(y0, q[k * 2 + 1]);
+				x1 = fmax(x1, q[k * 2]);
+				y1 = fmax(y1, q[k * 2 + 1]);
+			}
+			if (_draw_list_occluded(draw_list, cr, x0, y0, x1, y1,
+						item->depth_min)) {
+				STATS_COUNT(STATS_COUNTER_CULLED,
+					    item->num_points);
+				continue;
+			}
+		}
+		for (size_t k = 0; k < item->num_points; k++)
+			cairo_line_to(cr, q[k * 2], q[k * 2 + 1]);
+		if (item->closed) {
+			cairo_close_path(cr);
+			cairo_fill(cr);
+			STATS_COUNT(STATS_COUNTER_FILLS, 1);
+		} else {
+			cairo_stroke(cr);
+			STATS_COUNT(STATS_COUNTER_STROKES, 1);
+		}
+	}
+	cairo_restore(cr);
+	return j;
 }
 
-int draw_list_point(draw_list_t *draw_list, double x, double y, double z)
+static size_t _draw_list_occluders(draw_list_t *draw_list, camera_t *camera)
 {
-	double point[3] = { x, y, z };
-	draw_list_buffer_copy(draw_list, 3, (double *)point);
-	draw_list_append(draw_list, PRIMITIVE_TYPE_POINT, 3);
-	return 0;
+	// rasterize large opaque polygons drawn after the last clear into the
+	// depth buffer, returns the first primitive that may be culled
+	int width, height;
+	camera_viewport_get(camera, &width, &height);
+	if (hiz_reset(draw_list->hiz, width, height))
+		return draw_list->length;
+	size_t start = 0;
+	for (size_t i = draw_list->length; i > 0; i--) {
+		if (draw_list->primitives[i - 1].type == PRIMITIVE_TYPE_CLEAR) {
+			start = i;
+			break;
+		}
+	}
+	double alpha = 1.0;
+	projection_batch_t batch;
+	bool window = _draw_list_time_window_active(draw_list);
+	for (size_t i = 0; i < draw_list->length; i++) {
+		primitive_t *primitive = &draw_list->primitives[i];
+		if (primitive->type == PRIMITIVE_TYPE_STYLE)
+			alpha = draw_list->buffer[primitive->index + 3];
+		if (i < start || primitive->type != PRIMITIVE_TYPE_POLYGON ||
+		    alpha < 1.0 ||
+		    (window && !_draw_list_time_visible(draw_list, i)))
+			continue;
+		double *points = draw_list->buffer + primitive->index;
+		size_t num_points = primitive->length / 3;
+		draw_list->sort_points_length = 0;
+		_draw_list_sort_points_reserve(draw_list, num_points * 2);
+		double *q = draw_list->sort_points;
+		double depth = -INFINITY, area = 0.0;
+		bool visible = true;
+		for (size_t j = 0, n; j < num_points && visible; j += n) {
+			n = num_points - j;
+			if (n > DRAW_LIST_PROJECT_BATCH)
+				n = DRAW_LIST_PROJECT_BATCH;
+			camera_project_points(camera, n, &points[j * 3],
+					      &q[j * 2], batch.depth,
+					      batch.visible);
+			for (size_t k = 0; k < n && visible; k++) {
+				visible = batch.visible[k];
+				depth = fmax(depth, batch.depth[k]);
+			}
+		}
+		if (!visible)
+			continue;
+		for (size_t j = 0; j < num_points; j++) {
+			double *a = &q[j * 2];
+			double *b = &q[((j + 1) % num_points) * 2];
+			area += a[0] * b[1] - b[0] * a[1];
+		}
+		if (fabs(area) / 2.0 < draw_list->occluder_area)
+			continue;
+		hiz_occluder(draw_list->hiz, num_points, q, depth);
+	}
+	hiz_build(draw_list->hiz);
+	return start;
 }
 
-int draw_list_polygon(draw_list_t *draw_list, int num_points, double *points)
+static void _draw_list_bounds_add(double *bounds, const double *p)
 {
-	if (num_points < 3)
-		return 1;
-	draw_list_buffer_copy(draw_list, num_points * 3, (double *)points);
-	draw_list_append(draw_list, PRIMITIVE_TYPE_POLYGON, num_points * 3);
-	return 0;
+	if (isnan(p[0]) || isnan(p[1]) || isnan(p[2]))
+		return;
+	for (int k = 0; k < 3; k++) {
+		bounds[k] = fmin(bounds[k], p[k]);
+		bounds[k + 3] = fmax(bounds[k + 3], p[k]);
+	}
 }
 
-int draw_list_polyline(draw_list_t *draw_list, int num_points, double *points)
+static void _draw_list_bounds_infinite(double *bounds)
 {
-	if (num_points < 2)
-		return 1;
-	draw_list_buffer_copy(draw_list, num_points * 3, (double *)points);
-	draw_list_append(draw_list, PRIMITIVE_TYPE_POLYLINE, num_points * 3);
-	return 0;
+	for (int k = 0; k < 3; k++) {
+		bounds[k] = -INFINITY;
+		bounds[k + 3] = INFINITY;
+	}
 }
 
-int draw_list_style(draw_list_t *draw_list, double color[4], double width)
+static const double *_draw_list_bounds(draw_list_t *draw_list)
 {
-	draw_list_buffer_copy(draw_list, 4, color);
-	draw_list_buffer_copy(draw_list, 1, &width);
-	draw_list_append(draw_list, PRIMITIVE_TYPE_STYLE, 5);
-	return 0;
+	// bounds of the own primitives, empty when min > max and infinite
+	// when a clear covers the whole screen
+	double *bounds = draw_list->bounds;
+	if (draw_list->bounds_valid &&
+	    draw_list->bounds_version == draw_list->version)
+		return bounds;
+	for (int k = 0; k < 3; k++) {
+		bounds[k] = INFINITY;
+		bounds[k + 3] = -INFINITY;
+	}
+	bounds[6] = 0.0;
+	for (size_t i = 0; i < draw_list->length; i++) {
+		primitive_t *primitive = &draw_list->primitives[i];
+		double *p = draw_list->buffer + primitive->index;
+		double q[3];
+		switch (primitive->type) {
+		case PRIMITIVE_TYPE_LINE:
+		case PRIMITIVE_TYPE_POINT:
+		case PRIMITIVE_TYPE_POLYGON:
+		case PRIMITIVE_TYPE_POLYLINE:
+		case PRIMITIVE_TYPE_POLYLINES:
+			for (size_t j = 0; j + 3 <= primitive->length; j += 3)
+				_draw_list_bounds_add(bounds, p + j);
+			break;
+		case PRIMITIVE_TYPE_GRID:
+			for (int j = 0; j < 4; j++) {
+				for (int k = 0; k < 3; k++)
+					q[k] = p[k] + (j & 1 ? p[k + 3] : 0.0) +
+					       (j & 2 ? p[k + 6] : 0.0);
+				_draw_list_bounds_add(bounds, q);
+			}
+			break;
+		case PRIMITIVE_TYPE_CIRCLE:
+			for (int j = 0; j < 2; j++) {
+				for (int k = 0; k < 3; k++)
+					q[k] = p[k] + (j ? p[6] : -p[6]);
+				_draw_list_bounds_add(bounds, q);
+			}
+			break;
+		case PRIMITIVE_TYPE_BOX:
+			_draw_list_bounds_add(bounds, p);
+			_draw_list_bounds_add(bounds, p + 3);
+			break;
+		case PRIMITIVE_TYPE_STYLE:
+			bounds[6] = fmax(bounds[6], p[4]);
+			break;
+		case PRIMITIVE_TYPE_CLEAR:
+			_draw_list_bounds_infinite(bounds);
+			break;
+		default:
+			break;
+		}
+	}
+	draw_list->bounds_version = draw_list->version;
+	draw_list->bounds_valid = true;
+	return bounds;
 }
 
-int draw_list_style2(draw_list_t *draw_list, double r, double g, double b,
-		     double a, double width)
+static void _draw_list_transform_point(const double *m, const double *p,
+				       double *q)
 {
-	double color[4] = { r, g, b, a };
-	draw_list_buffer_copy(draw_list, 4, color);
-	draw_list_buffer_copy(draw_list, 1, &width);
-	draw_list_append(draw_list, PRIMITIVE_TYPE_STYLE, 5);
-	return 0;
+	for (int k = 0; k < 4; k++)
+		q[k] = m[k * 4] * p[0] + m[k * 4 + 1] * p[1] +
+		       m[k * 4 + 2] * p[2] + m[k * 4 + 3];
 }
 
-int draw_list_clear(draw_list_t *draw_list)
+static const double *_draw_list_subtree_bounds(draw_list_t *draw_list,
+						uint64_t epoch)
 {
-	draw_list_append(draw_list, PRIMITIVE_TYPE_CLEAR, 0);
-	return 0;
+	// bounds of the list and its descendants in its own coordinates,
+	// recomputed once per epoch for lists reached on several paths and
+	// not at all while nothing changed
+	double *bounds = draw_list->subtree_bounds;
+	if (draw_list->subtree_valid && draw_list->subtree_epoch == epoch)
+		return bounds;
+	memcpy(bounds, _draw_list_bounds(draw_list), sizeof(double) * 7);
+	for (size_t i = 0; i < draw_list->num_children; i++) {
+		draw_list_child_t *edge = &draw_list->children[i];
+		const double *b =
+			_draw_list_subtree_bounds(edge->draw_list, epoch);
+		bounds[6] = fmax(bounds[6], b[6]);
+		if (b[0] > b[3])
+			continue;
+		if (isinf(b[0]) || isinf(b[1]) || isinf(b[2]) ||
+		    isinf(b[3]) || isinf(b[4]) || isinf(b[5])) {
+			_draw_list_bounds_infinite(bounds);
+			continue;
+		}
+		for (int j = 0; j < 8; j++) {
+			double p[3] = { b[j & 1 ? 3 : 0], b[j & 2 ? 4 : 1],
+					b[j & 4 ? 5 : 2] };
+			double q[4];
+			_draw_list_transform_point(edge->local, p, q);
+			_draw_list_bounds_add(bounds, q);
+		}
+	}
+	draw_list->subtree_epoch = epoch;
+	draw_list->subtree_valid = true;
+	return bounds;
 }
 
-void _draw_list_render_line(draw_list_t *draw_list, primitive_t *primitive,
-			    cairo_t *cr, camera_t *camera)
+bool _draw_list_box_culled(const double *m, const double *bounds,
+			   double margin, int width, int height)
 {
-	double *points = draw_list->buffer + primitive->index;
-	size_t num = primitive->length / 6;
-	double p1[2], p2[2];
-	bool b1, b2;
-	for (int i = 0; i < (int)num; i++) {
-		b1 = camera_project(camera, &points[i * 6], p1);
-		b2 = camera_project(camera, &points[i * 6 + 3], p2);
-		if (!b1 || !b2)
+	if (bounds[0] > bounds[3])
+		return true;
+	for (int k = 0; k < 6; k++) {
+		if (isinf(bounds[k]))
+			return false;
+	}
+	double x0 = INFINITY, y0 = INFINITY, x1 = -INFINITY, y1 = -INFINITY;
+	int behind = 0;
+	for (int j = 0; j < 8; j++) {
+		double p[3] = { bounds[j & 1 ? 3 : 0], bounds[j & 2 ? 4 : 1],
+				bounds[j & 4 ? 5 : 2] };
+		double q[4];
+		_draw_list_transform_point(m, p, q);
+		if (!(q[3] > 0.0)) {
+			behind++;
 			continue;
-		cairo_move_to(cr, p1[0], p1[1]);
-		cairo_line_to(cr, p2[0], p2[1]);
-		cairo_stroke(cr);
+		}
+		x0 = fmin(x0, q[0] / q[3]);
+		y0 = fmin(y0, q[1] / q[3]);
+		x1 = fmax(x1, q[0] / q[3]);
+		y1 = fmax(y1, q[1] / q[3]);
 	}
+	if (behind == 8)
+		return true;
+	if (behind > 0)
+		return false;
+	return x1 < -margin || y1 < -margin || x0 > width + margin ||
+	       y0 > height + margin;
 }
 
-void _draw_list_render_point(draw_list_t *draw_list, primitive_t *primitive,
+static int _draw_list_render_contents(draw_list_t *draw_list, cairo_t *cr,
+				      camera_t *camera);
+
+void _draw_list_render_child(draw_list_t *draw_list, primitive_t *primitive,
 			     cairo_t *cr, camera_t *camera)
 {
-	double *points = draw_list->buffer + primitive->index;
-	size_t num_points = primitive->length / 3;
-	double p[2];
-	bool b;
-	for (int i = 0; i < (int)num_points; i++) {
-		b = camera_project(camera, &points[i * 3], p);
-		if (!b)
-			continue;
-		cairo_move_to(cr, p[0], p[1]);
-		cairo_line_to(cr, p[0], p[1]);
-		cairo_stroke(cr);
+	double index = draw_list->buffer[primitive->index];
+	if (!(index >= 0.0 && index < (double)draw_list->num_children))
+		return;
+	draw_list_child_t *edge = &draw_list->children[(size_t)index];
+	draw_list_t *child = edge->draw_list;
+	// world matrices are only recomputed below changed transforms
+	if (edge->dirty ||
+	    memcmp(edge->parent, draw_list->world, sizeof(edge->parent))) {
+		_camera_matmul4(draw_list->world, edge->local, edge->world);
+		memcpy(edge->parent, draw_list->world, sizeof(edge->parent));
+		edge->dirty = false;
 	}
+	double m[16], view[16];
+	_camera_matmul4(draw_list->view, edge->world, m);
+	const double *bounds = _draw_list_subtree_bounds(
+		child, atomic_load(&_draw_list_epoch));
+	int width, height;
+	camera_viewport_get(camera, &width, &height);
+	double margin = fmax(bounds[6], cairo_get_line_width(cr)) / 2.0 + 1.0;
+	if (_draw_list_box_culled(m, bounds, margin, width, height))
+		return;
+	camera_projection_get(camera, view);
+	camera_projection_set(camera, m);
+	child->world = edge->world;
+	child->view = draw_list->view;
+	cairo_save(cr);
+	_draw_list_render_contents(child, cr, camera);
+	cairo_restore(cr);
+	child->world = NULL;
+	child->view = NULL;
+	camera_projection_set(camera, view);
 }
 
-void _draw_list_render_polygon(draw_list_t *draw_list, primitive_t *primitive,
-			       cairo_t *cr, camera_t *camera)
+static int _draw_list_run_spans(draw_list_t *draw_list, draw_list_run_t *run,
+				primitive_type_t type, size_t size)
 {
-	double *points = draw_list->buffer + primitive->index;
-	size_t num_points = primitive->length / 3;
-	double p[2];
-	bool b = false;
-	for (int i = 0; i < (int)num_points; i++) {
-		b = camera_project(camera, &points[i * 3], p);
-		if (!b)
+	// spans of the whole lines or points of the run, a partial vertex
+	// group at the end of a primitive is left out like when rendering it
+	// on its own and ends the span
+	size_t next = SIZE_MAX;
+	for (size_t i = run->begin; i < run->end; i++) {
+		primitive_t *primitive = &draw_list->primitives[i];
+		size_t length = primitive->length - primitive->length % size;
+		if (primitive->type != type || length == 0)
 			continue;
-		cairo_line_to(cr, p[0], p[1]);
+		if (primitive->index == next) {
+			draw_list->spans[draw_list->num_spans - 1].length +=
+				length;
+		} else {
+			if (draw_list->num_spans == draw_list->spans_capacity) {
+				size_t capacity =
+					draw_list->spans_capacity > 0 ?
+						draw_list->spans_capacity * 2 :
+						16;
+				draw_list_span_t *spans =
+					realloc(draw_list->spans,
+						sizeof(draw_list_span_t) *
+							capacity);
+				if (spans == NULL)
+					return 1;
+				draw_list->spans = spans;
+				draw_list->spans_capacity = capacity;
+			}
+			draw_list->spans[draw_list->num_spans++] =
+				(draw_list_span_t){ .index = primitive->index,
+						    .length = length };
+		}
+		next = length == primitive->length ? primitive->index + length :
+						     SIZE_MAX;
 	}
-	if (b) {
-		cairo_close_path(cr);
-		cairo_fill(cr);
-	} else {
-		cairo_stroke(cr);
+	return 0;
+}
+
+static int _draw_list_runs_add(draw_list_t *draw_list, size_t begin,
+			       size_t end, size_t packable)
+{
+	// a run with a single line or point primitive gains nothing
+	if (packable < 2)
+		return 0;
+	if (draw_list->num_runs == draw_list->runs_capacity) {
+		size_t capacity = draw_list->runs_capacity > 0 ?
+					  draw_list->runs_capacity * 2 :
+					  4;
+		draw_list_run_t *runs = realloc(
+			draw_list->runs, sizeof(draw_list_run_t) * capacity);
+		if (runs == NULL)
+			return 1;
+		draw_list->runs = runs;
+		draw_list->runs_capacity = capacity;
 	}
+	draw_list_run_t *run = &draw_list->runs[draw_list->num_runs];
+	run->begin = begin;
+	run->end = end;
+	run->first = draw_list->num_spans;
+	if (_draw_list_run_spans(draw_list, run, PRIMITIVE_TYPE_LINE, 6))
+		return 1;
+	run->points = draw_list->num_spans;
+	if (_draw_list_run_spans(draw_list, run, PRIMITIVE_TYPE_POINT, 3))
+		return 1;
+	run->last = draw_list->num_spans;
+	draw_list->num_runs++;
+	return 0;
 }
 
-void _draw_list_render_polyline(draw_list_t *draw_list, primitive_t *primitive,
-				cairo_t *cr, camera_t *camera)
+static bool _draw_list_runs_update(draw_list_t *draw_list)
 {
-	double *points = draw_list->buffer + primitive->index;
-	size_t num_points = primitive->length / 3;
-	double p[2];
-	bool b1, b2;
-	b1 = camera_project(camera, &points[0], p);
-	for (int i = 0; i < (int)num_points; i++) {
-		b2 = camera_project(camera, &points[i * 3], p);
-		if (b1 && b2) {
-			cairo_line_to(cr, p[0], p[1]);
-		} else {
-			cairo_stroke(cr);
-			cairo_move_to(cr, p[0], p[1]);
+	// split the list at the primitives whose order matters for the ones
+	// around them, returns false when the runs could not be built
+	if (draw_list->runs_valid &&
+	    draw_list->runs_version == draw_list->version)
+		return true;
+	draw_list->runs_valid = false;
+	draw_list->num_runs = 0;
+	draw_list->num_spans = 0;
+	size_t begin = 0, packable = 0;
+	for (size_t i = 0; i < draw_list->length; i++) {
+		switch (draw_list->primitives[i].type) {
+		case PRIMITIVE_TYPE_LINE:
+		case PRIMITIVE_TYPE_POINT:
+			packable++;
+			continue;
+		case PRIMITIVE_TYPE_STYLE:
+		case PRIMITIVE_TYPE_CLEAR:
+		case PRIMITIVE_TYPE_CHILD:
+		case PRIMITIVE_TYPE_POLYGON:
+			break;
+		default:
+			continue;
 		}
-		b1 = b2;
+		if (_draw_list_runs_add(draw_list, begin, i, packable))
+			return false;
+		begin = i + 1;
+		packable = 0;
 	}
-	cairo_stroke(cr);
+	if (_draw_list_runs_add(draw_list, begin, draw_list->length, packable))
+		return false;
+	draw_list->runs_version = draw_list->version;
+	draw_list->runs_valid = true;
+	return true;
 }
 
-void _draw_list_render_style(draw_list_t *draw_list, primitive_t *primitive,
-			     cairo_t *cr, camera_t *camera)
+static int _draw_list_stage_timer(primitive_type_t type)
 {
-	(void)camera;
-	double *color = draw_list->buffer + primitive->index;
-	double width = draw_list->buffer[primitive->index + 4];
-	cairo_set_source_rgba(cr, color[0], color[1], color[2], color[3]);
-	cairo_set_line_width(cr, width);
+	switch (type) {
+	case PRIMITIVE_TYPE_LINE:
+		return STATS_TIMER_LINE;
+	case PRIMITIVE_TYPE_POINT:
+		return STATS_TIMER_POINT;
+	case PRIMITIVE_TYPE_POLYGON:
+		return STATS_TIMER_POLYGON;
+	case PRIMITIVE_TYPE_POLYLINE:
+	case PRIMITIVE_TYPE_POLYLINES:
+		return STATS_TIMER_POLYLINE;
+	case PRIMITIVE_TYPE_STYLE:
+		return STATS_TIMER_STYLE;
+	case PRIMITIVE_TYPE_CLEAR:
+		return STATS_TIMER_CLEAR;
+	case PRIMITIVE_TYPE_GRID:
+	case PRIMITIVE_TYPE_CIRCLE:
+	case PRIMITIVE_TYPE_BOX:
+		return STATS_TIMER_PROCEDURAL;
+	default:
+		return -1;
+	}
 }
 
-void _draw_list_render_clear(draw_list_t *draw_list, primitive_t *primitive,
-			     cairo_t *cr, camera_t *camera)
+static void _draw_list_render_run(draw_list_t *draw_list,
+				  draw_list_run_t *run, cairo_t *cr,
+				  camera_t *camera, int *stage, double *t)
 {
-	(void)primitive;
-	(void)camera;
-	(void)draw_list;
-	int width, height;
-	camera_viewport_get(camera, &width, &height);
-	cairo_rectangle(cr, 0, 0, width, height);
-	cairo_fill(cr);
+	// all lines of the run, then all of its points
+	if (run->first < run->points && *stage != PRIMITIVE_TYPE_LINE) {
+		STATS_LAP(_draw_list_stage_timer(*stage), *t);
+		*stage = PRIMITIVE_TYPE_LINE;
+	}
+	for (size_t i = run->first; i < run->points; i++) {
+		draw_list_span_t *span = &draw_list->spans[i];
+		_draw_list_render_segments(draw_list, cr, camera,
+					   draw_list->buffer + span->index,
+					   span->length / 3);
+	}
+	if (run->points < run->last && *stage != PRIMITIVE_TYPE_POINT) {
+		STATS_LAP(_draw_list_stage_timer(*stage), *t);
+		*stage = PRIMITIVE_TYPE_POINT;
+	}
+	for (size_t i = run->points; i < run->last; i++) {
+		draw_list_span_t *span = &draw_list->spans[i];
+		_draw_list_render_points(draw_list, cr, camera,
+					 draw_list->buffer + span->index,
+					 span->length / 3);
+	}
 }
 
 int draw_list_render(draw_list_t *draw_list, cairo_t *cr, camera_t *camera)
 {
+	static const double identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0,
+					     0, 0, 1, 0, 0, 0, 0, 1 };
+	double t = STATS_START();
 	camera_update(camera);
-	cairo_set_line_cap(cr, CAIRO_LINE_CAP_ROUND);
-	for (int i = 0; i < (int)draw_list->length; i++) {
+	STATS_LAP(STATS_TIMER_CAMERA_UPDATE, t);
+	double view[16];
+	camera_projection_get(camera, view);
+	draw_list->world = identity;
+	draw_list->view = view;
+	int result = _draw_list_render_contents(draw_list, cr, camera);
+	draw_list->world = NULL;
+	draw_list->view = NULL;
+	return result;
+}
+
+static int _draw_list_render_contents(draw_list_t *draw_list, cairo_t *cr,
+				      camera_t *camera)
+{
+	double t = STATS_START();
+	STATS_COUNT(STATS_COUNTER_PRIMITIVES, draw_list->length);
+	// full quality keeps the antialiasing of the caller, the lower
+	// levels turn it off until the end of the list
+	cairo_antialias_t antialias = cairo_get_antialias(cr);
+	if (draw_list->quality == RENDER_QUALITY_FULL) {
+		cairo_set_line_cap(cr, CAIRO_LINE_CAP_ROUND);
+	} else {
+		cairo_set_line_cap(cr, CAIRO_LINE_CAP_BUTT);
+		cairo_set_antialias(cr, CAIRO_ANTIALIAS_NONE);
+	}
+	draw_list->raster_active =
+		draw_list->quality == RENDER_QUALITY_DIRECT &&
+		_raster_target(&draw_list->raster, cr);
+	// in depth sorted mode all polygons of a clear segment are drawn
+	// together, at the position of the first one
+	size_t sorted = 0;
+	size_t style = SIZE_MAX;
+	uint64_t segment = 0;
+	bool segment_drawn = false;
+	size_t polygons = 0;
+	size_t cull_start = draw_list->length;
+	draw_list->hiz_active = false;
+	if (draw_list->occlusion) {
+		cull_start = _draw_list_occluders(draw_list, camera);
+		STATS_LAP(STATS_TIMER_OCCLUDERS, t);
+	}
+	if (draw_list->depth_sort) {
+		_draw_list_depth_sort(draw_list, camera);
+		STATS_LAP(STATS_TIMER_SORT, t);
+	}
+	// with time ordered primitives the window is found by binary search,
+	// the primitives from jump to first are skipped apart from the last
+	// style among them
+	bool window = _draw_list_time_window_active(draw_list);
+	size_t jump = draw_list->length, first = 0, last = draw_list->length;
+	if (window && draw_list->times_sorted && !draw_list->depth_sort &&
+	    draw_list->times_length == draw_list->length) {
+		jump = draw_list->untimed_prefix;
+		_draw_list_time_range(draw_list, &first, &last);
+	}
+	// packed runs draw their lines and points when reaching the first
+	// primitive of the run and skip them afterwards
+	bool packed = draw_list->packed && !window && !draw_list->occlusion &&
+		      draw_list->decimation == 1 &&
+		      _draw_list_runs_update(draw_list);
+	size_t run = 0;
+	// runs of primitives of the same type are timed together
+	int stage = -1;
+	for (size_t i = 0; i < last; i++) {
+		if (i == jump) {
+			for (size_t j = first; j > jump; j--) {
+				primitive_t *p = &draw_list->primitives[j - 1];
+				if (p->type != PRIMITIVE_TYPE_STYLE)
+					continue;
+				_draw_list_render_style(draw_list, p, cr,
+							camera);
+				style = j - 1;
+				break;
+			}
+			if (first > i)
+				i = first;
+			if (i >= last)
+				break;
+		}
 		primitive_t *primitive = &draw_list->primitives[i];
+		primitive_t trimmed;
+		if (window) {
+			if (!_draw_list_time_visible(draw_list, i)) {
+				// keep the segments in line with the sort
+				if (primitive->type == PRIMITIVE_TYPE_CLEAR) {
+					segment++;
+					segment_drawn = false;
+				}
+				continue;
+			}
+			primitive = _draw_list_time_trim(draw_list, i,
+							 &trimmed);
+			if (primitive == NULL)
+				continue;
+		}
+		while (packed && run < draw_list->num_runs &&
+		       draw_list->runs[run].end <= i)
+			run++;
+		if (packed && run < draw_list->num_runs &&
+		    draw_list->runs[run].begin <= i) {
+			if (draw_list->runs[run].begin == i)
+				_draw_list_render_run(draw_list,
+						      &draw_list->runs[run], cr,
+						      camera, &stage, &t);
+			if (primitive->type == PRIMITIVE_TYPE_LINE ||
+			    primitive->type == PRIMITIVE_TYPE_POINT)
+				continue;
+		}
+		if (i >= cull_start)
+			draw_list->hiz_active = true;
+		if ((int)primitive->type != stage) {
+			STATS_LAP(_draw_list_stage_timer(stage), t);
+			stage = primitive->type;
+		}
 		switch (primitive->type) {
 		case PRIMITIVE_TYPE_LINE:
 			_draw_list_render_line(draw_list, primitive, cr,
@@ -298,25 +2879,61 @@ int draw_list_render(draw_list_t *draw_list, cairo_t *cr, camera_t *camera)
 						camera);
 			break;
 		case PRIMITIVE_TYPE_POLYGON:
-			_draw_list_render_polygon(draw_list, primitive, cr,
-						  camera);
+			if (!draw_list->depth_sort) {
+				if (polygons++ % draw_list->decimation == 0)
+					_draw_list_render_polygon(
+						draw_list, primitive, cr,
+						camera);
+			} else if (!segment_drawn) {
+				sorted = _draw_list_render_sorted(
+					draw_list, sorted, segment, style, cr,
+					camera);
+				segment_drawn = true;
+			}
 			break;
 		case PRIMITIVE_TYPE_POLYLINE:
 			_draw_list_render_polyline(draw_list, primitive, cr,
 						   camera);
 			break;
+		case PRIMITIVE_TYPE_POLYLINES:
+			_draw_list_render_polylines(draw_list, primitive, cr,
+						    camera);
+			break;
+		case PRIMITIVE_TYPE_GRID:
+			_draw_list_render_grid(draw_list, primitive, cr,
+					       camera);
+			break;
+		case PRIMITIVE_TYPE_CIRCLE:
+			_draw_list_render_circle(draw_list, primitive, cr,
+						 camera);
+			break;
+		case PRIMITIVE_TYPE_BOX:
+			_draw_list_render_box(draw_list, primitive, cr,
+					      camera);
+			break;
 		case PRIMITIVE_TYPE_STYLE:
 			_draw_list_render_style(draw_list, primitive, cr,
 						camera);
+			style = i;
 			break;
 		case PRIMITIVE_TYPE_CLEAR:
 			_draw_list_render_clear(draw_list, primitive, cr,
 						camera);
+			segment++;
+			segment_drawn = false;
+			break;
+		case PRIMITIVE_TYPE_CHILD:
+			_draw_list_render_child(draw_list, primitive, cr,
+						camera);
 			break;
 		default:
 			break;
 		}
 	}
+	STATS_LAP(_draw_list_stage_timer(stage), t);
+	draw_list->hiz_active = false;
+	draw_list->raster_active = false;
+	cairo_set_antialias(cr, antialias);
 	return 0;
 }
 
@@ -327,22 +2944,6 @@ int draw_list_save_svg(draw_list_t *draw_list, const char *filename,
 	return draw_list_saves_svg(1, draw_lists, filename, camera);
 }
 
-int draw_list_saves_svg(size_t num, draw_list_t **draw_list,
-			const char *filename, camera_t *camera)
-{
-	int width, height;
-	camera_viewport_get(camera, &width, &height);
-	cairo_surface_t *surface =
-		cairo_svg_surface_create(filename, width, height);
-	cairo_t *cr = cairo_create(surface);
-	for (int i = 0; i < (int)num; i++) {
-		draw_list_render(draw_list[i], cr, camera);
-	}
-	cairo_destroy(cr);
-	cairo_surface_destroy(surface);
-	return 0;
-}
-
 int draw_list_save_png(draw_list_t *draw_list, const char *filename,
 		       camera_t *camera)
 {
@@ -389,4 +2990,141 @@ int draw_list_saves_buffer(size_t num, draw_list_t **draw_list,
 	cairo_destroy(cr);
 	cairo_surface_destroy(surface);
 	return 0;
-}
\ No newline at end of file
+}
+
+static bool _draw_list_file_supported()
+{
+	// the file stores the in-memory layout, which is only portable between
+	// little-endian hosts with 64-bit sizes
+	uint16_t one = 1;
+	return *(uint8_t *)&one == 1 && sizeof(size_t) == sizeof(uint64_t) &&
+	       sizeof(primitive_t) == 24;
+}
+
+static size_t _draw_list_file_align(size_t offset)
+{
+	return (offset + DRAW_LIST_FILE_ALIGN - 1) &
+	       ~(size_t)(DRAW_LIST_FILE_ALIGN - 1);
+}
+
+static int _draw_list_file_pad(FILE *file, size_t offset)
+{
+	static const uint8_t zeros[DRAW_LIST_FILE_ALIGN] = { 0 };
+	size_t pad = _draw_list_file_align(offset) - offset;
+	return fwrite(zeros, 1, pad, file) != pad;
+}
+
+int draw_list_write(draw_list_t *draw_list, const char *filename)
+{
+	// children are references into this process and can not be stored
+	if (!_draw_list_file_supported() || draw_list->num_children > 0)
+		return 1;
+	draw_list_file_header_t header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, DRAW_LIST_FILE_MAGIC, sizeof(header.magic));
+	header.version = DRAW_LIST_FILE_VERSION;
+	header.header_size = sizeof(header);
+	header.length = draw_list->length;
+	header.buffer_length = draw_list->buffer_length;
+	header.primitive_size = sizeof(primitive_t);
+	header.primitives_offset = _draw_list_file_align(sizeof(header));
+	header.buffer_offset = _draw_list_file_align(
+		header.primitives_offset + sizeof(primitive_t) * header.length);
+
+	FILE *file = fopen(filename, "wb");
+	if (file == NULL)
+		return 1;
+	int ret = fwrite(&header, sizeof(header), 1, file) != 1;
+	ret |= _draw_list_file_pad(file, sizeof(header));
+	// copy through a zeroed block so that struct padding is deterministic
+	primitive_t block[256];
+	for (size_t i = 0; i < draw_list->length && !ret; i += 256) {
+		size_t num = draw_list->length - i;
+		if (num > 256)
+			num = 256;
+		memset(block, 0, sizeof(block));
+		for (size_t j = 0; j < num; j++) {
+			block[j].type = draw_list->primitives[i + j].type;
+			block[j].index = draw_list->primitives[i + j].index;
+			block[j].length = draw_list->primitives[i + j].length;
+		}
+		ret |= fwrite(block, sizeof(primitive_t), num, file) != num;
+	}
+	ret |= _draw_list_file_pad(file, header.primitives_offset +
+						 sizeof(primitive_t) *
+							 header.length);
+	ret |= fwrite(draw_list->buffer, sizeof(double),
+		      draw_list->buffer_length,
+		      file) != draw_list->buffer_length;
+	ret |= fclose(file) != 0;
+	return ret;
+}
+
+draw_list_t *draw_list_map(const char *filename)
+{
+	if (!_draw_list_file_supported())
+		return NULL;
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		return NULL;
+	}
+	size_t size = st.st_size;
+	if (size < sizeof(draw_list_file_header_t)) {
+		close(fd);
+		return NULL;
+	}
+	// private read-only mapping, pages are loaded lazily on first render
+	void *mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED)
+		return NULL;
+
+	// the primitive table is checked once so that renderers can trust it,
+	// the buffer is only touched when drawing
+	draw_list_file_header_t *header = mapping;
+	bool valid = memcmp(header->magic, DRAW_LIST_FILE_MAGIC,
+			    sizeof(header->magic)) == 0 &&
+		     header->version == DRAW_LIST_FILE_VERSION &&
+		     header->header_size == sizeof(draw_list_file_header_t) &&
+		     header->primitive_size == sizeof(primitive_t) &&
+		     header->primitives_offset % DRAW_LIST_FILE_ALIGN == 0 &&
+		     header->buffer_offset % DRAW_LIST_FILE_ALIGN == 0 &&
+		     header->primitives_offset <= size &&
+		     header->buffer_offset <= size &&
+		     header->length <= (size - header->primitives_offset) /
+					       sizeof(primitive_t) &&
+		     header->buffer_length <=
+			     (size - header->buffer_offset) / sizeof(double);
+	primitive_t *primitives =
+		(primitive_t *)((uint8_t *)mapping + header->primitives_offset);
+	for (size_t i = 0; valid && i < header->length; i++) {
+		primitive_t *p = &primitives[i];
+		valid = (unsigned)p->type < PRIMITIVE_TYPE_CHILD &&
+			p->length <= header->buffer_length &&
+			p->index <= header->buffer_length - p->length &&
+			_draw_list_length_valid(p->type, p->length);
+	}
+	draw_list_t *draw_list = valid ? draw_list_create() : NULL;
+	if (draw_list == NULL) {
+		munmap(mapping, size);
+		return NULL;
+	}
+	free(draw_list->primitives);
+	free(draw_list->buffer);
+	draw_list->mapping = mapping;
+	draw_list->mapping_size = size;
+	draw_list->primitives = primitives;
+	draw_list->buffer =
+		(double *)((uint8_t *)mapping + header->buffer_offset);
+	draw_list->length = header->length;
+	draw_list->capacity = header->length;
+	draw_list->buffer_length = header->buffer_length;
+	draw_list->buffer_capacity = header->buffer_length;
+	// loading restores the mapped scene after appending overlays
+	draw_list_save(draw_list);
+	return draw_list;
+}
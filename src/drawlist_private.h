@@ -0,0 +1,274 @@
+#ifndef DRAWLIST_PRIVATE_H
+#define DRAWLIST_PRIVATE_H
+
+// draw list internals shared between the library sources, not installed
+
+#include "drawlist.h"
+#include "hiz.h"
+#include "pick_private.h"
+#include "raster_private.h"
+
+#include <stdatomic.h>
+
+// triple buffering: the producer fills its back slot, the viewer renders its
+// front slot and the middle slot is exchanged between them
+#define DRAW_LIST_SHARED_SLOTS 3
+
+struct primitive_s {
+	primitive_type_t type;
+	size_t index;
+	size_t length;
+};
+
+typedef struct {
+	// polygon primitive and the style primitive in effect for it
+	size_t primitive;
+	size_t style;
+	// projected points, offset into sort_points (pairs of doubles)
+	size_t points;
+	size_t num_points;
+	bool closed;
+	double depth_min;
+	// segment (number of preceding clears) and inverted depth
+	uint64_t key;
+} sort_item_t;
+
+typedef struct {
+	// time span of the primitive and the latest end of any timed
+	// primitive up to it, nan for untimed primitives
+	double begin;
+	double end;
+	double reach;
+	// first per-vertex stamp in vertex_times, SIZE_MAX for none
+	size_t vertices;
+} primitive_time_t;
+
+// primitives and buffer of cloned draw lists, a list writing to them takes a
+// private copy unless it only appends right after everything written so far
+typedef struct {
+	atomic_size_t references;
+	primitive_t *primitives;
+	size_t capacity;
+	double *buffer;
+	size_t buffer_capacity;
+	// elements written by any of the lists
+	atomic_size_t length;
+	atomic_size_t buffer_length;
+	// read-only file mapping the arrays point into, if any
+	void *mapping;
+	size_t mapping_size;
+} draw_list_storage_t;
+
+typedef struct {
+	char *name;
+	draw_list_t *snapshot;
+} draw_list_checkpoint_t;
+
+// vertices of lines or points stored back to back in the buffer
+typedef struct {
+	size_t index;
+	size_t length;
+} draw_list_span_t;
+
+// primitives begin up to end contain no style, clear, child or polygon, so
+// their lines and points can be drawn in any order; the lines are spans
+// first up to points, the points spans points up to last
+typedef struct {
+	size_t begin;
+	size_t end;
+	size_t first;
+	size_t points;
+	size_t last;
+} draw_list_run_t;
+
+typedef struct {
+	draw_list_t *draw_list;
+	double local[16];
+	// world matrix and the world matrix of the parent it was computed
+	// from, recomputed when either the parent or local changes
+	double world[16];
+	double parent[16];
+	bool dirty;
+} draw_list_child_t;
+
+struct draw_list_s {
+	size_t length;
+	size_t length_saved;
+	size_t capacity;
+	size_t buffer_length;
+	size_t buffer_length_saved;
+	size_t buffer_capacity;
+	primitive_t *primitives;
+	double *buffer;
+	// painter's algorithm state, kept across frames to reuse allocations
+	// and the previous order for incremental re-sorting
+	bool depth_sort;
+	size_t sort_length;
+	size_t sort_capacity;
+	sort_item_t *sort_items;
+	uint64_t *sort_keys;
+	uint64_t *sort_keys_tmp;
+	uint32_t *sort_order;
+	uint32_t *sort_order_tmp;
+	size_t sort_points_length;
+	size_t sort_points_capacity;
+	double *sort_points;
+	// coarse occlusion culling against large opaque polygons
+	bool occlusion;
+	double occluder_area;
+	hiz_t *hiz;
+	bool hiz_active;
+	// stroking quality, the direct rasterizer is active during a render
+	// into a surface it can write
+	render_quality_t quality;
+	raster_t raster;
+	bool raster_active;
+	// only every n-th point, line, polyline vertex and polygon is drawn
+	size_t decimation;
+	// packed rendering draws the lines and points of each run in one go
+	// at its start, the runs are valid for runs_version
+	bool packed;
+	size_t num_runs;
+	size_t runs_capacity;
+	draw_list_run_t *runs;
+	size_t num_spans;
+	size_t spans_capacity;
+	draw_list_span_t *spans;
+	uint64_t runs_version;
+	bool runs_valid;
+	// referenced child lists, drawn with their local transform in place
+	// of the child primitives; world and view are only set while the
+	// list is rendered
+	size_t num_children;
+	size_t num_children_saved;
+	size_t children_capacity;
+	draw_list_child_t *children;
+	// lists owned by a snapshot from _draw_list_copy that its children
+	// point to, reused by the next copy
+	size_t copies_capacity;
+	draw_list_t **copies;
+	const double *world;
+	const double *view;
+	// bounds of the own primitives (min, max) and the widest style,
+	// valid for bounds_version
+	double bounds[7];
+	uint64_t bounds_version;
+	bool bounds_valid;
+	// bounds of the list and all lists below it in its own coordinates,
+	// valid while no list or child transform changed since subtree_epoch
+	double subtree_bounds[7];
+	uint64_t subtree_epoch;
+	bool subtree_valid;
+	// timestamps of the primitives, allocated by the first
+	// draw_list_time_set; primitives past times_length are untimed
+	double time;
+	size_t times_length;
+	size_t times_length_saved;
+	size_t times_capacity;
+	primitive_time_t *times;
+	size_t vertex_times_length;
+	size_t vertex_times_length_saved;
+	size_t vertex_times_capacity;
+	double *vertex_times;
+	// begins never decrease after the leading untimed primitives, which
+	// allows binary searches for the time window
+	bool times_sorted;
+	bool times_sorted_saved;
+	size_t untimed_prefix;
+	size_t untimed_prefix_saved;
+	double time_window[2];
+	// screen space grid for draw_list_pick
+	pick_index_t pick;
+	// vertices of procedural primitives, generated while rendering
+	size_t expanded_capacity;
+	double *expanded;
+	// read-only file mapping backing primitives and buffer, if any
+	void *mapping;
+	size_t mapping_size;
+	// storage shared with clones, NULL while the arrays are private
+	draw_list_storage_t *storage;
+	// named clones for draw_list_checkpoint_rewind, oldest first
+	size_t num_checkpoints;
+	size_t checkpoints_capacity;
+	draw_list_checkpoint_t *checkpoints;
+	// bumped on every change of the contents
+	uint64_t version;
+	// unique among all lists ever created in the process, unlike the
+	// address of the list
+	uint64_t serial;
+	// shared memory segment the contents live in, if any; the producer
+	// writes into its back slot, the viewer only reads its front slot
+	struct draw_list_shared_s *shared;
+	size_t shared_size;
+	char *shared_name;
+	uint32_t shared_slot;
+	bool shared_writer;
+	// slot layout, read from the header once so that a producer can not
+	// move the slots under a viewer after they were checked
+	size_t shared_slot_offset;
+	size_t shared_slot_size;
+	size_t shared_buffer_offset;
+	// lowest lengths since the last publish and how far the contents of
+	// each slot still match the list, publishing copies only the rest
+	size_t shared_low;
+	size_t shared_buffer_low;
+	size_t shared_kept[DRAW_LIST_SHARED_SLOTS];
+	size_t shared_buffer_kept[DRAW_LIST_SHARED_SLOTS];
+};
+
+// note a change of the contents, bumps the version of the list and the
+// epoch the subtree bounds of all lists are cached for
+void _draw_list_changed(draw_list_t *draw_list);
+
+// grow the storage for direct writes, detaches file mappings and storage
+// shared with clones
+int _draw_list_reserve(draw_list_t *draw_list, size_t length,
+		       size_t buffer_length);
+
+// exchange the contents and children of two heap backed draw lists,
+// settings and caches stay with their list
+int _draw_list_swap(draw_list_t *a, draw_list_t *b);
+
+// copy the contents and render settings of src into a heap backed dst,
+// child lists are copied too so that dst can be rendered while src and its
+// children change
+int _draw_list_copy(draw_list_t *dst, draw_list_t *src);
+
+// replace the children by num edges to the given lists with the given
+// local transforms (16 doubles each), the lists must not reach dst
+int _draw_list_children_load(draw_list_t *draw_list, size_t num,
+			     draw_list_t **children, const double *locals);
+
+// whether a payload of length doubles fits primitives of this type: whole
+// vertices for the variable length types, renderers read fixed size
+// payloads unchecked
+bool _draw_list_length_valid(primitive_type_t type, size_t length);
+
+// whether the box (min, max) projected by the row major matrix m lies
+// outside of the viewport grown by margin pixels, boxes crossing the
+// camera plane are kept
+bool _draw_list_box_culled(const double *m, const double *bounds,
+			   double margin, int width, int height);
+
+// project the polygons into sort_items and order them back to front per
+// clear segment in sort_order
+void _draw_list_depth_sort(draw_list_t *draw_list, camera_t *camera);
+
+// whether a time window other than the whole time line is set
+bool _draw_list_time_window_active(draw_list_t *draw_list);
+
+// whether primitive i overlaps the time window, styles always do
+bool _draw_list_time_visible(draw_list_t *draw_list, size_t i);
+
+// primitive i narrowed to its vertices inside the time window, stored in
+// trimmed if needed, NULL when nothing is left to draw
+primitive_t *_draw_list_time_trim(draw_list_t *draw_list, size_t i,
+				  primitive_t *trimmed);
+
+// release the shared memory segment of a shared draw list
+int _draw_list_shared_close(draw_list_t *draw_list);
+
+// note that the contents past the current lengths are being replaced
+void _draw_list_shared_truncated(draw_list_t *draw_list);
+
+#endif
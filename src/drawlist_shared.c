@@ -0,0 +1,357 @@
+// shm_open and ftruncate are not part of iso c
+#define _POSIX_C_SOURCE 200809L
+
+#include "drawlist.h"
+#include "drawlist_private.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define DRAW_LIST_SHARED_MAGIC "D3DSHM"
+#define DRAW_LIST_SHARED_VERSION 2
+#define DRAW_LIST_SHARED_ALIGN 64
+#define DRAW_LIST_SHARED_DIRTY 0x80000000u
+
+typedef struct {
+	uint64_t sequence;
+	uint64_t length;
+	uint64_t buffer_length;
+	uint64_t reserved;
+} draw_list_shared_slot_t;
+
+struct draw_list_shared_s {
+	char magic[8];
+	uint32_t version;
+	uint32_t primitive_size;
+	uint64_t capacity;
+	uint64_t buffer_capacity;
+	uint64_t slot_offset;
+	uint64_t slot_size;
+	uint64_t buffer_offset;
+	// number of published frames
+	_Atomic uint64_t sequence;
+	// index of the middle slot, with the dirty bit set when it holds a
+	// frame the viewer has not picked up yet
+	_Atomic uint32_t middle;
+	// set once the producer finished initializing the segment
+	_Atomic uint32_t ready;
+	// process id of the producer
+	uint32_t owner;
+	draw_list_shared_slot_t slots[DRAW_LIST_SHARED_SLOTS];
+};
+
+static size_t _draw_list_shared_align(size_t offset)
+{
+	return (offset + DRAW_LIST_SHARED_ALIGN - 1) &
+	       ~(size_t)(DRAW_LIST_SHARED_ALIGN - 1);
+}
+
+static void _draw_list_shared_attach(draw_list_t *draw_list, uint32_t slot)
+{
+	uint8_t *data = (uint8_t *)draw_list->shared +
+			draw_list->shared_slot_offset +
+			draw_list->shared_slot_size * slot;
+	draw_list->shared_slot = slot;
+	draw_list->primitives = (primitive_t *)data;
+	draw_list->buffer = (double *)(data + draw_list->shared_buffer_offset);
+}
+
+static draw_list_t *_draw_list_shared_wrap(struct draw_list_shared_s *shared,
+					   size_t size, bool writer,
+					   size_t capacity,
+					   size_t buffer_capacity,
+					   size_t slot_offset, size_t slot_size,
+					   size_t buffer_offset)
+{
+	draw_list_t *draw_list = draw_list_create();
+	if (draw_list == NULL)
+		return NULL;
+	free(draw_list->primitives);
+	free(draw_list->buffer);
+	draw_list->shared = shared;
+	draw_list->shared_size = size;
+	draw_list->shared_writer = writer;
+	draw_list->shared_slot_offset = slot_offset;
+	draw_list->shared_slot_size = slot_size;
+	draw_list->shared_buffer_offset = buffer_offset;
+	draw_list->capacity = capacity;
+	draw_list->buffer_capacity = buffer_capacity;
+	return draw_list;
+}
+
+static bool _draw_list_shared_frame(draw_list_t *draw_list, uint64_t length,
+				    uint64_t buffer_length)
+{
+	// the checks of draw_list_map against the slot capacities, children
+	// are local to a process and never shared
+	if (length > draw_list->capacity ||
+	    buffer_length > draw_list->buffer_capacity)
+		return false;
+	for (size_t i = 0; i < length; i++) {
+		primitive_t *p = &draw_list->primitives[i];
+		if ((unsigned)p->type >= PRIMITIVE_TYPE_CHILD ||
+		    p->length > buffer_length ||
+		    p->index > buffer_length - p->length ||
+		    !_draw_list_length_valid(p->type, p->length))
+			return false;
+	}
+	return true;
+}
+
+static bool _draw_list_shared_stale(const char *name)
+{
+	// a segment left behind by a crashed producer is unlinked, one whose
+	// producer is still running or still initializing it is kept
+	int fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	struct draw_list_shared_s *shared = MAP_FAILED;
+	if (fstat(fd, &st) == 0 &&
+	    (size_t)st.st_size >= sizeof(struct draw_list_shared_s))
+		shared = mmap(NULL, sizeof(*shared), PROT_READ, MAP_SHARED, fd,
+			      0);
+	close(fd);
+	if (shared == MAP_FAILED)
+		return false;
+	pid_t owner = shared->owner;
+	bool stale =
+		atomic_load_explicit(&shared->ready, memory_order_acquire) &&
+		owner > 0 && kill(owner, 0) != 0 && errno == ESRCH;
+	munmap(shared, sizeof(*shared));
+	return stale && shm_unlink(name) == 0;
+}
+
+draw_list_t *draw_list_shared_create(const char *name, size_t capacity,
+				     size_t buffer_capacity)
+{
+	if (capacity < 1 || buffer_capacity < 1)
+		return NULL;
+	size_t buffer_offset =
+		_draw_list_shared_align(sizeof(primitive_t) * capacity);
+	size_t slot_size = _draw_list_shared_align(
+		buffer_offset + sizeof(double) * buffer_capacity);
+	size_t slot_offset =
+		_draw_list_shared_align(sizeof(struct draw_list_shared_s));
+	size_t size = slot_offset + slot_size * DRAW_LIST_SHARED_SLOTS;
+
+	int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd < 0 && errno == EEXIST && _draw_list_shared_stale(name))
+		fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd < 0)
+		return NULL;
+	if (ftruncate(fd, size) != 0) {
+		close(fd);
+		shm_unlink(name);
+		return NULL;
+	}
+	void *mapping =
+		mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED) {
+		shm_unlink(name);
+		return NULL;
+	}
+
+	// the segment is zero filled by ftruncate
+	struct draw_list_shared_s *shared = mapping;
+	memcpy(shared->magic, DRAW_LIST_SHARED_MAGIC,
+	       sizeof(DRAW_LIST_SHARED_MAGIC));
+	shared->version = DRAW_LIST_SHARED_VERSION;
+	shared->primitive_size = sizeof(primitive_t);
+	shared->capacity = capacity;
+	shared->buffer_capacity = buffer_capacity;
+	shared->slot_offset = slot_offset;
+	shared->slot_size = slot_size;
+	shared->buffer_offset = buffer_offset;
+	shared->owner = getpid();
+	atomic_store(&shared->sequence, 0);
+	atomic_store(&shared->middle, 1);
+	atomic_store_explicit(&shared->ready, 1, memory_order_release);
+
+	draw_list_t *draw_list =
+		_draw_list_shared_wrap(shared, size, true, capacity,
+				       buffer_capacity, slot_offset, slot_size,
+				       buffer_offset);
+	if (draw_list == NULL) {
+		munmap(mapping, size);
+		shm_unlink(name);
+		return NULL;
+	}
+	// the name is only needed to unlink the segment on destroy
+	draw_list->shared_name = strdup(name);
+	_draw_list_shared_attach(draw_list, 0);
+	return draw_list;
+}
+
+draw_list_t *draw_list_shared_open(const char *name)
+{
+	int fd = shm_open(name, O_RDWR, 0);
+	if (fd < 0)
+		return NULL;
+	struct stat st;
+	if (fstat(fd, &st) != 0 ||
+	    (size_t)st.st_size < sizeof(struct draw_list_shared_s)) {
+		close(fd);
+		return NULL;
+	}
+	size_t size = st.st_size;
+	// the viewer writes only the middle slot index of the header
+	void *mapping =
+		mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED)
+		return NULL;
+
+	// the layout is read once and has to fit the mapping, frames are
+	// checked against it on every poll
+	struct draw_list_shared_s *shared = mapping;
+	bool ready = atomic_load_explicit(&shared->ready, memory_order_acquire);
+	uint64_t capacity = shared->capacity;
+	uint64_t buffer_capacity = shared->buffer_capacity;
+	uint64_t slot_offset = shared->slot_offset;
+	uint64_t slot_size = shared->slot_size;
+	uint64_t buffer_offset = shared->buffer_offset;
+	bool valid =
+		ready &&
+		memcmp(shared->magic, DRAW_LIST_SHARED_MAGIC,
+		       sizeof(DRAW_LIST_SHARED_MAGIC)) == 0 &&
+		shared->version == DRAW_LIST_SHARED_VERSION &&
+		shared->primitive_size == sizeof(primitive_t) &&
+		slot_offset % DRAW_LIST_SHARED_ALIGN == 0 &&
+		slot_size % DRAW_LIST_SHARED_ALIGN == 0 &&
+		buffer_offset % DRAW_LIST_SHARED_ALIGN == 0 &&
+		slot_offset >= sizeof(struct draw_list_shared_s) &&
+		slot_offset <= size &&
+		slot_size <= (size - slot_offset) / DRAW_LIST_SHARED_SLOTS &&
+		buffer_offset <= slot_size && capacity >= 1 &&
+		capacity <= buffer_offset / sizeof(primitive_t) &&
+		buffer_capacity >= 1 &&
+		buffer_capacity <= (slot_size - buffer_offset) / sizeof(double);
+	draw_list_t *draw_list =
+		valid ? _draw_list_shared_wrap(shared, size, false, capacity,
+					       buffer_capacity, slot_offset,
+					       slot_size, buffer_offset)
+		      : NULL;
+	if (draw_list == NULL) {
+		munmap(mapping, size);
+		return NULL;
+	}
+	_draw_list_shared_attach(draw_list, 2);
+	draw_list_shared_poll(draw_list);
+	return draw_list;
+}
+
+int draw_list_shared_publish(draw_list_t *draw_list)
+{
+	if (draw_list->shared == NULL || !draw_list->shared_writer)
+		return 1;
+	struct draw_list_shared_s *shared = draw_list->shared;
+	draw_list_shared_slot_t *slot = &shared->slots[draw_list->shared_slot];
+	slot->length = draw_list->length;
+	slot->buffer_length = draw_list->buffer_length;
+	slot->sequence = atomic_fetch_add(&shared->sequence, 1) + 1;
+
+	// the other slots keep at most what was not replaced since
+	for (uint32_t i = 0; i < DRAW_LIST_SHARED_SLOTS; i++) {
+		if (draw_list->shared_kept[i] > draw_list->shared_low)
+			draw_list->shared_kept[i] = draw_list->shared_low;
+		if (draw_list->shared_buffer_kept[i] >
+		    draw_list->shared_buffer_low)
+			draw_list->shared_buffer_kept[i] =
+				draw_list->shared_buffer_low;
+	}
+	draw_list->shared_kept[draw_list->shared_slot] = draw_list->length;
+	draw_list->shared_buffer_kept[draw_list->shared_slot] =
+		draw_list->buffer_length;
+	draw_list->shared_low = draw_list->length;
+	draw_list->shared_buffer_low = draw_list->buffer_length;
+
+	// the exchange publishes the slot and hands back the one the viewer
+	// released or the stale middle one
+	primitive_t *primitives = draw_list->primitives;
+	double *buffer = draw_list->buffer;
+	uint32_t back = atomic_exchange(&shared->middle,
+					draw_list->shared_slot |
+						DRAW_LIST_SHARED_DIRTY);
+	_draw_list_shared_attach(draw_list, back & ~DRAW_LIST_SHARED_DIRTY);
+
+	// keep the contents so that building continues as with a private
+	// list, the slot already holds them up to where they last changed
+	uint32_t i = draw_list->shared_slot;
+	size_t kept = draw_list->shared_kept[i];
+	size_t buffer_kept = draw_list->shared_buffer_kept[i];
+	memcpy(draw_list->primitives + kept, primitives + kept,
+	       sizeof(primitive_t) * (draw_list->length - kept));
+	memcpy(draw_list->buffer + buffer_kept, buffer + buffer_kept,
+	       sizeof(double) * (draw_list->buffer_length - buffer_kept));
+	draw_list->shared_kept[i] = draw_list->length;
+	draw_list->shared_buffer_kept[i] = draw_list->buffer_length;
+	return 0;
+}
+
+bool draw_list_shared_poll(draw_list_t *draw_list)
+{
+	if (draw_list->shared == NULL || draw_list->shared_writer)
+		return false;
+	struct draw_list_shared_s *shared = draw_list->shared;
+	if (!(atomic_load(&shared->middle) & DRAW_LIST_SHARED_DIRTY))
+		return false;
+	uint32_t front = atomic_exchange(&shared->middle,
+					 draw_list->shared_slot) &
+			 ~DRAW_LIST_SHARED_DIRTY;
+	// a frame that does not fit its slot or indexes past its buffer is
+	// dropped, leaving the list empty until the next valid one
+	bool valid = front < DRAW_LIST_SHARED_SLOTS;
+	if (valid)
+		_draw_list_shared_attach(draw_list, front);
+	draw_list_shared_slot_t *slot = &shared->slots[draw_list->shared_slot];
+	uint64_t length = slot->length;
+	uint64_t buffer_length = slot->buffer_length;
+	if (!valid ||
+	    !_draw_list_shared_frame(draw_list, length, buffer_length)) {
+		length = 0;
+		buffer_length = 0;
+	}
+	draw_list->length = length;
+	draw_list->buffer_length = buffer_length;
+	draw_list_save(draw_list);
+	_draw_list_changed(draw_list);
+	return true;
+}
+
+uint64_t draw_list_shared_sequence(draw_list_t *draw_list)
+{
+	if (draw_list->shared == NULL)
+		return 0;
+	if (draw_list->shared_writer)
+		return atomic_load(&draw_list->shared->sequence);
+	return draw_list->shared->slots[draw_list->shared_slot].sequence;
+}
+
+void _draw_list_shared_truncated(draw_list_t *draw_list)
+{
+	if (draw_list->length < draw_list->shared_low)
+		draw_list->shared_low = draw_list->length;
+	if (draw_list->buffer_length < draw_list->shared_buffer_low)
+		draw_list->shared_buffer_low = draw_list->buffer_length;
+}
+
+int _draw_list_shared_close(draw_list_t *draw_list)
+{
+	int ret = munmap(draw_list->shared, draw_list->shared_size) != 0;
+	if (draw_list->shared_name != NULL) {
+		ret |= shm_unlink(draw_list->shared_name) != 0;
+		free(draw_list->shared_name);
+	}
+	draw_list->shared = NULL;
+	draw_list->shared_name = NULL;
+	return ret;
+}
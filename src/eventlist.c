@@ -1,5 +1,10 @@
 #include "eventlist.h"
 
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
 struct event_list_s {
 	size_t length;
 	size_t capacity;
@@ -69,4 +74,185 @@ int event_list_poll(event_list_t *event_list)
 			return 1;
 	}
 	return 0;
-}
\ No newline at end of file
+}
+
+// scripted events, replayed frame by frame in place of event_list_poll
+typedef struct {
+	size_t frame;
+	SDL_Event event;
+} event_script_entry_t;
+
+struct event_script_s {
+	size_t length;
+	size_t capacity;
+	event_script_entry_t *entries;
+	// next entry and frame to poll
+	size_t position;
+	size_t frame;
+};
+
+event_script_t *event_script_create()
+{
+	event_script_t *script = calloc(1, sizeof(event_script_t));
+	return script;
+}
+
+event_script_t *event_script_load(const char *filename)
+{
+	FILE *file = fopen(filename, "r");
+	if (file == NULL)
+		return NULL;
+	event_script_t *script = event_script_create();
+	if (script == NULL) {
+		fclose(file);
+		return NULL;
+	}
+	// one event per line: <frame> <command> [arguments]
+	char line[256];
+	size_t number = 0;
+	while (fgets(line, sizeof(line), file) != NULL) {
+		number++;
+		size_t frame;
+		int n;
+		char *start = line + strspn(line, " \t");
+		if (*start == '#' || *start == '\n' || *start == '\0')
+			continue;
+		if (sscanf(start, "%zu%n", &frame, &n) != 1 ||
+		    event_script_add(script, frame, start + n)) {
+			fprintf(stderr, "%s:%zu: invalid event\n", filename,
+				number);
+			event_script_destroy(script);
+			fclose(file);
+			return NULL;
+		}
+	}
+	fclose(file);
+	return script;
+}
+
+int event_script_destroy(event_script_t *script)
+{
+	free(script->entries);
+	free(script);
+	return 0;
+}
+
+static int _event_script_parse(const char *command, SDL_Event *event)
+{
+	char verb[32];
+	int n, x, y;
+	if (sscanf(command, "%31s%n", verb, &n) != 1)
+		return 1;
+	const char *args = command + n;
+	memset(event, 0, sizeof(SDL_Event));
+	if (!strcmp(verb, "key_down") || !strcmp(verb, "key_up")) {
+		// key names may contain spaces, e.g. "Left Shift"
+		char name[64];
+		args += strspn(args, " \t");
+		size_t length = strcspn(args, "\r\n");
+		while (length > 0 &&
+		       (args[length - 1] == ' ' || args[length - 1] == '\t'))
+			length--;
+		if (length == 0 || length >= sizeof(name))
+			return 1;
+		memcpy(name, args, length);
+		name[length] = '\0';
+		SDL_Scancode scancode = SDL_GetScancodeFromName(name);
+		if (scancode == SDL_SCANCODE_UNKNOWN)
+			return 1;
+		bool down = !strcmp(verb, "key_down");
+		event->type = down ? SDL_KEYDOWN : SDL_KEYUP;
+		event->key.state = down ? SDL_PRESSED : SDL_RELEASED;
+		event->key.keysym.scancode = scancode;
+	} else if (!strcmp(verb, "button_down") || !strcmp(verb, "button_up")) {
+		if (sscanf(args, "%d", &x) != 1 || x < 1 || x > 255)
+			return 1;
+		bool down = !strcmp(verb, "button_down");
+		event->type = down ? SDL_MOUSEBUTTONDOWN : SDL_MOUSEBUTTONUP;
+		event->button.state = down ? SDL_PRESSED : SDL_RELEASED;
+		event->button.button = x;
+	} else if (!strcmp(verb, "motion")) {
+		if (sscanf(args, "%d %d", &x, &y) != 2)
+			return 1;
+		event->type = SDL_MOUSEMOTION;
+		event->motion.xrel = x;
+		event->motion.yrel = y;
+	} else if (!strcmp(verb, "wheel")) {
+		if (sscanf(args, "%d", &y) != 1)
+			return 1;
+		event->type = SDL_MOUSEWHEEL;
+		event->wheel.y = y;
+	} else if (!strcmp(verb, "resize")) {
+		if (sscanf(args, "%d %d", &x, &y) != 2 || x < 1 || y < 1)
+			return 1;
+		event->type = SDL_WINDOWEVENT;
+		event->window.event = SDL_WINDOWEVENT_RESIZED;
+		event->window.data1 = x;
+		event->window.data2 = y;
+	} else if (!strcmp(verb, "close")) {
+		event->type = SDL_WINDOWEVENT;
+		event->window.event = SDL_WINDOWEVENT_CLOSE;
+	} else if (!strcmp(verb, "quit")) {
+		event->type = SDL_QUIT;
+	} else {
+		return 1;
+	}
+	return 0;
+}
+
+int event_script_add(event_script_t *script, size_t frame, const char *command)
+{
+	SDL_Event event;
+	if (_event_script_parse(command, &event))
+		return 1;
+	if (script->length == script->capacity) {
+		size_t capacity = script->capacity ? script->capacity * 2 : 16;
+		event_script_entry_t *entries =
+			realloc(script->entries,
+				sizeof(event_script_entry_t) * capacity);
+		if (entries == NULL)
+			return 1;
+		script->entries = entries;
+		script->capacity = capacity;
+	}
+	// keep the entries ordered by frame, then by insertion
+	size_t i = script->length;
+	while (i > 0 && script->entries[i - 1].frame > frame)
+		i--;
+	memmove(&script->entries[i + 1], &script->entries[i],
+		sizeof(event_script_entry_t) * (script->length - i));
+	script->entries[i].frame = frame;
+	script->entries[i].event = event;
+	script->length++;
+	return 0;
+}
+
+int event_script_rewind(event_script_t *script)
+{
+	script->position = 0;
+	script->frame = 0;
+	return 0;
+}
+
+size_t event_script_frame(event_script_t *script)
+{
+	return script->frame;
+}
+
+int event_script_poll(event_script_t *script, event_list_t *event_list)
+{
+	// appends the events of the current frame and advances to the next,
+	// returns 1 on a quit event like event_list_poll
+	while (script->position < script->length &&
+	       script->entries[script->position].frame <= script->frame) {
+		SDL_Event *event = &script->entries[script->position].event;
+		script->position++;
+		event_list_append(event_list, event);
+		if (event->type == SDL_QUIT) {
+			script->frame++;
+			return 1;
+		}
+	}
+	script->frame++;
+	return 0;
+}
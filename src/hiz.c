@@ -0,0 +1,223 @@
+#include "hiz.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+// size of a level 0 tile in pixels
+#define HIZ_TILE 8
+#define HIZ_MAX_LEVELS 16
+
+struct hiz_s {
+	int width;
+	int height;
+	int num_levels;
+	int level_width[HIZ_MAX_LEVELS];
+	int level_height[HIZ_MAX_LEVELS];
+	// farthest occluder depth covering each tile, per level
+	float *levels[HIZ_MAX_LEVELS];
+	size_t capacity;
+	float *data;
+};
+
+hiz_t *hiz_create()
+{
+	hiz_t *hiz = malloc(sizeof(hiz_t));
+	if (hiz == NULL)
+		return NULL;
+	hiz->width = 0;
+	hiz->height = 0;
+	hiz->num_levels = 0;
+	hiz->capacity = 0;
+	hiz->data = NULL;
+	return hiz;
+}
+
+int hiz_destroy(hiz_t *hiz)
+{
+	free(hiz->data);
+	free(hiz);
+	return 0;
+}
+
+int hiz_reset(hiz_t *hiz, int width, int height)
+{
+	if (width < 1 || height < 1)
+		return 1;
+	if (width != hiz->width || height != hiz->height) {
+		size_t total = 0;
+		int w = (width + HIZ_TILE - 1) / HIZ_TILE;
+		int h = (height + HIZ_TILE - 1) / HIZ_TILE;
+		int n = 0;
+		while (n < HIZ_MAX_LEVELS) {
+			hiz->level_width[n] = w;
+			hiz->level_height[n] = h;
+			total += (size_t)w * h;
+			n++;
+			if (w == 1 && h == 1)
+				break;
+			w = (w + 1) / 2;
+			h = (h + 1) / 2;
+		}
+		if (total > hiz->capacity) {
+			float *data = realloc(hiz->data, sizeof(float) * total);
+			if (data == NULL)
+				return 1;
+			hiz->data = data;
+			hiz->capacity = total;
+		}
+		float *level = hiz->data;
+		for (int i = 0; i < n; i++) {
+			hiz->levels[i] = level;
+			level += (size_t)hiz->level_width[i] *
+				 hiz->level_height[i];
+		}
+		hiz->num_levels = n;
+		hiz->width = width;
+		hiz->height = height;
+	}
+	size_t size = (size_t)hiz->level_width[0] * hiz->level_height[0];
+	for (size_t i = 0; i < size; i++)
+		hiz->levels[0][i] = INFINITY;
+	return 0;
+}
+
+static bool _hiz_inside(int num_points, double *points, double sign, double x,
+			double y)
+{
+	for (int i = 0; i < num_points; i++) {
+		double *a = &points[i * 2];
+		double *b = &points[((i + 1) % num_points) * 2];
+		double e = (b[0] - a[0]) * (y - a[1]) -
+			   (b[1] - a[1]) * (x - a[0]);
+		if (e * sign < 0.0)
+			return false;
+	}
+	return true;
+}
+
+int hiz_occluder(hiz_t *hiz, int num_points, double *points, double depth)
+{
+	// only convex polygons are rasterized, a tile is covered when all of
+	// its corners are inside
+	if (num_points < 3 || hiz->num_levels == 0)
+		return 1;
+	double sign = 0.0;
+	double x0 = INFINITY, y0 = INFINITY, x1 = -INFINITY, y1 = -INFINITY;
+	for (int i = 0; i < num_points; i++) {
+		double *a = &points[i * 2];
+		double *b = &points[((i + 1) % num_points) * 2];
+		double *c = &points[((i + 2) % num_points) * 2];
+		double cross = (b[0] - a[0]) * (c[1] - b[1]) -
+			       (b[1] - a[1]) * (c[0] - b[0]);
+		if (cross != 0.0) {
+			if (sign == 0.0)
+				sign = cross > 0.0 ? 1.0 : -1.0;
+			else if (cross * sign < 0.0)
+				return 1;
+		}
+		x0 = fmin(x0, a[0]);
+		y0 = fmin(y0, a[1]);
+		x1 = fmax(x1, a[0]);
+		y1 = fmax(y1, a[1]);
+	}
+	if (sign == 0.0)
+		return 1;
+	// stored rounded up, so that rounding to float never moves an
+	// occluder in front of surfaces at its own depth
+	float stored = (float)depth;
+	if (stored < depth)
+		stored = nextafterf(stored, INFINITY);
+	int w = hiz->level_width[0];
+	int h = hiz->level_height[0];
+	int tx0 = (int)fmax(floor(x0 / HIZ_TILE), 0.0);
+	int ty0 = (int)fmax(floor(y0 / HIZ_TILE), 0.0);
+	int tx1 = (int)fmin(floor(x1 / HIZ_TILE), w - 1);
+	int ty1 = (int)fmin(floor(y1 / HIZ_TILE), h - 1);
+	float *level = hiz->levels[0];
+	for (int ty = ty0; ty <= ty1; ty++) {
+		double cy0 = ty * HIZ_TILE;
+		double cy1 = cy0 + HIZ_TILE;
+		for (int tx = tx0; tx <= tx1; tx++) {
+			double cx0 = tx * HIZ_TILE;
+			double cx1 = cx0 + HIZ_TILE;
+			if (!_hiz_inside(num_points, points, sign, cx0, cy0) ||
+			    !_hiz_inside(num_points, points, sign, cx1, cy0) ||
+			    !_hiz_inside(num_points, points, sign, cx0, cy1) ||
+			    !_hiz_inside(num_points, points, sign, cx1, cy1))
+				continue;
+			float *tile = &level[ty * w + tx];
+			if (stored < *tile)
+				*tile = stored;
+		}
+	}
+	return 0;
+}
+
+int hiz_build(hiz_t *hiz)
+{
+	// each coarser tile keeps the farthest depth of its children
+	for (int i = 1; i < hiz->num_levels; i++) {
+		float *src = hiz->levels[i - 1];
+		float *dst = hiz->levels[i];
+		int sw = hiz->level_width[i - 1];
+		int sh = hiz->level_height[i - 1];
+		for (int y = 0; y < hiz->level_height[i]; y++) {
+			for (int x = 0; x < hiz->level_width[i]; x++) {
+				int x1 = x * 2 + 1 < sw ? x * 2 + 1 : x * 2;
+				int y1 = y * 2 + 1 < sh ? y * 2 + 1 : y * 2;
+				float d = src[y * 2 * sw + x * 2];
+				d = fmaxf(d, src[y * 2 * sw + x1]);
+				d = fmaxf(d, src[y1 * sw + x * 2]);
+				d = fmaxf(d, src[y1 * sw + x1]);
+				dst[y * hiz->level_width[i] + x] = d;
+			}
+		}
+	}
+	return 0;
+}
+
+static bool _hiz_occluded_level(hiz_t *hiz, int level, int tx0, int ty0,
+				int tx1, int ty1, double depth)
+{
+	float *tiles = hiz->levels[level];
+	int w = hiz->level_width[level];
+	tx0 >>= level;
+	ty0 >>= level;
+	tx1 >>= level;
+	ty1 >>= level;
+	for (int ty = ty0; ty <= ty1; ty++) {
+		for (int tx = tx0; tx <= tx1; tx++) {
+			if (!(tiles[ty * w + tx] < depth))
+				return false;
+		}
+	}
+	return true;
+}
+
+bool hiz_occluded(hiz_t *hiz, double x0, double y0, double x1, double y1,
+		  double depth)
+{
+	if (hiz->num_levels == 0 || !(depth > 0.0))
+		return false;
+	// entirely outside of the viewport
+	if (x1 < 0.0 || y1 < 0.0 || x0 >= hiz->width || y0 >= hiz->height)
+		return true;
+	int tx0 = (int)fmax(floor(x0 / HIZ_TILE), 0.0);
+	int ty0 = (int)fmax(floor(y0 / HIZ_TILE), 0.0);
+	int tx1 = (int)fmin(floor(x1 / HIZ_TILE), hiz->level_width[0] - 1);
+	int ty1 = (int)fmin(floor(y1 / HIZ_TILE), hiz->level_height[0] - 1);
+	// start at the level where the bounds span about two tiles, then try
+	// one finer level since coarse tiles are more conservative
+	int span = tx1 - tx0 > ty1 - ty0 ? tx1 - tx0 : ty1 - ty0;
+	int level = 0;
+	while (span > 1 && level < hiz->num_levels - 1) {
+		span >>= 1;
+		level++;
+	}
+	if (_hiz_occluded_level(hiz, level, tx0, ty0, tx1, ty1, depth))
+		return true;
+	if (level > 0)
+		return _hiz_occluded_level(hiz, level - 1, tx0, ty0, tx1, ty1,
+					   depth);
+	return false;
+}
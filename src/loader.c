@@ -0,0 +1,666 @@
+// MAP_ANONYMOUS and sysconf are not part of iso c
+#define _DEFAULT_SOURCE
+
+#include "drawlist.h"
+#include "drawlist_private.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define LOADER_MAX_THREADS 16
+// vertices below this count are converted on the calling thread
+#define LOADER_CHUNK 65536
+#define PLY_MAX_ELEMENTS 16
+#define PLY_MAX_PROPERTIES 32
+// colors are grouped into 4 bits per channel, one style per group
+#define LOADER_COLOR_BITS 4
+
+typedef enum {
+	PLY_TYPE_NONE,
+	PLY_TYPE_INT8,
+	PLY_TYPE_UINT8,
+	PLY_TYPE_INT16,
+	PLY_TYPE_UINT16,
+	PLY_TYPE_INT32,
+	PLY_TYPE_UINT32,
+	PLY_TYPE_FLOAT32,
+	PLY_TYPE_FLOAT64,
+} ply_type_t;
+
+typedef struct {
+	char name[32];
+	ply_type_t type;
+	// element count type of list properties, none for scalars
+	ply_type_t count_type;
+	size_t offset;
+} ply_property_t;
+
+typedef struct {
+	char name[32];
+	size_t count;
+	size_t num_properties;
+	ply_property_t properties[PLY_MAX_PROPERTIES];
+	// size of one record, only for elements without list properties
+	size_t stride;
+	bool fixed;
+} ply_element_t;
+
+typedef struct {
+	const uint8_t *data;
+	size_t size;
+	size_t header_size;
+	bool swap;
+	size_t num_elements;
+	ply_element_t elements[PLY_MAX_ELEMENTS];
+} ply_file_t;
+
+// converts the vertices [start, end) of a fixed size record layout
+typedef struct {
+	const uint8_t *data;
+	size_t stride;
+	bool swap;
+	ply_type_t types[6];
+	size_t offsets[6];
+	bool color;
+	size_t start;
+	size_t end;
+	double *points;
+	uint16_t *keys;
+} loader_job_t;
+
+static size_t _loader_type_size(ply_type_t type)
+{
+	static const size_t sizes[] = { 0, 1, 1, 2, 2, 4, 4, 4, 8 };
+	return sizes[type];
+}
+
+static double _loader_read(const uint8_t *p, ply_type_t type, bool swap)
+{
+	uint8_t b[8];
+	size_t n = _loader_type_size(type);
+	for (size_t i = 0; i < n; i++)
+		b[i] = swap ? p[n - 1 - i] : p[i];
+	union {
+		int8_t i8;
+		uint8_t u8;
+		int16_t i16;
+		uint16_t u16;
+		int32_t i32;
+		uint32_t u32;
+		float f32;
+		double f64;
+	} v;
+	memcpy(&v, b, n);
+	switch (type) {
+	case PLY_TYPE_INT8:
+		return v.i8;
+	case PLY_TYPE_UINT8:
+		return v.u8;
+	case PLY_TYPE_INT16:
+		return v.i16;
+	case PLY_TYPE_UINT16:
+		return v.u16;
+	case PLY_TYPE_INT32:
+		return v.i32;
+	case PLY_TYPE_UINT32:
+		return v.u32;
+	case PLY_TYPE_FLOAT32:
+		return v.f32;
+	case PLY_TYPE_FLOAT64:
+		return v.f64;
+	default:
+		return 0.0;
+	}
+}
+
+static double _loader_channel(const uint8_t *p, ply_type_t type, bool swap)
+{
+	// color channels as 0 to 1, integers use their full range
+	double v = _loader_read(p, type, swap);
+	if (type == PLY_TYPE_UINT8)
+		v /= 255.0;
+	else if (type == PLY_TYPE_UINT16)
+		v /= 65535.0;
+	return v < 0.0 ? 0.0 : v > 1.0 ? 1.0 : v;
+}
+
+static void _loader_color(uint16_t key, double color[4])
+{
+	// style color of a group of vertex colors
+	const int levels = (1 << LOADER_COLOR_BITS) - 1;
+	color[0] = (double)(key >> LOADER_COLOR_BITS * 2 & levels) / levels;
+	color[1] = (double)(key >> LOADER_COLOR_BITS & levels) / levels;
+	color[2] = (double)(key & levels) / levels;
+	color[3] = 1.0;
+}
+
+static void *_loader_convert(void *arg)
+{
+	loader_job_t *job = arg;
+	const int levels = (1 << LOADER_COLOR_BITS) - 1;
+	for (size_t i = job->start; i < job->end; i++) {
+		const uint8_t *record = job->data + i * job->stride;
+		double *dst = job->points + i * 3;
+		for (int k = 0; k < 3; k++)
+			dst[k] = _loader_read(record + job->offsets[k],
+					      job->types[k], job->swap);
+		if (!job->color)
+			continue;
+		uint16_t key = 0;
+		for (int k = 3; k < 6; k++) {
+			double c = _loader_channel(record + job->offsets[k],
+						   job->types[k], job->swap);
+			key = key << LOADER_COLOR_BITS |
+			      (uint16_t)(c * levels + 0.5);
+		}
+		job->keys[i] = key;
+	}
+	return NULL;
+}
+
+static int _loader_convert_all(loader_job_t *job, size_t num)
+{
+	// split the vertices in chunks over the available cores
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t threads = cores > 0 ? (size_t)cores : 1;
+	if (threads > LOADER_MAX_THREADS)
+		threads = LOADER_MAX_THREADS;
+	if (threads > num / LOADER_CHUNK)
+		threads = num / LOADER_CHUNK > 0 ? num / LOADER_CHUNK : 1;
+	loader_job_t jobs[LOADER_MAX_THREADS];
+	pthread_t ids[LOADER_MAX_THREADS];
+	size_t started = 0;
+	for (size_t t = 0; t < threads; t++) {
+		jobs[t] = *job;
+		jobs[t].start = num * t / threads;
+		jobs[t].end = num * (t + 1) / threads;
+		if (t == 0 ||
+		    pthread_create(&ids[t], NULL, _loader_convert, &jobs[t]))
+			continue;
+		started |= (size_t)1 << t;
+	}
+	// the calling thread takes the first chunk and any that failed to
+	// start
+	for (size_t t = 0; t < threads; t++) {
+		if (!(started >> t & 1))
+			_loader_convert(&jobs[t]);
+	}
+	for (size_t t = 0; t < threads; t++) {
+		if (started >> t & 1)
+			pthread_join(ids[t], NULL);
+	}
+	return 0;
+}
+
+static void *_loader_open(const char *filename, size_t *size)
+{
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		close(fd);
+		return NULL;
+	}
+	*size = st.st_size;
+	void *mapping = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED)
+		return NULL;
+	// the records are read once from front to back
+	madvise(mapping, *size, MADV_SEQUENTIAL);
+	return mapping;
+}
+
+static int _loader_map_points(draw_list_t *draw_list, const char *filename,
+			      size_t offset, size_t num)
+{
+	// an empty list takes the doubles of the file as its buffer, the
+	// primitive table lives in an anonymous page in front of them and
+	// both go away with the list like a draw_list_map mapping
+	if (draw_list->length != 0 || draw_list->buffer_length != 0 ||
+	    draw_list->mapping != NULL || draw_list->shared != NULL ||
+	    draw_list->storage != NULL ||
+	    offset % sizeof(double) != 0)
+		return 1;
+	size_t page = sysconf(_SC_PAGESIZE);
+	size_t aligned = offset / page * page;
+	size_t length = offset - aligned + num * 3 * sizeof(double);
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return 1;
+	uint8_t *base = mmap(NULL, page + length, PROT_READ | PROT_WRITE,
+			     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base == MAP_FAILED) {
+		close(fd);
+		return 1;
+	}
+	void *data = mmap(base + page, length, PROT_READ,
+			  MAP_PRIVATE | MAP_FIXED, fd, aligned);
+	close(fd);
+	if (data == MAP_FAILED) {
+		munmap(base, page + length);
+		return 1;
+	}
+	primitive_t *primitive = (primitive_t *)base;
+	primitive->type = PRIMITIVE_TYPE_POINT;
+	primitive->index = 0;
+	primitive->length = num * 3;
+	free(draw_list->primitives);
+	free(draw_list->buffer);
+	draw_list->mapping = base;
+	draw_list->mapping_size = page + length;
+	draw_list->primitives = primitive;
+	draw_list->buffer = (double *)(base + page + offset - aligned);
+	draw_list->length = 1;
+	draw_list->capacity = 1;
+	draw_list->buffer_length = num * 3;
+	draw_list->buffer_capacity = num * 3;
+	_draw_list_changed(draw_list);
+	draw_list_save(draw_list);
+	return 0;
+}
+
+static int _loader_points(draw_list_t *draw_list, loader_job_t *job,
+			  size_t num, double width)
+{
+	// convert straight into the buffer; colored points go through a
+	// scratch copy and are grouped by color; the loaded points are saved
+	// like a mapped file is
+	size_t start = draw_list->buffer_length;
+	if (!job->color) {
+		if (draw_list_buffer_allocate(draw_list, num * 3))
+			return 1;
+		job->points = draw_list->buffer + start;
+		_loader_convert_all(job, num);
+		draw_list->buffer_length += num * 3;
+		_draw_list_changed(draw_list);
+		if (draw_list_append(draw_list, PRIMITIVE_TYPE_POINT, num * 3))
+			return 1;
+		return draw_list_save(draw_list);
+	}
+	size_t num_keys = (size_t)1 << (LOADER_COLOR_BITS * 3);
+	double *points = malloc(sizeof(double) * num * 3);
+	double *sorted = malloc(sizeof(double) * num * 3);
+	uint16_t *keys = malloc(sizeof(uint16_t) * num);
+	size_t *counts = calloc(num_keys + 1, sizeof(size_t));
+	size_t *fill = malloc(sizeof(size_t) * num_keys);
+	int ret = points == NULL || sorted == NULL || keys == NULL ||
+		  counts == NULL || fill == NULL;
+	if (!ret) {
+		job->points = points;
+		job->keys = keys;
+		_loader_convert_all(job, num);
+		for (size_t i = 0; i < num; i++)
+			counts[keys[i] + 1]++;
+		for (size_t k = 0; k < num_keys; k++)
+			counts[k + 1] += counts[k];
+		memcpy(fill, counts, sizeof(size_t) * num_keys);
+		for (size_t i = 0; i < num; i++)
+			memcpy(sorted + fill[keys[i]]++ * 3, points + i * 3,
+			       sizeof(double) * 3);
+	}
+	for (size_t k = 0; k < num_keys && !ret; k++) {
+		size_t n = counts[k + 1] - counts[k];
+		if (n == 0)
+			continue;
+		double color[4];
+		_loader_color(k, color);
+		ret = draw_list_style(draw_list, color, width) ||
+		      draw_list_buffer_copy(draw_list, n * 3,
+					    sorted + counts[k] * 3) ||
+		      draw_list_append(draw_list, PRIMITIVE_TYPE_POINT, n * 3);
+	}
+	free(points);
+	free(sorted);
+	free(keys);
+	free(counts);
+	free(fill);
+	if (ret)
+		return ret;
+	return draw_list_save(draw_list);
+}
+
+int draw_list_read_xyz(draw_list_t *draw_list, const char *filename,
+		       bool single_precision)
+{
+	// raw x, y, z triples of float32 or float64, native byte order
+	size_t size;
+	uint8_t *data = _loader_open(filename, &size);
+	if (data == NULL)
+		return 1;
+	size_t value = single_precision ? sizeof(float) : sizeof(double);
+	size_t num = size / (value * 3);
+	if (num == 0 || size % (value * 3) != 0) {
+		munmap(data, size);
+		return 1;
+	}
+	if (!single_precision &&
+	    _loader_map_points(draw_list, filename, 0, num) == 0) {
+		munmap(data, size);
+		return 0;
+	}
+	ply_type_t type =
+		single_precision ? PLY_TYPE_FLOAT32 : PLY_TYPE_FLOAT64;
+	loader_job_t job = { .data = data,
+			     .stride = value * 3,
+			     .types = { type, type, type },
+			     .offsets = { 0, value, value * 2 } };
+	int ret = _loader_points(draw_list, &job, num, 1.0);
+	munmap(data, size);
+	return ret;
+}
+
+static ply_type_t _ply_type(const char *name)
+{
+	static const struct {
+		const char *name;
+		ply_type_t type;
+	} types[] = {
+		{ "char", PLY_TYPE_INT8 },
+		{ "int8", PLY_TYPE_INT8 },
+		{ "uchar", PLY_TYPE_UINT8 },
+		{ "uint8", PLY_TYPE_UINT8 },
+		{ "short", PLY_TYPE_INT16 },
+		{ "int16", PLY_TYPE_INT16 },
+		{ "ushort", PLY_TYPE_UINT16 },
+		{ "uint16", PLY_TYPE_UINT16 },
+		{ "int", PLY_TYPE_INT32 },
+		{ "int32", PLY_TYPE_INT32 },
+		{ "uint", PLY_TYPE_UINT32 },
+		{ "uint32", PLY_TYPE_UINT32 },
+		{ "float", PLY_TYPE_FLOAT32 },
+		{ "float32", PLY_TYPE_FLOAT32 },
+		{ "double", PLY_TYPE_FLOAT64 },
+		{ "float64", PLY_TYPE_FLOAT64 },
+	};
+	for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+		if (strcmp(types[i].name, name) == 0)
+			return types[i].type;
+	}
+	return PLY_TYPE_NONE;
+}
+
+static int _ply_parse_header(ply_file_t *ply)
+{
+	// binary ply only, ascii files are better served by numpy
+	const char *text = (const char *)ply->data;
+	const char *end = NULL;
+	for (size_t i = 0; i + 10 <= ply->size && i < 65536; i++) {
+		if (memcmp(text + i, "end_header", 10) == 0) {
+			end = text + i;
+			break;
+		}
+	}
+	if (ply->size < 4 || memcmp(text, "ply", 3) != 0 || end == NULL)
+		return 1;
+	const char *data = memchr(end, '\n', ply->size - (end - text));
+	if (data == NULL)
+		return 1;
+	ply->header_size = data + 1 - text;
+	bool format = false;
+	ply_element_t *element = NULL;
+	char line[256];
+	for (const char *p = text; p < end;) {
+		const char *eol = memchr(p, '\n', end - p);
+		size_t n = (eol != NULL ? eol : end) - p;
+		if (n >= sizeof(line))
+			return 1;
+		memcpy(line, p, n);
+		line[n] = '\0';
+		p += n + 1;
+		char a[32], b[32], c[32], d[32];
+		int words = sscanf(line, "%31s %31s %31s %31s", a, b, c, d);
+		if (words < 1)
+			continue;
+		if (strcmp(a, "format") == 0 && words >= 2) {
+			if (strcmp(b, "binary_little_endian") != 0 &&
+			    strcmp(b, "binary_big_endian") != 0)
+				return 1;
+			uint16_t one = 1;
+			bool little = *(uint8_t *)&one == 1;
+			ply->swap = little != (b[7] == 'l');
+			format = true;
+		} else if (strcmp(a, "element") == 0 && words >= 3) {
+			if (ply->num_elements == PLY_MAX_ELEMENTS)
+				return 1;
+			element = &ply->elements[ply->num_elements++];
+			memset(element, 0, sizeof(ply_element_t));
+			strcpy(element->name, b);
+			element->count = strtoull(c, NULL, 10);
+			element->fixed = true;
+		} else if (strcmp(a, "property") == 0 && element != NULL) {
+			if (element->num_properties == PLY_MAX_PROPERTIES)
+				return 1;
+			ply_property_t *property =
+				&element->properties[element->num_properties++];
+			memset(property, 0, sizeof(ply_property_t));
+			if (strcmp(b, "list") == 0 && words == 4) {
+				int name = sscanf(line, "%*s %*s %*s %*s %31s",
+						  property->name);
+				property->count_type = _ply_type(c);
+				property->type = _ply_type(d);
+				element->fixed = false;
+				if (name != 1 ||
+				    property->count_type == PLY_TYPE_NONE)
+					return 1;
+			} else if (words == 3) {
+				property->type = _ply_type(b);
+				strcpy(property->name, c);
+				property->offset = element->stride;
+				element->stride +=
+					_loader_type_size(property->type);
+			} else {
+				return 1;
+			}
+			if (property->type == PLY_TYPE_NONE)
+				return 1;
+		}
+	}
+	return !format;
+}
+
+static const ply_property_t *_ply_property(const ply_element_t *element,
+					   const char *name)
+{
+	for (size_t i = 0; i < element->num_properties; i++) {
+		if (strcmp(element->properties[i].name, name) == 0)
+			return &element->properties[i];
+	}
+	return NULL;
+}
+
+static const uint8_t *_ply_values(const ply_file_t *ply,
+				  const ply_property_t *property,
+				  const uint8_t *p, size_t *num)
+{
+	// number of values of a property and where they start, NULL when
+	// they overrun the file
+	const uint8_t *end = ply->data + ply->size;
+	*num = 1;
+	if (property->count_type != PLY_TYPE_NONE) {
+		size_t s = _loader_type_size(property->count_type);
+		if ((size_t)(end - p) < s)
+			return NULL;
+		double n = _loader_read(p, property->count_type, ply->swap);
+		if (!(n >= 0.0))
+			return NULL;
+		*num = n;
+		p += s;
+	}
+	if (*num > (size_t)(end - p) / _loader_type_size(property->type))
+		return NULL;
+	return p;
+}
+
+static const uint8_t *_ply_skip(const ply_file_t *ply,
+				const ply_element_t *element,
+				const uint8_t *p)
+{
+	// end of the records of an element, NULL when it overruns the file
+	const uint8_t *end = ply->data + ply->size;
+	if (element->fixed) {
+		if (element->stride != 0 &&
+		    element->count > (size_t)(end - p) / element->stride)
+			return NULL;
+		return p + element->count * element->stride;
+	}
+	for (size_t i = 0; i < element->count && p != NULL; i++) {
+		for (size_t j = 0; j < element->num_properties && p != NULL;
+		     j++) {
+			size_t n;
+			p = _ply_values(ply, &element->properties[j], p, &n);
+			if (p != NULL)
+				p += n * _loader_type_size(
+						 element->properties[j].type);
+		}
+	}
+	return p;
+}
+
+static int _ply_faces(draw_list_t *draw_list, const ply_file_t *ply,
+		      const ply_element_t *faces, const uint8_t *p,
+		      const double *points, const uint16_t *keys,
+		      size_t num_points, double width)
+{
+	// one polygon per face written straight into the buffer, a style
+	// whenever the color of the first vertex changes
+	int key = -1;
+	for (size_t i = 0; i < faces->count; i++) {
+		size_t num = 0;
+		for (size_t j = 0; j < faces->num_properties; j++) {
+			const ply_property_t *property = &faces->properties[j];
+			bool indices = property->count_type != PLY_TYPE_NONE &&
+				       (strcmp(property->name,
+					       "vertex_indices") == 0 ||
+					strcmp(property->name,
+					       "vertex_index") == 0);
+			size_t n;
+			p = _ply_values(ply, property, p, &n);
+			if (p == NULL)
+				return 1;
+			size_t s = _loader_type_size(property->type);
+			double *polygon = NULL;
+			for (size_t k = 0; indices && k < n; k++) {
+				double v = _loader_read(p + k * s,
+							property->type,
+							ply->swap);
+				if (!(v >= 0.0 && v < (double)num_points))
+					return 1;
+				if (k == 0 && keys != NULL &&
+				    keys[(size_t)v] != key) {
+					double color[4];
+					key = keys[(size_t)v];
+					_loader_color(key, color);
+					if (draw_list_style(draw_list, color,
+							    width))
+						return 1;
+				}
+				if (k == 0) {
+					if (draw_list_buffer_allocate(draw_list,
+								      n * 3))
+						return 1;
+					polygon = draw_list->buffer +
+						  draw_list->buffer_length;
+				}
+				memcpy(polygon + k * 3, points + (size_t)v * 3,
+				       sizeof(double) * 3);
+			}
+			if (indices)
+				num = n;
+			p += n * s;
+		}
+		if (num < 3)
+			continue;
+		draw_list->buffer_length += num * 3;
+		if (draw_list_append(draw_list, PRIMITIVE_TYPE_POLYGON,
+				     num * 3))
+			return 1;
+	}
+	return 0;
+}
+
+int draw_list_read_ply(draw_list_t *draw_list, const char *filename,
+		       double width)
+{
+	// vertices become points, or polygons when the file has faces;
+	// vertex colors are grouped into styles of the given width
+	ply_file_t ply;
+	memset(&ply, 0, sizeof(ply));
+	ply.data = _loader_open(filename, &ply.size);
+	if (ply.data == NULL)
+		return 1;
+	int ret = _ply_parse_header(&ply);
+	const uint8_t *p = ply.data + ply.header_size;
+	const ply_element_t *vertices = NULL, *faces = NULL;
+	const uint8_t *vertex_data = NULL, *face_data = NULL;
+	for (size_t i = 0; i < ply.num_elements && !ret; i++) {
+		const ply_element_t *element = &ply.elements[i];
+		if (strcmp(element->name, "vertex") == 0 && element->fixed) {
+			vertices = element;
+			vertex_data = p;
+		} else if (strcmp(element->name, "face") == 0) {
+			faces = element;
+			face_data = p;
+		}
+		p = _ply_skip(&ply, element, p);
+		ret = p == NULL;
+	}
+	const char *names[6] = { "x", "y", "z", "red", "green", "blue" };
+	loader_job_t job = { .data = vertex_data, .swap = ply.swap };
+	for (int k = 0; k < 6 && !ret && vertices != NULL; k++) {
+		const ply_property_t *property =
+			_ply_property(vertices, names[k]);
+		if (property == NULL) {
+			ret = k < 3;
+			break;
+		}
+		job.types[k] = property->type;
+		job.offsets[k] = property->offset;
+		job.color = k == 5;
+	}
+	ret |= vertices == NULL || vertices->count == 0;
+	if (!ret) {
+		job.stride = vertices->stride;
+		size_t num = vertices->count;
+		bool raw = vertices->stride == sizeof(double) * 3 &&
+			   !ply.swap && job.types[0] == PLY_TYPE_FLOAT64 &&
+			   job.types[1] == PLY_TYPE_FLOAT64 &&
+			   job.types[2] == PLY_TYPE_FLOAT64 &&
+			   job.offsets[1] == sizeof(double) &&
+			   job.offsets[2] == sizeof(double) * 2;
+		if (faces == NULL && raw &&
+		    _loader_map_points(draw_list, filename,
+				       vertex_data - ply.data, num) == 0) {
+			ret = 0;
+		} else if (faces == NULL) {
+			ret = _loader_points(draw_list, &job, num, width);
+		} else {
+			// meshes keep the converted vertices aside
+			double *points = malloc(sizeof(double) * num * 3);
+			uint16_t *keys = NULL;
+			if (job.color)
+				keys = malloc(sizeof(uint16_t) * num);
+			ret = points == NULL || (job.color && keys == NULL);
+			if (!ret) {
+				job.points = points;
+				job.keys = keys;
+				_loader_convert_all(&job, num);
+				ret = _ply_faces(draw_list, &ply, faces,
+						 face_data, points, keys, num,
+						 width);
+			}
+			free(points);
+			free(keys);
+		}
+	}
+	munmap((void *)ply.data, ply.size);
+	return ret;
+}
@@ -0,0 +1,400 @@
+#include "drawlist.h"
+#include "drawlist_private.h"
+#include "pick_private.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// edge length of the grid cells in pixels, shrunk for dense lists towards
+// PICK_CELL_ITEMS vertices per cell; the grid reaches one cell beyond the
+// viewport on every side
+#define PICK_CELL_MAX 16.0
+#define PICK_CELL_MIN 2.0
+#define PICK_CELL_ITEMS 4.0
+#define PICK_BATCH 256
+// vertex of the item standing for the inside of a polygon
+#define PICK_INSIDE UINT32_MAX
+
+void _pick_index_init(pick_index_t *index)
+{
+	memset(index, 0, sizeof(pick_index_t));
+}
+
+void _pick_index_free(pick_index_t *index)
+{
+	free(index->points);
+	free(index->cells);
+	free(index->items);
+	_pick_index_init(index);
+}
+
+static int _pick_grow(void **data, size_t *capacity, size_t num, size_t size)
+{
+	if (num <= *capacity)
+		return 0;
+	size_t n = *capacity > 0 ? *capacity : 64;
+	while (n < num)
+		n *= 2;
+	void *p = realloc(*data, n * size);
+	if (p == NULL)
+		return 1;
+	*data = p;
+	*capacity = n;
+	return 0;
+}
+
+static bool _pick_pickable(primitive_type_t type)
+{
+	return type == PRIMITIVE_TYPE_POINT || type == PRIMITIVE_TYPE_LINE ||
+	       type == PRIMITIVE_TYPE_POLYGON ||
+	       type == PRIMITIVE_TYPE_POLYLINE ||
+	       type == PRIMITIVE_TYPE_POLYLINES;
+}
+
+static int _pick_project(draw_list_t *draw_list, camera_t *camera)
+{
+	pick_index_t *pick = &draw_list->pick;
+	if (_pick_grow((void **)&pick->points, &pick->points_capacity,
+		       draw_list->buffer_length, sizeof(float)))
+		return 1;
+	double q[PICK_BATCH * 2];
+	double depth[PICK_BATCH];
+	bool visible[PICK_BATCH];
+	for (size_t i = 0; i < draw_list->length; i++) {
+		primitive_t *primitive = &draw_list->primitives[i];
+		if (!_pick_pickable(primitive->type))
+			continue;
+		size_t num = primitive->length / 3;
+		for (size_t j = 0, n; j < num; j += n) {
+			n = num - j < PICK_BATCH ? num - j : PICK_BATCH;
+			size_t offset = primitive->index + j * 3;
+			camera_project_points(camera, n,
+					      draw_list->buffer + offset, q,
+					      depth, visible);
+			float *dst = pick->points + offset;
+			for (size_t k = 0; k < n; k++) {
+				dst[k * 3] = visible[k] ? q[k * 2] : NAN;
+				dst[k * 3 + 1] = q[k * 2 + 1];
+				dst[k * 3 + 2] = depth[k];
+			}
+		}
+	}
+	return 0;
+}
+
+static const float *_pick_vertex(draw_list_t *draw_list, primitive_t *p,
+				 size_t vertex)
+{
+	const float *v = draw_list->pick.points + p->index + vertex * 3;
+	return isnan(v[0]) || isnan(v[1]) ? NULL : v;
+}
+
+static int _pick_cell(pick_index_t *pick, double x, double y, int *cx,
+		      int *cy)
+{
+	// cell of a screen position, 1 when it is outside of the grid
+	double gx = floor(x / pick->cell) + 1.0;
+	double gy = floor(y / pick->cell) + 1.0;
+	if (!(gx >= 0.0 && gx < pick->nx && gy >= 0.0 && gy < pick->ny))
+		return 1;
+	*cx = (int)gx;
+	*cy = (int)gy;
+	return 0;
+}
+
+static void _pick_add(pick_index_t *pick, int cx, int cy, pick_item_t item,
+		      size_t *fill)
+{
+	// count in the first pass, place the item in the second
+	if (cx < 0 || cy < 0 || cx >= pick->nx || cy >= pick->ny)
+		return;
+	size_t cell = (size_t)cy * pick->nx + cx;
+	if (fill == NULL)
+		pick->cells[cell + 1]++;
+	else
+		pick->items[fill[cell]++] = item;
+}
+
+static bool _pick_clip(pick_index_t *pick, double *x0, double *y0,
+		       double *x1, double *y1)
+{
+	// liang-barsky against the area of the grid
+	double lo[2] = { -pick->cell, -pick->cell };
+	double hi[2] = { (pick->nx - 1) * pick->cell,
+			 (pick->ny - 1) * pick->cell };
+	double p0[2] = { *x0, *y0 };
+	double d[2] = { *x1 - *x0, *y1 - *y0 };
+	double t0 = 0.0, t1 = 1.0;
+	for (int k = 0; k < 2; k++) {
+		if (d[k] == 0.0) {
+			if (p0[k] < lo[k] || p0[k] >= hi[k])
+				return false;
+			continue;
+		}
+		double a = (lo[k] - p0[k]) / d[k];
+		double b = (hi[k] - p0[k]) / d[k];
+		t0 = fmax(t0, fmin(a, b));
+		t1 = fmin(t1, fmax(a, b));
+	}
+	if (t0 > t1)
+		return false;
+	*x0 = p0[0] + t0 * d[0];
+	*y0 = p0[1] + t0 * d[1];
+	*x1 = p0[0] + t1 * d[0];
+	*y1 = p0[1] + t1 * d[1];
+	return true;
+}
+
+static void _pick_segment(pick_index_t *pick, const float *a, const float *b,
+			  pick_item_t item, size_t *fill)
+{
+	// add the item to every cell the segment passes through
+	double x0 = a[0], y0 = a[1], x1 = b[0], y1 = b[1];
+	if (!_pick_clip(pick, &x0, &y0, &x1, &y1))
+		return;
+	double gx0 = x0 / pick->cell + 1.0, gy0 = y0 / pick->cell + 1.0;
+	double gx1 = x1 / pick->cell + 1.0, gy1 = y1 / pick->cell + 1.0;
+	int cx = (int)floor(gx0), cy = (int)floor(gy0);
+	int steps = abs((int)floor(gx1) - cx) + abs((int)floor(gy1) - cy);
+	double dx = gx1 - gx0, dy = gy1 - gy0;
+	int sx = dx > 0.0 ? 1 : -1, sy = dy > 0.0 ? 1 : -1;
+	double tdx = dx != 0.0 ? fabs(1.0 / dx) : INFINITY;
+	double tdy = dy != 0.0 ? fabs(1.0 / dy) : INFINITY;
+	double tx = dx > 0.0 ? (floor(gx0) + 1.0 - gx0) * tdx :
+		    dx < 0.0 ? (gx0 - floor(gx0)) * tdx :
+			       INFINITY;
+	double ty = dy > 0.0 ? (floor(gy0) + 1.0 - gy0) * tdy :
+		    dy < 0.0 ? (gy0 - floor(gy0)) * tdy :
+			       INFINITY;
+	_pick_add(pick, cx, cy, item, fill);
+	for (int s = 0; s < steps; s++) {
+		if (tx < ty) {
+			cx += sx;
+			tx += tdx;
+		} else {
+			cy += sy;
+			ty += tdy;
+		}
+		_pick_add(pick, cx, cy, item, fill);
+	}
+}
+
+static void _pick_polygon(pick_index_t *pick, draw_list_t *draw_list,
+			  primitive_t *p, pick_item_t item, size_t *fill)
+{
+	// the inside goes to every cell of the bounding box
+	size_t num = p->length / 3;
+	double x0 = INFINITY, y0 = INFINITY, x1 = -INFINITY, y1 = -INFINITY;
+	for (size_t j = 0; j < num; j++) {
+		const float *v = _pick_vertex(draw_list, p, j);
+		if (v == NULL)
+			return;
+		x0 = fmin(x0, v[0]);
+		y0 = fmin(y0, v[1]);
+		x1 = fmax(x1, v[0]);
+		y1 = fmax(y1, v[1]);
+	}
+	int cx0 = (int)fmax(floor(x0 / pick->cell) + 1.0, 0.0);
+	int cy0 = (int)fmax(floor(y0 / pick->cell) + 1.0, 0.0);
+	int cx1 = (int)fmin(floor(x1 / pick->cell) + 1.0, pick->nx - 1);
+	int cy1 = (int)fmin(floor(y1 / pick->cell) + 1.0, pick->ny - 1);
+	for (int cy = cy0; cy <= cy1; cy++) {
+		for (int cx = cx0; cx <= cx1; cx++)
+			_pick_add(pick, cx, cy, item, fill);
+	}
+}
+
+static void _pick_visit(draw_list_t *draw_list, size_t *fill)
+{
+	pick_index_t *pick = &draw_list->pick;
+	for (size_t i = 0; i < draw_list->length; i++) {
+		primitive_t *p = &draw_list->primitives[i];
+		size_t num = p->length / 3;
+		pick_item_t item = { (uint32_t)i, 0 };
+		int cx, cy;
+		switch (p->type) {
+		case PRIMITIVE_TYPE_POINT:
+			for (size_t j = 0; j < num; j++) {
+				const float *v = _pick_vertex(draw_list, p, j);
+				if (v == NULL || _pick_cell(pick, v[0], v[1],
+							    &cx, &cy))
+					continue;
+				item.vertex = (uint32_t)j;
+				_pick_add(pick, cx, cy, item, fill);
+			}
+			break;
+		case PRIMITIVE_TYPE_LINE:
+		case PRIMITIVE_TYPE_POLYLINE:
+		case PRIMITIVE_TYPE_POLYLINES:
+		case PRIMITIVE_TYPE_POLYGON:
+			// polygons are closed by an edge back to the start
+			if (num == 0)
+				break;
+			size_t last = num - 1;
+			if (p->type == PRIMITIVE_TYPE_POLYGON)
+				last = num;
+			size_t step = p->type == PRIMITIVE_TYPE_LINE ? 2 : 1;
+			for (size_t j = 0; j < last; j += step) {
+				const float *a = _pick_vertex(draw_list, p, j);
+				const float *b = _pick_vertex(
+					draw_list, p, (j + 1) % num);
+				if (a == NULL || b == NULL)
+					continue;
+				item.vertex = (uint32_t)j;
+				_pick_segment(pick, a, b, item, fill);
+			}
+			if (p->type == PRIMITIVE_TYPE_POLYGON) {
+				item.vertex = PICK_INSIDE;
+				_pick_polygon(pick, draw_list, p, item, fill);
+			}
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+static int _pick_build(draw_list_t *draw_list, camera_t *camera)
+{
+	pick_index_t *pick = &draw_list->pick;
+	double m[16];
+	int width, height;
+	camera_projection_get(camera, m);
+	camera_viewport_get(camera, &width, &height);
+	if (pick->valid && pick->version == draw_list->version &&
+	    pick->width == width && pick->height == height &&
+	    memcmp(pick->m, m, sizeof(m)) == 0)
+		return 0;
+	pick->valid = false;
+	if (draw_list->length > UINT32_MAX || _pick_project(draw_list, camera))
+		return 1;
+	double area = (double)width * height;
+	double vertices = draw_list->buffer_length / 3.0 + 1.0;
+	pick->cell = sqrt(area * PICK_CELL_ITEMS / vertices);
+	pick->cell = fmin(fmax(pick->cell, PICK_CELL_MIN), PICK_CELL_MAX);
+	pick->nx = (int)ceil(width / pick->cell) + 2;
+	pick->ny = (int)ceil(height / pick->cell) + 2;
+	size_t num_cells = (size_t)pick->nx * pick->ny;
+	if (_pick_grow((void **)&pick->cells, &pick->cells_capacity,
+		       num_cells + 1, sizeof(size_t)))
+		return 1;
+	// count the items per cell, then fill the cells in order
+	memset(pick->cells, 0, sizeof(size_t) * (num_cells + 1));
+	_pick_visit(draw_list, NULL);
+	for (size_t i = 0; i < num_cells; i++)
+		pick->cells[i + 1] += pick->cells[i];
+	if (_pick_grow((void **)&pick->items, &pick->items_capacity,
+		       pick->cells[num_cells], sizeof(pick_item_t)))
+		return 1;
+	size_t *fill = malloc(sizeof(size_t) * num_cells);
+	if (fill == NULL)
+		return 1;
+	memcpy(fill, pick->cells, sizeof(size_t) * num_cells);
+	_pick_visit(draw_list, fill);
+	free(fill);
+	memcpy(pick->m, m, sizeof(m));
+	pick->width = width;
+	pick->height = height;
+	pick->version = draw_list->version;
+	pick->valid = true;
+	return 0;
+}
+
+static bool _pick_inside(draw_list_t *draw_list, primitive_t *p, double x,
+			 double y)
+{
+	// even-odd rule like the polygon fill
+	size_t num = p->length / 3;
+	bool inside = false;
+	for (size_t j = 0, k = num - 1; j < num; k = j++) {
+		const float *a = _pick_vertex(draw_list, p, j);
+		const float *b = _pick_vertex(draw_list, p, k);
+		if ((a[1] > y) != (b[1] > y) &&
+		    x < (b[0] - a[0]) * (y - a[1]) / (b[1] - a[1]) + a[0])
+			inside = !inside;
+	}
+	return inside;
+}
+
+static void _pick_item(draw_list_t *draw_list, pick_item_t item, double x,
+		       double y, double *distance, double *depth,
+		       size_t *vertex)
+{
+	// screen distance and depth of the item at x, y and its vertex
+	// closest to it
+	primitive_t *p = &draw_list->primitives[item.primitive];
+	size_t num = p->length / 3;
+	*distance = INFINITY;
+	*depth = INFINITY;
+	*vertex = 0;
+	if (item.vertex == PICK_INSIDE) {
+		if (!_pick_inside(draw_list, p, x, y))
+			return;
+		double nearest = INFINITY;
+		for (size_t j = 0; j < num; j++) {
+			const float *v = _pick_vertex(draw_list, p, j);
+			double d = hypot(v[0] - x, v[1] - y);
+			if (d < nearest) {
+				nearest = d;
+				*vertex = j;
+			}
+			*depth = fmin(*depth, v[2]);
+		}
+		*distance = 0.0;
+		return;
+	}
+	size_t end = item.vertex;
+	if (p->type != PRIMITIVE_TYPE_POINT)
+		end = (item.vertex + 1) % num;
+	const float *a = _pick_vertex(draw_list, p, item.vertex);
+	const float *b = _pick_vertex(draw_list, p, end);
+	double dx = b[0] - a[0], dy = b[1] - a[1];
+	double l = dx * dx + dy * dy;
+	double t = l > 0.0 ? ((x - a[0]) * dx + (y - a[1]) * dy) / l : 0.0;
+	t = fmin(fmax(t, 0.0), 1.0);
+	*distance = hypot(a[0] + t * dx - x, a[1] + t * dy - y);
+	*depth = a[2] + t * (b[2] - a[2]);
+	*vertex = t < 0.5 ? item.vertex : end;
+}
+
+int draw_list_pick(draw_list_t *draw_list, camera_t *camera, double x,
+		   double y, double radius, size_t *primitive, size_t *vertex)
+{
+	// nearest point, line, polyline or polygon within radius pixels of
+	// x, y; among equally near ones the one closest to the camera wins
+	if (!(radius >= 0.0))
+		return 1;
+	camera_update(camera);
+	if (_pick_build(draw_list, camera))
+		return 1;
+	pick_index_t *pick = &draw_list->pick;
+	double r = radius / pick->cell;
+	int cx0 = (int)fmax(floor(x / pick->cell - r) + 1.0, 0.0);
+	int cy0 = (int)fmax(floor(y / pick->cell - r) + 1.0, 0.0);
+	int cx1 = (int)fmin(floor(x / pick->cell + r) + 1.0, pick->nx - 1);
+	int cy1 = (int)fmin(floor(y / pick->cell + r) + 1.0, pick->ny - 1);
+	bool found = false;
+	double best = radius, best_depth = INFINITY;
+	for (int cy = cy0; cy <= cy1; cy++) {
+		for (int cx = cx0; cx <= cx1; cx++) {
+			size_t cell = (size_t)cy * pick->nx + cx;
+			for (size_t i = pick->cells[cell];
+			     i < pick->cells[cell + 1]; i++) {
+				double d, depth;
+				size_t v;
+				_pick_item(draw_list, pick->items[i], x, y, &d,
+					   &depth, &v);
+				if (d > best ||
+				    (found && d == best && depth >= best_depth))
+					continue;
+				found = true;
+				best = d;
+				best_depth = depth;
+				*primitive = pick->items[i].primitive;
+				*vertex = v;
+			}
+		}
+	}
+	return !found;
+}
@@ -0,0 +1,40 @@
+#ifndef PICK_PRIVATE_H
+#define PICK_PRIVATE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// a point, the first vertex of a segment or the inside of a polygon
+typedef struct {
+	uint32_t primitive;
+	uint32_t vertex;
+} pick_item_t;
+
+// uniform screen space grid over the projected primitives of a draw list,
+// built on the first pick after the camera or the contents changed
+typedef struct {
+	// x, y and depth of every vertex at its offset in the buffer, nan
+	// when the vertex is behind the camera
+	float *points;
+	size_t points_capacity;
+	// items of cell i are items[cells[i]] up to items[cells[i + 1]]
+	double cell;
+	int nx;
+	int ny;
+	size_t *cells;
+	size_t cells_capacity;
+	pick_item_t *items;
+	size_t items_capacity;
+	// projection, viewport and contents the grid was built for
+	double m[16];
+	int width;
+	int height;
+	uint64_t version;
+	bool valid;
+} pick_index_t;
+
+void _pick_index_init(pick_index_t *index);
+void _pick_index_free(pick_index_t *index);
+
+#endif
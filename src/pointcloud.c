@@ -0,0 +1,790 @@
+// madvise and sysconf are not part of iso c
+#define _DEFAULT_SOURCE
+#include "pointcloud.h"
+#include "drawlist_private.h"
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define POINT_CLOUD_FILE_MAGIC "D3DOCTR"
+#define POINT_CLOUD_FILE_VERSION 1
+#define POINT_CLOUD_FILE_ALIGN 64
+// nodes below this depth keep all of their points
+#define POINT_CLOUD_MAX_DEPTH 20
+#define POINT_CLOUD_WRITE_BLOCK 4096
+// children are skipped once the points of a node lie closer together on
+// screen than this
+#define POINT_CLOUD_SPACING_PIXELS 1.0
+
+// little-endian on-disk layout, the node table and the points follow at
+// aligned offsets, nodes are stored depth first so that children always
+// come after their parent
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t header_size;
+	uint64_t num_nodes;
+	uint64_t num_points;
+	uint64_t nodes_offset;
+	uint64_t points_offset;
+	uint32_t node_size;
+	uint32_t reserved0;
+	uint64_t reserved1;
+} point_cloud_file_header_t;
+
+typedef struct {
+	// bounds of all points below the node (min, max)
+	double bounds[6];
+	// points of the node itself, a subsample of its subtree
+	uint64_t offset;
+	uint64_t count;
+	// node indices, -1 for none
+	int64_t children[8];
+} point_cloud_node_t;
+
+typedef struct {
+	double size;
+	size_t node;
+} point_cloud_candidate_t;
+
+struct point_cloud_s {
+	void *mapping;
+	size_t mapping_size;
+	const point_cloud_node_t *nodes;
+	size_t num_nodes;
+	const double *points;
+	size_t num_points;
+	size_t budget;
+	// loading a node copies its points from the mapping into the buffer
+	// of the draw list, where they stay while the node is loaded; the
+	// least recently used nodes are released first once more than cache
+	// points are loaded, their copies are garbage until the buffer is
+	// compacted
+	size_t cache;
+	size_t cached;
+	size_t garbage;
+	// buffer offset of the copy of each loaded node, and where the copies
+	// start behind the style
+	size_t *copied;
+	size_t base;
+	// version of the draw list after the last rebuild, the copies are
+	// only trusted while nothing else changed the list
+	uint64_t version;
+	// frame each node was last used in, 0 when it is not loaded, and the
+	// loaded nodes from the least to the most recently used
+	uint64_t *used;
+	size_t *older;
+	size_t *newer;
+	size_t oldest;
+	size_t newest;
+	uint64_t frame;
+	// nodes selected for the draw list, in order of their screen size
+	size_t num_selected;
+	size_t num_selected_previous;
+	size_t *selected;
+	size_t *selected_previous;
+	point_cloud_candidate_t *heap;
+	double color[4];
+	double width;
+	bool styled;
+	bool dirty;
+	size_t drawn;
+	draw_list_t *draw_list;
+};
+
+typedef struct {
+	const double *points;
+	size_t *index;
+	size_t *scratch;
+	size_t capacity;
+	// one sample per cell of a grid x grid x grid lattice over the node
+	int grid;
+	uint8_t *occupied;
+	size_t num_nodes;
+	size_t nodes_capacity;
+	point_cloud_node_t *nodes;
+} point_cloud_builder_t;
+
+static bool _point_cloud_file_supported()
+{
+	// like draw list files, the layout is only portable between
+	// little-endian hosts
+	uint16_t one = 1;
+	return *(uint8_t *)&one == 1 && sizeof(point_cloud_node_t) == 128;
+}
+
+static size_t _point_cloud_file_align(size_t offset)
+{
+	return (offset + POINT_CLOUD_FILE_ALIGN - 1) &
+	       ~(size_t)(POINT_CLOUD_FILE_ALIGN - 1);
+}
+
+static int _point_cloud_file_pad(FILE *file, size_t offset)
+{
+	static const uint8_t zeros[POINT_CLOUD_FILE_ALIGN] = { 0 };
+	size_t pad = _point_cloud_file_align(offset) - offset;
+	return fwrite(zeros, 1, pad, file) != pad;
+}
+
+static int64_t _point_cloud_build_node(point_cloud_builder_t *builder,
+				       size_t start, size_t end,
+				       const double *center, double half,
+				       int depth)
+{
+	// the node keeps a spatially even subsample of index[start, end),
+	// the rest is split into octants for the children
+	if (builder->num_nodes == builder->nodes_capacity) {
+		size_t capacity = builder->nodes_capacity * 2;
+		point_cloud_node_t *nodes = realloc(
+			builder->nodes, sizeof(point_cloud_node_t) * capacity);
+		if (nodes == NULL)
+			return -1;
+		builder->nodes = nodes;
+		builder->nodes_capacity = capacity;
+	}
+	size_t id = builder->num_nodes++;
+	point_cloud_node_t node;
+	memset(&node, 0, sizeof(node));
+	for (int k = 0; k < 3; k++) {
+		node.bounds[k] = INFINITY;
+		node.bounds[k + 3] = -INFINITY;
+	}
+	for (size_t i = start; i < end; i++) {
+		const double *p = builder->points + builder->index[i] * 3;
+		for (int k = 0; k < 3; k++) {
+			node.bounds[k] = fmin(node.bounds[k], p[k]);
+			node.bounds[k + 3] = fmax(node.bounds[k + 3], p[k]);
+		}
+	}
+	for (int k = 0; k < 8; k++)
+		node.children[k] = -1;
+	node.offset = start;
+	size_t kept = end - start;
+	if (kept > builder->capacity && depth < POINT_CLOUD_MAX_DEPTH) {
+		int g = builder->grid;
+		memset(builder->occupied, 0, (size_t)g * g * g);
+		kept = 0;
+		for (size_t i = start; i < end && kept < builder->capacity;
+		     i++) {
+			const double *p =
+				builder->points + builder->index[i] * 3;
+			size_t cell = 0;
+			for (int k = 0; k < 3; k++) {
+				double u = (p[k] - center[k] + half) /
+					   (2.0 * half) * g;
+				int c = u < 0.0 ? 0 : u >= g ? g - 1 : (int)u;
+				cell = cell * g + c;
+			}
+			if (builder->occupied[cell])
+				continue;
+			builder->occupied[cell] = 1;
+			size_t tmp = builder->index[start + kept];
+			builder->index[start + kept] = builder->index[i];
+			builder->index[i] = tmp;
+			kept++;
+		}
+	}
+	node.count = kept;
+	builder->nodes[id] = node;
+	if (start + kept == end)
+		return id;
+
+	// counting sort of the remaining points by octant
+	size_t counts[9] = { 0 };
+	for (size_t i = start + kept; i < end; i++) {
+		const double *p = builder->points + builder->index[i] * 3;
+		int octant = (p[0] >= center[0]) | (p[1] >= center[1]) << 1 |
+			     (p[2] >= center[2]) << 2;
+		counts[octant + 1]++;
+	}
+	for (int k = 0; k < 8; k++)
+		counts[k + 1] += counts[k];
+	size_t fill[8];
+	memcpy(fill, counts, sizeof(fill));
+	for (size_t i = start + kept; i < end; i++) {
+		const double *p = builder->points + builder->index[i] * 3;
+		int octant = (p[0] >= center[0]) | (p[1] >= center[1]) << 1 |
+			     (p[2] >= center[2]) << 2;
+		builder->scratch[fill[octant]++] = builder->index[i];
+	}
+	memcpy(builder->index + start + kept, builder->scratch,
+	       sizeof(size_t) * (end - start - kept));
+	for (int k = 0; k < 8; k++) {
+		if (counts[k + 1] == counts[k])
+			continue;
+		double c[3];
+		for (int j = 0; j < 3; j++)
+			c[j] = center[j] + (k >> j & 1 ? half : -half) / 2.0;
+		int64_t child = _point_cloud_build_node(
+			builder, start + kept + counts[k],
+			start + kept + counts[k + 1], c, half / 2.0, depth + 1);
+		if (child < 0)
+			return -1;
+		builder->nodes[id].children[k] = child;
+	}
+	return id;
+}
+
+static int _point_cloud_write(point_cloud_builder_t *builder,
+			      const char *filename, size_t num_points)
+{
+	point_cloud_file_header_t header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, POINT_CLOUD_FILE_MAGIC, sizeof(header.magic));
+	header.version = POINT_CLOUD_FILE_VERSION;
+	header.header_size = sizeof(header);
+	header.num_nodes = builder->num_nodes;
+	header.num_points = num_points;
+	header.node_size = sizeof(point_cloud_node_t);
+	header.nodes_offset = _point_cloud_file_align(sizeof(header));
+	header.points_offset = _point_cloud_file_align(
+		header.nodes_offset +
+		sizeof(point_cloud_node_t) * builder->num_nodes);
+
+	FILE *file = fopen(filename, "wb");
+	if (file == NULL)
+		return 1;
+	int ret = fwrite(&header, sizeof(header), 1, file) != 1;
+	ret |= _point_cloud_file_pad(file, sizeof(header));
+	ret |= fwrite(builder->nodes, sizeof(point_cloud_node_t),
+		      builder->num_nodes, file) != builder->num_nodes;
+	ret |= _point_cloud_file_pad(file,
+				     header.nodes_offset +
+					     sizeof(point_cloud_node_t) *
+						     builder->num_nodes);
+	// points in node order, gathered through a block
+	double block[POINT_CLOUD_WRITE_BLOCK * 3];
+	for (size_t i = 0; i < num_points && !ret;
+	     i += POINT_CLOUD_WRITE_BLOCK) {
+		size_t num = num_points - i;
+		if (num > POINT_CLOUD_WRITE_BLOCK)
+			num = POINT_CLOUD_WRITE_BLOCK;
+		for (size_t j = 0; j < num; j++)
+			memcpy(block + j * 3,
+			       builder->points + builder->index[i + j] * 3,
+			       sizeof(double) * 3);
+		ret |= fwrite(block, sizeof(double) * 3, num, file) != num;
+	}
+	ret |= fclose(file) != 0;
+	return ret;
+}
+
+int point_cloud_build(const char *filename, size_t num_points, double *points,
+		      size_t node_capacity)
+{
+	// the octree is built in memory, the file is what makes rendering
+	// independent of the cloud size
+	if (!_point_cloud_file_supported() || num_points < 1 ||
+	    node_capacity < 1)
+		return 1;
+	double lo[3] = { INFINITY, INFINITY, INFINITY };
+	double hi[3] = { -INFINITY, -INFINITY, -INFINITY };
+	for (size_t i = 0; i < num_points; i++) {
+		for (int k = 0; k < 3; k++) {
+			if (!isfinite(points[i * 3 + k]))
+				return 1;
+			lo[k] = fmin(lo[k], points[i * 3 + k]);
+			hi[k] = fmax(hi[k], points[i * 3 + k]);
+		}
+	}
+	double center[3], half = 0.0;
+	for (int k = 0; k < 3; k++) {
+		center[k] = (lo[k] + hi[k]) / 2.0;
+		half = fmax(half, (hi[k] - lo[k]) / 2.0);
+	}
+	if (half == 0.0)
+		half = 1.0;
+
+	point_cloud_builder_t builder;
+	memset(&builder, 0, sizeof(builder));
+	builder.points = points;
+	builder.capacity = node_capacity;
+	builder.grid = (int)ceil(cbrt((double)node_capacity));
+	if (builder.grid > 256)
+		builder.grid = 256;
+	builder.nodes_capacity = 64;
+	builder.index = malloc(sizeof(size_t) * num_points);
+	builder.scratch = malloc(sizeof(size_t) * num_points);
+	builder.occupied = malloc((size_t)builder.grid * builder.grid *
+				  builder.grid);
+	builder.nodes =
+		malloc(sizeof(point_cloud_node_t) * builder.nodes_capacity);
+	int ret = builder.index == NULL || builder.scratch == NULL ||
+		  builder.occupied == NULL || builder.nodes == NULL;
+	if (!ret) {
+		for (size_t i = 0; i < num_points; i++)
+			builder.index[i] = i;
+		ret = _point_cloud_build_node(&builder, 0, num_points, center,
+					      half, 0) < 0;
+	}
+	if (!ret)
+		ret = _point_cloud_write(&builder, filename, num_points);
+	free(builder.index);
+	free(builder.scratch);
+	free(builder.occupied);
+	free(builder.nodes);
+	return ret;
+}
+
+point_cloud_t *point_cloud_open(const char *filename)
+{
+	if (!_point_cloud_file_supported())
+		return NULL;
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		return NULL;
+	}
+	size_t size = st.st_size;
+	if (size < sizeof(point_cloud_file_header_t)) {
+		close(fd);
+		return NULL;
+	}
+	// points are paged in when their node is first loaded
+	void *mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED)
+		return NULL;
+
+	const point_cloud_file_header_t *header = mapping;
+	bool valid =
+		memcmp(header->magic, POINT_CLOUD_FILE_MAGIC,
+		       sizeof(header->magic)) == 0 &&
+		header->version == POINT_CLOUD_FILE_VERSION &&
+		header->header_size == sizeof(point_cloud_file_header_t) &&
+		header->node_size == sizeof(point_cloud_node_t) &&
+		header->nodes_offset % POINT_CLOUD_FILE_ALIGN == 0 &&
+		header->points_offset % POINT_CLOUD_FILE_ALIGN == 0 &&
+		header->num_nodes > 0 && header->nodes_offset <= size &&
+		header->points_offset <= size &&
+		header->num_nodes <= (size - header->nodes_offset) /
+					     sizeof(point_cloud_node_t) &&
+		header->num_points <=
+			(size - header->points_offset) / (sizeof(double) * 3);
+	const point_cloud_node_t *nodes =
+		valid ? (const point_cloud_node_t *)((uint8_t *)mapping +
+						     header->nodes_offset) :
+			NULL;
+	// the node table is small next to the points, check it once so that
+	// rendering can follow it unchecked
+	for (size_t i = 0; valid && i < header->num_nodes; i++) {
+		valid = nodes[i].offset <= header->num_points &&
+			nodes[i].count <= header->num_points - nodes[i].offset;
+		for (int k = 0; k < 8 && valid; k++) {
+			int64_t child = nodes[i].children[k];
+			valid = child == -1 ||
+				(child > (int64_t)i &&
+				 (uint64_t)child < header->num_nodes);
+		}
+	}
+	point_cloud_t *point_cloud =
+		valid ? calloc(1, sizeof(point_cloud_t)) : NULL;
+	if (point_cloud == NULL) {
+		munmap(mapping, size);
+		return NULL;
+	}
+	point_cloud->mapping = mapping;
+	point_cloud->mapping_size = size;
+	point_cloud->nodes = nodes;
+	point_cloud->num_nodes = header->num_nodes;
+	point_cloud->points =
+		(const double *)((uint8_t *)mapping + header->points_offset);
+	point_cloud->num_points = header->num_points;
+	point_cloud->budget = 1000000;
+	point_cloud->cache = 4000000;
+	point_cloud->width = 1.0;
+	point_cloud->dirty = true;
+	point_cloud->used = calloc(point_cloud->num_nodes, sizeof(uint64_t));
+	point_cloud->older = malloc(sizeof(size_t) * point_cloud->num_nodes);
+	point_cloud->copied = malloc(sizeof(size_t) * point_cloud->num_nodes);
+	point_cloud->newer = malloc(sizeof(size_t) * point_cloud->num_nodes);
+	point_cloud->oldest = SIZE_MAX;
+	point_cloud->newest = SIZE_MAX;
+	point_cloud->selected = malloc(sizeof(size_t) * point_cloud->num_nodes);
+	point_cloud->selected_previous =
+		malloc(sizeof(size_t) * point_cloud->num_nodes);
+	point_cloud->heap = malloc(sizeof(point_cloud_candidate_t) *
+				   point_cloud->num_nodes);
+	point_cloud->draw_list = draw_list_create();
+	if (point_cloud->used == NULL || point_cloud->older == NULL ||
+	    point_cloud->newer == NULL || point_cloud->copied == NULL ||
+	    point_cloud->selected == NULL ||
+	    point_cloud->selected_previous == NULL ||
+	    point_cloud->heap == NULL || point_cloud->draw_list == NULL) {
+		point_cloud_destroy(point_cloud);
+		return NULL;
+	}
+	return point_cloud;
+}
+
+int point_cloud_destroy(point_cloud_t *point_cloud)
+{
+	free(point_cloud->used);
+	free(point_cloud->older);
+	free(point_cloud->newer);
+	free(point_cloud->copied);
+	free(point_cloud->selected);
+	free(point_cloud->selected_previous);
+	free(point_cloud->heap);
+	if (point_cloud->draw_list != NULL)
+		draw_list_destroy(point_cloud->draw_list);
+	munmap(point_cloud->mapping, point_cloud->mapping_size);
+	free(point_cloud);
+	return 0;
+}
+
+size_t point_cloud_size(point_cloud_t *point_cloud)
+{
+	return point_cloud->num_points;
+}
+
+size_t point_cloud_budget_get(point_cloud_t *point_cloud)
+{
+	return point_cloud->budget;
+}
+
+int point_cloud_budget_set(point_cloud_t *point_cloud, size_t budget)
+{
+	if (budget < 1)
+		return 1;
+	point_cloud->budget = budget;
+	return 0;
+}
+
+size_t point_cloud_cache_get(point_cloud_t *point_cloud)
+{
+	return point_cloud->cache;
+}
+
+int point_cloud_cache_set(point_cloud_t *point_cloud, size_t cache)
+{
+	point_cloud->cache = cache;
+	return 0;
+}
+
+int point_cloud_style(point_cloud_t *point_cloud, double color[4],
+		      double width)
+{
+	memcpy(point_cloud->color, color, sizeof(point_cloud->color));
+	point_cloud->width = width;
+	point_cloud->styled = true;
+	point_cloud->dirty = true;
+	return 0;
+}
+
+draw_list_t *point_cloud_draw_list(point_cloud_t *point_cloud)
+{
+	return point_cloud->draw_list;
+}
+
+size_t point_cloud_drawn(point_cloud_t *point_cloud)
+{
+	return point_cloud->drawn;
+}
+
+static double _point_cloud_screen_size(const double *m, const double *bounds)
+{
+	// diagonal of the projected bounds, infinite for nodes reaching
+	// behind the camera
+	double x0 = INFINITY, y0 = INFINITY, x1 = -INFINITY, y1 = -INFINITY;
+	for (int j = 0; j < 8; j++) {
+		double p[3] = { bounds[j & 1 ? 3 : 0], bounds[j & 2 ? 4 : 1],
+				bounds[j & 4 ? 5 : 2] };
+		double q[4];
+		for (int k = 0; k < 4; k++)
+			q[k] = m[k * 4] * p[0] + m[k * 4 + 1] * p[1] +
+			       m[k * 4 + 2] * p[2] + m[k * 4 + 3];
+		if (!(q[3] > 0.0))
+			return INFINITY;
+		x0 = fmin(x0, q[0] / q[3]);
+		y0 = fmin(y0, q[1] / q[3]);
+		x1 = fmax(x1, q[0] / q[3]);
+		y1 = fmax(y1, q[1] / q[3]);
+	}
+	return hypot(x1 - x0, y1 - y0);
+}
+
+static void _point_cloud_push(point_cloud_t *point_cloud, size_t *num,
+			      double size, size_t node)
+{
+	// max heap on the screen size
+	point_cloud_candidate_t *heap = point_cloud->heap;
+	size_t i = (*num)++;
+	while (i > 0 && heap[(i - 1) / 2].size < size) {
+		heap[i] = heap[(i - 1) / 2];
+		i = (i - 1) / 2;
+	}
+	heap[i].size = size;
+	heap[i].node = node;
+}
+
+static size_t _point_cloud_pop(point_cloud_t *point_cloud, size_t *num)
+{
+	point_cloud_candidate_t *heap = point_cloud->heap;
+	size_t node = heap[0].node;
+	point_cloud_candidate_t last = heap[--(*num)];
+	size_t i = 0;
+	for (;;) {
+		size_t c = i * 2 + 1;
+		if (c >= *num)
+			break;
+		if (c + 1 < *num && heap[c + 1].size > heap[c].size)
+			c++;
+		if (heap[c].size <= last.size)
+			break;
+		heap[i] = heap[c];
+		i = c;
+	}
+	heap[i] = last;
+	return node;
+}
+
+static void _point_cloud_select(point_cloud_t *point_cloud, camera_t *camera)
+{
+	// largest nodes on screen first until the point budget is spent,
+	// children are only considered below selected nodes
+	double m[16];
+	int width, height;
+	camera_projection_get(camera, m);
+	camera_viewport_get(camera, &width, &height);
+	size_t num = 0, points = 0;
+	point_cloud->num_selected = 0;
+	const point_cloud_node_t *root = &point_cloud->nodes[0];
+	if (!_draw_list_box_culled(m, root->bounds, 0.0, width, height))
+		_point_cloud_push(point_cloud, &num,
+				  _point_cloud_screen_size(m, root->bounds), 0);
+	while (num > 0) {
+		double size = point_cloud->heap[0].size;
+		size_t id = _point_cloud_pop(point_cloud, &num);
+		const point_cloud_node_t *node = &point_cloud->nodes[id];
+		if (points + node->count > point_cloud->budget)
+			continue;
+		points += node->count;
+		point_cloud->selected[point_cloud->num_selected++] = id;
+		if (size / cbrt((double)node->count + 1.0) <
+		    POINT_CLOUD_SPACING_PIXELS)
+			continue;
+		for (int k = 0; k < 8; k++) {
+			int64_t child = node->children[k];
+			if (child < 0)
+				continue;
+			const double *bounds = point_cloud->nodes[child].bounds;
+			if (_draw_list_box_culled(m, bounds, 0.0, width,
+						  height))
+				continue;
+			_point_cloud_push(point_cloud, &num,
+					  _point_cloud_screen_size(m, bounds),
+					  child);
+		}
+	}
+}
+
+static void _point_cloud_advise(const double *points, size_t count,
+				int advice)
+{
+	// pages are read in when they overlap the points and only dropped
+	// when the points cover them completely
+	uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+	uintptr_t begin = (uintptr_t)points;
+	uintptr_t end = begin + sizeof(double) * 3 * count;
+	if (advice == MADV_DONTNEED) {
+		begin = (begin + page - 1) / page * page;
+		end = end / page * page;
+	} else {
+		begin = begin / page * page;
+		end = (end + page - 1) / page * page;
+	}
+	if (begin < end)
+		madvise((void *)begin, end - begin, advice);
+}
+
+static void _point_cloud_unlink(point_cloud_t *point_cloud, size_t node)
+{
+	size_t older = point_cloud->older[node];
+	size_t newer = point_cloud->newer[node];
+	if (older != SIZE_MAX)
+		point_cloud->newer[older] = newer;
+	else
+		point_cloud->oldest = newer;
+	if (newer != SIZE_MAX)
+		point_cloud->older[newer] = older;
+	else
+		point_cloud->newest = older;
+}
+
+static void _point_cloud_evict(point_cloud_t *point_cloud, size_t node)
+{
+	const point_cloud_node_t *n = &point_cloud->nodes[node];
+	_point_cloud_unlink(point_cloud, node);
+	point_cloud->used[node] = 0;
+	point_cloud->cached -= n->count;
+	point_cloud->garbage += n->count;
+}
+
+static void _point_cloud_link(point_cloud_t *point_cloud, size_t node)
+{
+	// append to the recently used end of the list
+	point_cloud->used[node] = point_cloud->frame;
+	point_cloud->older[node] = point_cloud->newest;
+	point_cloud->newer[node] = SIZE_MAX;
+	if (point_cloud->newest != SIZE_MAX)
+		point_cloud->newer[point_cloud->newest] = node;
+	else
+		point_cloud->oldest = node;
+	point_cloud->newest = node;
+}
+
+static void _point_cloud_load(point_cloud_t *point_cloud, size_t node)
+{
+	// the buffer is reserved for the copy by the caller, the pages of the
+	// mapping are dropped again once the points are copied
+	const point_cloud_node_t *n = &point_cloud->nodes[node];
+	if (point_cloud->used[node] != 0) {
+		_point_cloud_unlink(point_cloud, node);
+	} else {
+		draw_list_t *draw_list = point_cloud->draw_list;
+		const double *points = point_cloud->points + n->offset * 3;
+		memcpy(draw_list->buffer + draw_list->buffer_length, points,
+		       sizeof(double) * 3 * n->count);
+		_point_cloud_advise(points, n->count, MADV_DONTNEED);
+		point_cloud->copied[node] = draw_list->buffer_length;
+		draw_list->buffer_length += 3 * n->count;
+		point_cloud->cached += n->count;
+	}
+	_point_cloud_link(point_cloud, node);
+}
+
+static int _point_cloud_reset(point_cloud_t *point_cloud)
+{
+	// start over with an empty buffer holding only the style
+	while (point_cloud->oldest != SIZE_MAX)
+		_point_cloud_evict(point_cloud, point_cloud->oldest);
+	point_cloud->garbage = 0;
+	draw_list_t *draw_list = point_cloud->draw_list;
+	int ret = draw_list_empty(draw_list);
+	if (point_cloud->styled)
+		ret |= draw_list_style(draw_list, point_cloud->color,
+				       point_cloud->width);
+	point_cloud->base = draw_list->buffer_length;
+	return ret;
+}
+
+static int _point_cloud_compact(point_cloud_t *point_cloud)
+{
+	// move the copies of the loaded nodes together into a new buffer
+	draw_list_t *draw_list = point_cloud->draw_list;
+	if (_draw_list_reserve(draw_list, draw_list->length,
+			       draw_list->buffer_length))
+		return 1;
+	size_t length = point_cloud->base + 3 * point_cloud->cached;
+	size_t capacity = length > 2 ? length * 2 : 4;
+	double *buffer = malloc(sizeof(double) * capacity);
+	if (buffer == NULL)
+		return 1;
+	memcpy(buffer, draw_list->buffer, sizeof(double) * point_cloud->base);
+	size_t offset = point_cloud->base;
+	for (size_t node = point_cloud->oldest; node != SIZE_MAX;
+	     node = point_cloud->newer[node]) {
+		size_t count = point_cloud->nodes[node].count;
+		memcpy(buffer + offset,
+		       draw_list->buffer + point_cloud->copied[node],
+		       sizeof(double) * 3 * count);
+		point_cloud->copied[node] = offset;
+		offset += 3 * count;
+	}
+	free(draw_list->buffer);
+	draw_list->buffer = buffer;
+	draw_list->buffer_length = offset;
+	draw_list->buffer_capacity = capacity;
+	point_cloud->garbage = 0;
+	return 0;
+}
+
+static int _point_cloud_rebuild(point_cloud_t *point_cloud)
+{
+	// the primitives refer to the copies of the selected nodes, only
+	// nodes not loaded yet are copied out of the mapping
+	if (point_cloud->dirty && _point_cloud_reset(point_cloud))
+		return 1;
+	size_t fresh = 0;
+	for (size_t i = 0; i < point_cloud->num_selected; i++) {
+		size_t node = point_cloud->selected[i];
+		if (point_cloud->used[node] == 0)
+			fresh += point_cloud->nodes[node].count;
+	}
+	if (point_cloud->garbage > point_cloud->cached + fresh &&
+	    _point_cloud_compact(point_cloud))
+		return 1;
+	draw_list_t *draw_list = point_cloud->draw_list;
+	size_t length = point_cloud->styled ? 1 : 0;
+	if (_draw_list_reserve(draw_list,
+			       length + point_cloud->num_selected,
+			       draw_list->buffer_length + 3 * fresh))
+		return 1;
+	for (size_t i = 0; i < point_cloud->num_selected; i++) {
+		size_t node = point_cloud->selected[i];
+		size_t count = point_cloud->nodes[node].count;
+		_point_cloud_load(point_cloud, node);
+		point_cloud->drawn += count;
+		if (count == 0)
+			continue;
+		primitive_t *primitive = &draw_list->primitives[length++];
+		primitive->type = PRIMITIVE_TYPE_POINT;
+		primitive->index = point_cloud->copied[node];
+		primitive->length = 3 * count;
+	}
+	draw_list->length = length;
+	_draw_list_changed(draw_list);
+	point_cloud->version = draw_list->version;
+	return 0;
+}
+
+int point_cloud_update(point_cloud_t *point_cloud, camera_t *camera)
+{
+	// the draw list is only rebuilt when the selection changes
+	camera_update(camera);
+	point_cloud->frame++;
+	size_t *previous = point_cloud->selected_previous;
+	point_cloud->selected_previous = point_cloud->selected;
+	point_cloud->selected = previous;
+	point_cloud->num_selected_previous = point_cloud->num_selected;
+	_point_cloud_select(point_cloud, camera);
+	if (point_cloud->draw_list->version != point_cloud->version)
+		point_cloud->dirty = true;
+	if (!point_cloud->dirty &&
+	    point_cloud->num_selected == point_cloud->num_selected_previous &&
+	    memcmp(point_cloud->selected, point_cloud->selected_previous,
+		   sizeof(size_t) * point_cloud->num_selected) == 0) {
+		for (size_t i = 0; i < point_cloud->num_selected; i++)
+			_point_cloud_load(point_cloud,
+					  point_cloud->selected[i]);
+		return 0;
+	}
+	point_cloud->drawn = 0;
+	int ret = _point_cloud_rebuild(point_cloud);
+	// drop the least recently used nodes not drawn this frame
+	while (point_cloud->cached > point_cloud->cache &&
+	       point_cloud->oldest != SIZE_MAX &&
+	       point_cloud->used[point_cloud->oldest] != point_cloud->frame)
+		_point_cloud_evict(point_cloud, point_cloud->oldest);
+	point_cloud->dirty = ret != 0;
+	return ret;
+}
+
+int point_cloud_render(point_cloud_t *point_cloud, cairo_t *cr,
+		       camera_t *camera)
+{
+	if (point_cloud_update(point_cloud, camera))
+		return 1;
+	return draw_list_render(point_cloud->draw_list, cr, camera);
+}
@@ -0,0 +1,159 @@
+#include "raster_private.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+bool _raster_target(raster_t *raster, cairo_t *cr)
+{
+	// only untransformed ARGB32 image targets with a rectangular clip
+	cairo_surface_t *surface = cairo_get_group_target(cr);
+	if (cairo_surface_get_type(surface) != CAIRO_SURFACE_TYPE_IMAGE ||
+	    cairo_image_surface_get_format(surface) != CAIRO_FORMAT_ARGB32)
+		return false;
+	cairo_matrix_t m;
+	double dx, dy;
+	cairo_get_matrix(cr, &m);
+	cairo_surface_get_device_offset(surface, &dx, &dy);
+	if (m.xx != 1.0 || m.yx != 0.0 || m.xy != 0.0 || m.yy != 1.0 ||
+	    m.x0 != 0.0 || m.y0 != 0.0 || dx != 0.0 || dy != 0.0)
+		return false;
+	cairo_rectangle_list_t *clip = cairo_copy_clip_rectangle_list(cr);
+	// the extents of several rectangles would cover pixels outside them
+	bool rectangular = clip->status == CAIRO_STATUS_SUCCESS &&
+			   clip->num_rectangles <= 1;
+	cairo_rectangle_list_destroy(clip);
+	if (!rectangular)
+		return false;
+	double x0, y0, x1, y1;
+	cairo_clip_extents(cr, &x0, &y0, &x1, &y1);
+	int width = cairo_image_surface_get_width(surface);
+	int height = cairo_image_surface_get_height(surface);
+	raster->surface = surface;
+	raster->stride = cairo_image_surface_get_stride(surface) / 4;
+	raster->x0 = (int)fmax(ceil(x0), 0.0);
+	raster->y0 = (int)fmax(ceil(y0), 0.0);
+	raster->x1 = (int)fmin(floor(x1), width);
+	raster->y1 = (int)fmin(floor(y1), height);
+	return raster->x0 < raster->x1 && raster->y0 < raster->y1;
+}
+
+bool _raster_begin(raster_t *raster, cairo_t *cr)
+{
+	double r, g, b, a;
+	if (cairo_get_line_width(cr) > 1.0 ||
+	    cairo_get_operator(cr) != CAIRO_OPERATOR_OVER ||
+	    cairo_pattern_get_rgba(cairo_get_source(cr), &r, &g, &b, &a) !=
+		    CAIRO_STATUS_SUCCESS)
+		return false;
+	cairo_surface_flush(raster->surface);
+	unsigned char *data = cairo_image_surface_get_data(raster->surface);
+	if (data == NULL)
+		return false;
+	raster->data = (uint32_t *)data;
+	raster->alpha = (uint32_t)(a * 255.0 + 0.5);
+	raster->color = raster->alpha << 24 |
+			(uint32_t)(r * a * 255.0 + 0.5) << 16 |
+			(uint32_t)(g * a * 255.0 + 0.5) << 8 |
+			(uint32_t)(b * a * 255.0 + 0.5);
+	return true;
+}
+
+void _raster_end(raster_t *raster)
+{
+	cairo_surface_mark_dirty(raster->surface);
+}
+
+static inline void _raster_blend(raster_t *raster, int x, int y)
+{
+	uint32_t *p = &raster->data[(size_t)y * raster->stride + x];
+	if (raster->alpha == 255) {
+		*p = raster->color;
+		return;
+	}
+	// premultiplied over, two channels at a time
+	uint32_t inv = 255 - raster->alpha;
+	uint32_t rb = (*p & 0x00ff00ff) * inv + 0x00800080;
+	rb = ((rb + ((rb >> 8) & 0x00ff00ff)) >> 8) & 0x00ff00ff;
+	uint32_t ag = ((*p >> 8) & 0x00ff00ff) * inv + 0x00800080;
+	ag = (ag + ((ag >> 8) & 0x00ff00ff)) & 0xff00ff00;
+	*p = raster->color + rb + ag;
+}
+
+static bool _raster_clip(double p, double q, double *t0, double *t1)
+{
+	// one liang-barsky boundary test
+	if (p == 0.0)
+		return q >= 0.0;
+	double t = q / p;
+	if (p < 0.0) {
+		if (t > *t1)
+			return false;
+		if (t > *t0)
+			*t0 = t;
+	} else {
+		if (t < *t0)
+			return false;
+		if (t < *t1)
+			*t1 = t;
+	}
+	return true;
+}
+
+void _raster_line(raster_t *raster, double x0, double y0, double x1,
+		  double y1, bool skip_last)
+{
+	// clip to the box in continuous coordinates first, so that far away
+	// endpoints cost nothing, then walk the pixels with bresenham
+	double dx = x1 - x0, dy = y1 - y0;
+	double t0 = 0.0, t1 = 1.0;
+	double bx1 = nextafter(raster->x1, raster->x0);
+	double by1 = nextafter(raster->y1, raster->y0);
+	if (!isfinite(dx) || !isfinite(dy) ||
+	    !_raster_clip(-dx, x0 - raster->x0, &t0, &t1) ||
+	    !_raster_clip(dx, bx1 - x0, &t0, &t1) ||
+	    !_raster_clip(-dy, y0 - raster->y0, &t0, &t1) ||
+	    !_raster_clip(dy, by1 - y0, &t0, &t1))
+		return;
+	if (t1 < 1.0)
+		skip_last = false;
+	int ix0 = (int)floor(x0 + t0 * dx), iy0 = (int)floor(y0 + t0 * dy);
+	int ix1 = (int)floor(x0 + t1 * dx), iy1 = (int)floor(y0 + t1 * dy);
+	// rounding of the clipped ends may land on the box edge
+	ix0 = ix0 < raster->x0 ? raster->x0 : ix0;
+	ix0 = ix0 >= raster->x1 ? raster->x1 - 1 : ix0;
+	ix1 = ix1 < raster->x0 ? raster->x0 : ix1;
+	ix1 = ix1 >= raster->x1 ? raster->x1 - 1 : ix1;
+	iy0 = iy0 < raster->y0 ? raster->y0 : iy0;
+	iy0 = iy0 >= raster->y1 ? raster->y1 - 1 : iy0;
+	iy1 = iy1 < raster->y0 ? raster->y0 : iy1;
+	iy1 = iy1 >= raster->y1 ? raster->y1 - 1 : iy1;
+
+	int sx = ix0 < ix1 ? 1 : -1, sy = iy0 < iy1 ? 1 : -1;
+	int ex = abs(ix1 - ix0), ey = -abs(iy1 - iy0);
+	int err = ex + ey;
+	for (;;) {
+		bool last = ix0 == ix1 && iy0 == iy1;
+		if (last && skip_last)
+			break;
+		_raster_blend(raster, ix0, iy0);
+		if (last)
+			break;
+		int e2 = 2 * err;
+		if (e2 >= ey) {
+			err += ey;
+			ix0 += sx;
+		}
+		if (e2 <= ex) {
+			err += ex;
+			iy0 += sy;
+		}
+	}
+}
+
+void _raster_point(raster_t *raster, double x, double y)
+{
+	if (!(x >= raster->x0 && x < raster->x1 && y >= raster->y0 &&
+	      y < raster->y1))
+		return;
+	_raster_blend(raster, (int)x, (int)y);
+}
@@ -0,0 +1,36 @@
+#ifndef RASTER_PRIVATE_H
+#define RASTER_PRIVATE_H
+
+#include <cairo/cairo.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// aliased one pixel wide lines and points written straight into the pixels
+// of a cairo ARGB32 image surface, bypassing the stroker
+typedef struct {
+	cairo_surface_t *surface;
+	uint32_t *data;
+	// row stride in pixels
+	int stride;
+	// clip box in pixels, x0 and y0 inclusive, x1 and y1 exclusive
+	int x0;
+	int y0;
+	int x1;
+	int y1;
+	// premultiplied color of the current source
+	uint32_t color;
+	uint32_t alpha;
+} raster_t;
+
+// check that the target of cr can be written directly, once per render
+bool _raster_target(raster_t *raster, cairo_t *cr);
+// check the current source and line width, flushes the surface
+bool _raster_begin(raster_t *raster, cairo_t *cr);
+// hand the surface back to cairo
+void _raster_end(raster_t *raster);
+// draw a line, without its last pixel if skip_last is set
+void _raster_line(raster_t *raster, double x0, double y0, double x1,
+		  double y1, bool skip_last);
+void _raster_point(raster_t *raster, double x, double y);
+
+#endif
@@ -0,0 +1,946 @@
+#include "recorder.h"
+#include "drawlist_private.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RECORDER_MAGIC "D3DREC"
+#define RECORDER_INDEX_MAGIC "D3DINDX"
+#define RECORDER_VERSION 1
+#define RECORDER_FRAME_MAGIC 0x46443344u
+#define RECORDER_KEYFRAME (1ull << 63)
+
+// a list is either a reference to its contents in the previous frame or a
+// delta: the common prefix is kept and the changed tail follows, optionally
+// xor'ed with the previous tail and zero-run-length encoded; keyframes store
+// every list in full unless it still matches its last full record, which is
+// then referenced by offset
+
+// the frame header is followed by the number of lists passed to
+// recorder_frame, the lists below them follow those, each after all lists
+// referring to it; every list record is followed by its child edges
+#define RECORD_REFERENCE 0
+#define RECORD_DELTA 1
+#define RECORD_EARLIER 2
+#define RECORD_COMPRESSED 1
+#define RECORD_XOR 2
+
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t flags;
+} recorder_header_t;
+
+typedef struct {
+	uint32_t magic;
+	uint32_t num_lists;
+	uint64_t frame;
+	double camera[CAMERA_STATE_LEN];
+} recorder_frame_t;
+
+typedef struct {
+	uint32_t mode;
+	uint32_t flags;
+	uint64_t length;
+	uint64_t buffer_length;
+	uint64_t keep;
+	uint64_t buffer_keep;
+	uint64_t payload_size;
+} recorder_record_t;
+
+// primitive as stored in the stream, with zeroed padding
+typedef struct {
+	uint32_t type;
+	uint32_t reserved;
+	uint64_t index;
+	uint64_t length;
+} recorder_primitive_t;
+
+typedef struct {
+	uint64_t list;
+	double local[16];
+} recorder_edge_t;
+
+typedef struct {
+	char magic[8];
+	uint64_t index_offset;
+	uint64_t num_frames;
+} recorder_trailer_t;
+
+typedef struct {
+	// serial and version of the list recorded last, and its contents
+	uint64_t serial;
+	uint64_t version;
+	size_t length;
+	size_t capacity;
+	recorder_primitive_t *primitives;
+	size_t buffer_length;
+	size_t buffer_capacity;
+	double *buffer;
+	// offset of the last full record, valid while the contents match it
+	uint64_t full;
+	bool full_current;
+} recorder_slot_t;
+
+struct recorder_s {
+	FILE *file;
+	bool compress;
+	bool error;
+	uint64_t offset;
+	size_t keyframe_interval;
+	size_t num_frames;
+	size_t index_capacity;
+	uint64_t *index;
+	size_t num_slots;
+	recorder_slot_t *slots;
+	// lists of the current frame, the passed ones and their descendants
+	size_t num_lists;
+	size_t lists_capacity;
+	draw_list_t **lists;
+	size_t scratch_capacity;
+	uint8_t *scratch;
+	size_t packed_capacity;
+	uint8_t *packed;
+};
+
+struct player_s {
+	FILE *file;
+	size_t num_frames;
+	uint64_t *index;
+	size_t frame;
+	size_t num_top;
+	size_t num_lists;
+	size_t lists_capacity;
+	draw_list_t **draw_lists;
+	// offset of the full record each list matches, UINT64_MAX for none
+	uint64_t *sources;
+	double camera[CAMERA_STATE_LEN];
+	size_t scratch_capacity;
+	uint8_t *scratch;
+	size_t packed_capacity;
+	uint8_t *packed;
+	size_t edges_capacity;
+	draw_list_t **children;
+	double *locals;
+};
+
+static int _reserve(uint8_t **data, size_t *capacity, size_t size)
+{
+	if (size <= *capacity)
+		return 0;
+	size_t new_capacity = *capacity ? *capacity : 4096;
+	while (new_capacity < size)
+		new_capacity *= 2;
+	uint8_t *new_data = realloc(*data, new_capacity);
+	if (new_data == NULL)
+		return 1;
+	*data = new_data;
+	*capacity = new_capacity;
+	return 0;
+}
+
+static size_t _rle_encode(const uint8_t *src, size_t size, uint8_t *dst)
+{
+	// control byte c < 0x80: c + 1 literal bytes follow
+	// control byte c >= 0x80: c - 0x7f zero bytes
+	size_t i = 0, n = 0;
+	while (i < size) {
+		size_t run = 0;
+		while (i + run < size && src[i + run] == 0 && run < 128)
+			run++;
+		if (run > 1 || (run == 1 && i + 1 == size)) {
+			dst[n++] = 0x7f + run;
+			i += run;
+			continue;
+		}
+		size_t start = i;
+		while (i < size && i - start < 128) {
+			if (src[i] == 0 && i + 1 < size && src[i + 1] == 0)
+				break;
+			i++;
+		}
+		dst[n++] = i - start - 1;
+		memcpy(dst + n, src + start, i - start);
+		n += i - start;
+	}
+	return n;
+}
+
+static int _rle_decode(const uint8_t *src, size_t size, uint8_t *dst,
+		       size_t dst_size)
+{
+	size_t i = 0, n = 0;
+	while (i < size) {
+		uint8_t c = src[i++];
+		if (c >= 0x80) {
+			size_t run = c - 0x7f;
+			if (n + run > dst_size)
+				return 1;
+			memset(dst + n, 0, run);
+			n += run;
+		} else {
+			size_t run = c + 1;
+			if (n + run > dst_size || i + run > size)
+				return 1;
+			memcpy(dst + n, src + i, run);
+			n += run;
+			i += run;
+		}
+	}
+	return n != dst_size;
+}
+
+static void _xor(uint8_t *dst, const uint8_t *src, size_t size)
+{
+	for (size_t i = 0; i < size; i++)
+		dst[i] ^= src[i];
+}
+
+static void _pack_primitive(recorder_primitive_t *dst, primitive_t *src)
+{
+	memset(dst, 0, sizeof(*dst));
+	dst->type = src->type;
+	dst->index = src->index;
+	dst->length = src->length;
+}
+
+recorder_t *recorder_create(const char *filename, bool compress)
+{
+	recorder_t *recorder = calloc(1, sizeof(recorder_t));
+	if (recorder == NULL)
+		return NULL;
+	recorder->file = fopen(filename, "wb");
+	if (recorder->file == NULL) {
+		free(recorder);
+		return NULL;
+	}
+	recorder->compress = compress;
+	recorder->keyframe_interval = 300;
+	recorder_header_t header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, RECORDER_MAGIC, sizeof(RECORDER_MAGIC));
+	header.version = RECORDER_VERSION;
+	header.flags = compress ? RECORD_COMPRESSED : 0;
+	if (fwrite(&header, sizeof(header), 1, recorder->file) != 1)
+		recorder->error = true;
+	recorder->offset = sizeof(header);
+	return recorder;
+}
+
+int recorder_destroy(recorder_t *recorder)
+{
+	// the index footer lets the player seek without scanning the stream
+	recorder_trailer_t trailer;
+	memset(&trailer, 0, sizeof(trailer));
+	memcpy(trailer.magic, RECORDER_INDEX_MAGIC,
+	       sizeof(RECORDER_INDEX_MAGIC));
+	trailer.index_offset = recorder->offset;
+	trailer.num_frames = recorder->num_frames;
+	int ret = recorder->error;
+	ret |= fwrite(recorder->index, sizeof(uint64_t), recorder->num_frames,
+		      recorder->file) != recorder->num_frames;
+	ret |= fwrite(&trailer, sizeof(trailer), 1, recorder->file) != 1;
+	ret |= fclose(recorder->file) != 0;
+	for (size_t i = 0; i < recorder->num_slots; i++) {
+		free(recorder->slots[i].primitives);
+		free(recorder->slots[i].buffer);
+	}
+	free(recorder->slots);
+	free(recorder->lists);
+	free(recorder->index);
+	free(recorder->scratch);
+	free(recorder->packed);
+	free(recorder);
+	return ret;
+}
+
+int recorder_keyframe_interval_set(recorder_t *recorder, size_t interval)
+{
+	if (interval < 1)
+		return 1;
+	recorder->keyframe_interval = interval;
+	return 0;
+}
+
+static void _recorder_write(recorder_t *recorder, const void *data,
+			    size_t size)
+{
+	if (size > 0 && fwrite(data, 1, size, recorder->file) != size)
+		recorder->error = true;
+	recorder->offset += size;
+}
+
+static int _recorder_slot_update(recorder_slot_t *slot, draw_list_t *draw_list,
+				 size_t keep, size_t buffer_keep)
+{
+	if (draw_list->length > slot->capacity) {
+		size_t capacity = draw_list->length * 2;
+		recorder_primitive_t *primitives = realloc(
+			slot->primitives,
+			sizeof(recorder_primitive_t) * capacity);
+		if (primitives == NULL)
+			return 1;
+		slot->primitives = primitives;
+		slot->capacity = capacity;
+	}
+	if (draw_list->buffer_length > slot->buffer_capacity) {
+		size_t capacity = draw_list->buffer_length * 2;
+		double *buffer =
+			realloc(slot->buffer, sizeof(double) * capacity);
+		if (buffer == NULL)
+			return 1;
+		slot->buffer = buffer;
+		slot->buffer_capacity = capacity;
+	}
+	for (size_t i = keep; i < draw_list->length; i++)
+		_pack_primitive(&slot->primitives[i],
+				&draw_list->primitives[i]);
+	memcpy(slot->buffer + buffer_keep, draw_list->buffer + buffer_keep,
+	       sizeof(double) * (draw_list->buffer_length - buffer_keep));
+	slot->length = draw_list->length;
+	slot->buffer_length = draw_list->buffer_length;
+	slot->serial = draw_list->serial;
+	slot->version = draw_list->version;
+	return 0;
+}
+
+static int _recorder_list(recorder_t *recorder, recorder_slot_t *slot,
+			  draw_list_t *draw_list, bool keyframe)
+{
+	recorder_record_t record;
+	memset(&record, 0, sizeof(record));
+	bool same = slot->serial == draw_list->serial &&
+		    slot->version == draw_list->version;
+
+	// common prefix with the previously recorded contents
+	size_t keep = 0, buffer_keep = 0;
+	if (!same) {
+		recorder_primitive_t packed;
+		while (keep < slot->length && keep < draw_list->length) {
+			_pack_primitive(&packed, &draw_list->primitives[keep]);
+			if (memcmp(&packed, &slot->primitives[keep],
+				   sizeof(packed)) != 0)
+				break;
+			keep++;
+		}
+		size_t n = slot->buffer_length < draw_list->buffer_length ?
+				   slot->buffer_length :
+				   draw_list->buffer_length;
+		while (buffer_keep < n) {
+			size_t block = n - buffer_keep < 512 ?
+					       n - buffer_keep :
+					       512;
+			if (memcmp(slot->buffer + buffer_keep,
+				   draw_list->buffer + buffer_keep,
+				   sizeof(double) * block) != 0)
+				break;
+			buffer_keep += block;
+		}
+		while (buffer_keep < n &&
+		       memcmp(slot->buffer + buffer_keep,
+			      draw_list->buffer + buffer_keep,
+			      sizeof(double)) == 0)
+			buffer_keep++;
+		same = keep == draw_list->length && keep == slot->length &&
+		       buffer_keep == draw_list->buffer_length &&
+		       buffer_keep == slot->buffer_length;
+	}
+	if (same) {
+		slot->serial = draw_list->serial;
+		slot->version = draw_list->version;
+		if (!keyframe) {
+			_recorder_write(recorder, &record,
+					sizeof(uint32_t) * 2);
+			return 0;
+		}
+		if (slot->full_current) {
+			record.mode = RECORD_EARLIER;
+			_recorder_write(recorder, &record,
+					sizeof(uint32_t) * 2);
+			_recorder_write(recorder, &slot->full,
+					sizeof(slot->full));
+			return 0;
+		}
+	}
+	if (keyframe) {
+		keep = 0;
+		buffer_keep = 0;
+	}
+
+	size_t primitives_size =
+		sizeof(recorder_primitive_t) * (draw_list->length - keep);
+	size_t buffer_size =
+		sizeof(double) * (draw_list->buffer_length - buffer_keep);
+	size_t size = primitives_size + buffer_size;
+	if (_reserve(&recorder->scratch, &recorder->scratch_capacity, size))
+		return 1;
+	uint8_t *data = recorder->scratch;
+	recorder_primitive_t *primitives = (recorder_primitive_t *)data;
+	for (size_t i = keep; i < draw_list->length; i++)
+		_pack_primitive(&primitives[i - keep],
+				&draw_list->primitives[i]);
+	memcpy(data + primitives_size, draw_list->buffer + buffer_keep,
+	       buffer_size);
+
+	record.mode = RECORD_DELTA;
+	record.length = draw_list->length;
+	record.buffer_length = draw_list->buffer_length;
+	record.keep = keep;
+	record.buffer_keep = buffer_keep;
+	record.payload_size = size;
+	if (recorder->compress) {
+		// keyframes must decode without any previous state
+		if (!keyframe) {
+			record.flags |= RECORD_XOR;
+			if (keep < slot->length) {
+				size_t n = slot->length - keep;
+				if (n > draw_list->length - keep)
+					n = draw_list->length - keep;
+				_xor(data,
+				     (uint8_t *)(slot->primitives + keep),
+				     sizeof(recorder_primitive_t) * n);
+			}
+			if (buffer_keep < slot->buffer_length) {
+				size_t n = slot->buffer_length - buffer_keep;
+				if (n > draw_list->buffer_length - buffer_keep)
+					n = draw_list->buffer_length -
+					    buffer_keep;
+				_xor(data + primitives_size,
+				     (uint8_t *)(slot->buffer + buffer_keep),
+				     sizeof(double) * n);
+			}
+		}
+		if (_reserve(&recorder->packed, &recorder->packed_capacity,
+			     size + size / 128 + 16))
+			return 1;
+		record.flags |= RECORD_COMPRESSED;
+		record.payload_size =
+			_rle_encode(data, size, recorder->packed);
+		data = recorder->packed;
+	}
+	slot->full_current = keyframe;
+	if (keyframe)
+		slot->full = recorder->offset;
+	_recorder_write(recorder, &record, sizeof(record));
+	_recorder_write(recorder, data, record.payload_size);
+	return _recorder_slot_update(slot, draw_list, keep, buffer_keep);
+}
+
+static size_t _recorder_find(recorder_t *recorder, size_t top,
+			     draw_list_t *draw_list)
+{
+	for (size_t i = top; i < recorder->num_lists; i++) {
+		if (recorder->lists[i] == draw_list)
+			return i;
+	}
+	return SIZE_MAX;
+}
+
+static int _recorder_lists_add(recorder_t *recorder, draw_list_t *draw_list)
+{
+	if (recorder->num_lists == recorder->lists_capacity) {
+		size_t capacity = recorder->lists_capacity ?
+					  recorder->lists_capacity * 2 :
+					  16;
+		draw_list_t **lists = realloc(recorder->lists,
+					      sizeof(draw_list_t *) * capacity);
+		if (lists == NULL)
+			return 1;
+		recorder->lists = lists;
+		recorder->lists_capacity = capacity;
+	}
+	recorder->lists[recorder->num_lists++] = draw_list;
+	return 0;
+}
+
+static int _recorder_descendants(recorder_t *recorder, size_t top,
+				 draw_list_t *draw_list)
+{
+	// post order, each list follows the lists below it, and a list
+	// referenced several times is stored once
+	for (size_t i = 0; i < draw_list->num_children; i++) {
+		draw_list_t *child = draw_list->children[i].draw_list;
+		if (_recorder_find(recorder, top, child) != SIZE_MAX)
+			continue;
+		if (_recorder_descendants(recorder, top, child) ||
+		    _recorder_lists_add(recorder, child))
+			return 1;
+	}
+	return 0;
+}
+
+static void _recorder_edges(recorder_t *recorder, size_t top,
+			    draw_list_t *draw_list)
+{
+	uint64_t num = draw_list->num_children;
+	_recorder_write(recorder, &num, sizeof(num));
+	for (size_t i = 0; i < draw_list->num_children; i++) {
+		draw_list_child_t *child = &draw_list->children[i];
+		recorder_edge_t edge;
+		edge.list = _recorder_find(recorder, top, child->draw_list);
+		memcpy(edge.local, child->local, sizeof(edge.local));
+		_recorder_write(recorder, &edge, sizeof(edge));
+	}
+}
+
+int recorder_frame(recorder_t *recorder, camera_t *camera, size_t num,
+		   draw_list_t **draw_lists)
+{
+	// the passed lists keep their positions, the lists below them follow
+	// with every parent before its children
+	recorder->num_lists = 0;
+	for (size_t i = 0; i < num; i++) {
+		if (_recorder_lists_add(recorder, draw_lists[i]))
+			return 1;
+	}
+	for (size_t i = 0; i < num; i++) {
+		if (_recorder_descendants(recorder, num, draw_lists[i]))
+			return 1;
+	}
+	for (size_t i = num, j = recorder->num_lists; i + 1 < j; i++, j--) {
+		draw_list_t *tmp = recorder->lists[i];
+		recorder->lists[i] = recorder->lists[j - 1];
+		recorder->lists[j - 1] = tmp;
+	}
+	size_t top = num;
+	num = recorder->num_lists;
+	if (recorder->num_frames == recorder->index_capacity) {
+		size_t capacity = recorder->index_capacity ?
+					  recorder->index_capacity * 2 :
+					  1024;
+		uint64_t *index =
+			realloc(recorder->index, sizeof(uint64_t) * capacity);
+		if (index == NULL)
+			return 1;
+		recorder->index = index;
+		recorder->index_capacity = capacity;
+	}
+	if (num > recorder->num_slots) {
+		recorder_slot_t *slots =
+			realloc(recorder->slots, sizeof(recorder_slot_t) * num);
+		if (slots == NULL)
+			return 1;
+		memset(slots + recorder->num_slots, 0,
+		       sizeof(recorder_slot_t) * (num - recorder->num_slots));
+		recorder->slots = slots;
+		recorder->num_slots = num;
+	}
+
+	bool keyframe =
+		recorder->num_frames % recorder->keyframe_interval == 0;
+	recorder->index[recorder->num_frames] =
+		recorder->offset | (keyframe ? RECORDER_KEYFRAME : 0);
+	recorder_frame_t frame;
+	memset(&frame, 0, sizeof(frame));
+	frame.magic = RECORDER_FRAME_MAGIC;
+	frame.num_lists = num;
+	frame.frame = recorder->num_frames;
+	camera_state_get(camera, frame.camera);
+	_recorder_write(recorder, &frame, sizeof(frame));
+	uint64_t num_top = top;
+	_recorder_write(recorder, &num_top, sizeof(num_top));
+	for (size_t i = 0; i < num; i++) {
+		if (_recorder_list(recorder, &recorder->slots[i],
+				   recorder->lists[i], keyframe))
+			recorder->error = true;
+		_recorder_edges(recorder, top, recorder->lists[i]);
+	}
+	recorder->num_frames++;
+	// keep the stream readable up to the last frame after a crash
+	if (fflush(recorder->file) != 0)
+		recorder->error = true;
+	return recorder->error;
+}
+
+static int _player_read(player_t *player, void *data, size_t size)
+{
+	return size > 0 && fread(data, 1, size, player->file) != size;
+}
+
+static int _player_scan(player_t *player)
+{
+	// no index footer, the recording was interrupted: walk the frames and
+	// keep every complete one
+	if (fseek(player->file, 0, SEEK_END) != 0)
+		return 1;
+	long size = ftell(player->file);
+	if (size < 0)
+		return 1;
+	size_t capacity = 0;
+	uint64_t offset = sizeof(recorder_header_t);
+	uint64_t *index = NULL;
+	size_t num = 0;
+	recorder_frame_t frame;
+	while (fseek(player->file, offset, SEEK_SET) == 0 &&
+	       _player_read(player, &frame, sizeof(frame)) == 0 &&
+	       frame.magic == RECORDER_FRAME_MAGIC) {
+		uint64_t end = offset + sizeof(frame) + sizeof(uint64_t);
+		for (uint32_t i = 0; i < frame.num_lists; i++) {
+			if (end > (uint64_t)size)
+				break;
+			recorder_record_t record;
+			memset(&record, 0, sizeof(record));
+			if (fseek(player->file, end, SEEK_SET) != 0 ||
+			    _player_read(player, &record, sizeof(uint32_t) * 2))
+				end = UINT64_MAX;
+			else if (record.mode == RECORD_REFERENCE)
+				end += sizeof(uint32_t) * 2;
+			else if (record.mode == RECORD_EARLIER)
+				end += sizeof(uint32_t) * 2 + sizeof(uint64_t);
+			else if (_player_read(player, &record.length,
+					      sizeof(record) -
+						      sizeof(uint32_t) * 2))
+				end = UINT64_MAX;
+			else
+				end += sizeof(record) + record.payload_size;
+			uint64_t edges;
+			if (end > (uint64_t)size)
+				continue;
+			if (fseek(player->file, end, SEEK_SET) != 0 ||
+			    _player_read(player, &edges, sizeof(edges)) ||
+			    edges > (uint64_t)size / sizeof(recorder_edge_t))
+				end = UINT64_MAX;
+			else
+				end += sizeof(edges) +
+				       sizeof(recorder_edge_t) * edges;
+		}
+		if (end > (uint64_t)size)
+			break;
+		if (num == capacity) {
+			capacity = capacity ? capacity * 2 : 1024;
+			uint64_t *new_index =
+				realloc(index, sizeof(uint64_t) * capacity);
+			if (new_index == NULL)
+				break;
+			index = new_index;
+		}
+		// without the footer only the first frame is a known keyframe
+		index[num] = offset;
+		if (frame.frame == 0)
+			index[num] |= RECORDER_KEYFRAME;
+		num++;
+		offset = end;
+	}
+	player->index = index;
+	player->num_frames = num;
+	return 0;
+}
+
+player_t *player_open(const char *filename)
+{
+	player_t *player = calloc(1, sizeof(player_t));
+	if (player == NULL)
+		return NULL;
+	player->frame = SIZE_MAX;
+	player->file = fopen(filename, "rb");
+	recorder_header_t header;
+	if (player->file == NULL ||
+	    _player_read(player, &header, sizeof(header)) ||
+	    memcmp(header.magic, RECORDER_MAGIC, sizeof(RECORDER_MAGIC)) != 0 ||
+	    header.version != RECORDER_VERSION) {
+		player_destroy(player);
+		return NULL;
+	}
+
+	recorder_trailer_t trailer;
+	bool indexed = fseek(player->file, -(long)sizeof(trailer), SEEK_END) ==
+			       0 &&
+		       _player_read(player, &trailer, sizeof(trailer)) == 0 &&
+		       memcmp(trailer.magic, RECORDER_INDEX_MAGIC,
+			      sizeof(RECORDER_INDEX_MAGIC)) == 0;
+	if (indexed) {
+		// the index has to fit between its offset and the trailer
+		long end = ftell(player->file);
+		uint64_t size = end > 0 ? (uint64_t)end - sizeof(trailer) : 0;
+		if (end < (long)sizeof(trailer) ||
+		    trailer.num_frames > SIZE_MAX / sizeof(uint64_t) ||
+		    trailer.index_offset > size ||
+		    trailer.num_frames >
+			    (size - trailer.index_offset) / sizeof(uint64_t)) {
+			player_destroy(player);
+			return NULL;
+		}
+		player->num_frames = trailer.num_frames;
+		player->index = malloc(sizeof(uint64_t) * trailer.num_frames);
+		if ((player->index == NULL && trailer.num_frames > 0) ||
+		    fseek(player->file, trailer.index_offset, SEEK_SET) != 0 ||
+		    _player_read(player, player->index,
+				 sizeof(uint64_t) * trailer.num_frames)) {
+			player_destroy(player);
+			return NULL;
+		}
+	} else if (_player_scan(player)) {
+		player_destroy(player);
+		return NULL;
+	}
+	return player;
+}
+
+int player_destroy(player_t *player)
+{
+	if (player->file != NULL)
+		fclose(player->file);
+	for (size_t i = 0; i < player->lists_capacity; i++)
+		draw_list_destroy(player->draw_lists[i]);
+	free(player->draw_lists);
+	free(player->sources);
+	free(player->children);
+	free(player->locals);
+	free(player->index);
+	free(player->scratch);
+	free(player->packed);
+	free(player);
+	return 0;
+}
+
+size_t player_length(player_t *player)
+{
+	return player->num_frames;
+}
+
+static bool _player_primitive_valid(const recorder_primitive_t *primitive,
+				    uint64_t buffer_length)
+{
+	// the checks of draw_list_map, children are valid as their edges are
+	// recorded too
+	return primitive->type <= PRIMITIVE_TYPE_CHILD &&
+	       _draw_list_length_valid(primitive->type, primitive->length) &&
+	       primitive->length <= buffer_length &&
+	       primitive->index <= buffer_length - primitive->length;
+}
+
+static int _player_list(player_t *player, draw_list_t *draw_list,
+			uint64_t *source, bool earlier)
+{
+	// earlier is set while reading the full record an earlier keyframe
+	// refers to, which can not refer any further
+	recorder_record_t record;
+	memset(&record, 0, sizeof(record));
+	long offset = ftell(player->file);
+	if (offset < 0 || _player_read(player, &record, sizeof(uint32_t) * 2))
+		return 1;
+	if (record.mode == RECORD_REFERENCE && !earlier)
+		return 0;
+	if (record.mode == RECORD_EARLIER && !earlier) {
+		uint64_t full;
+		if (_player_read(player, &full, sizeof(full)))
+			return 1;
+		if (*source == full)
+			return 0;
+		long next = ftell(player->file);
+		if (next < 0 || fseek(player->file, full, SEEK_SET) != 0 ||
+		    _player_list(player, draw_list, source, true) ||
+		    *source != full)
+			return 1;
+		return fseek(player->file, next, SEEK_SET) != 0;
+	}
+	if (record.mode != RECORD_DELTA ||
+	    _player_read(player, &record.length,
+			 sizeof(record) - sizeof(uint32_t) * 2))
+		return 1;
+	if (record.keep > record.length ||
+	    record.buffer_keep > record.buffer_length ||
+	    record.keep > draw_list->length ||
+	    record.buffer_keep > draw_list->buffer_length ||
+	    record.length - record.keep >
+		    SIZE_MAX / 2 / sizeof(recorder_primitive_t) ||
+	    record.buffer_length - record.buffer_keep >
+		    SIZE_MAX / 2 / sizeof(double))
+		return 1;
+
+	size_t primitives_size =
+		sizeof(recorder_primitive_t) * (record.length - record.keep);
+	size_t buffer_size =
+		sizeof(double) * (record.buffer_length - record.buffer_keep);
+	size_t size = primitives_size + buffer_size;
+	if (_reserve(&player->scratch, &player->scratch_capacity, size))
+		return 1;
+	uint8_t *data = player->scratch;
+	if (record.flags & RECORD_COMPRESSED) {
+		if (_reserve(&player->packed, &player->packed_capacity,
+			     record.payload_size) ||
+		    _player_read(player, player->packed, record.payload_size) ||
+		    _rle_decode(player->packed, record.payload_size, data,
+				size))
+			return 1;
+	} else if (record.payload_size != size ||
+		   _player_read(player, data, size)) {
+		return 1;
+	}
+	// every primitive is checked against the new buffer before the list
+	// changes, the kept ones too as the buffer may have shrunk
+	recorder_primitive_t *primitives = (recorder_primitive_t *)data;
+	double *buffer = (double *)(data + primitives_size);
+	for (size_t i = 0; i < record.length; i++) {
+		recorder_primitive_t kept;
+		recorder_primitive_t *packed = &kept;
+		if (i < record.keep) {
+			_pack_primitive(&kept, &draw_list->primitives[i]);
+		} else {
+			packed = &primitives[i - record.keep];
+			// deltas are xor'ed with the previous contents
+			if ((record.flags & RECORD_XOR) &&
+			    i < draw_list->length) {
+				recorder_primitive_t previous;
+				_pack_primitive(&previous,
+						&draw_list->primitives[i]);
+				_xor((uint8_t *)packed, (uint8_t *)&previous,
+				     sizeof(previous));
+			}
+		}
+		if (!_player_primitive_valid(packed, record.buffer_length))
+			return 1;
+	}
+	if (_draw_list_reserve(draw_list, record.length, record.buffer_length))
+		return 1;
+
+	for (size_t i = record.keep; i < record.length; i++) {
+		recorder_primitive_t *packed = &primitives[i - record.keep];
+		draw_list->primitives[i].type = packed->type;
+		draw_list->primitives[i].index = packed->index;
+		draw_list->primitives[i].length = packed->length;
+	}
+	if ((record.flags & RECORD_XOR) &&
+	    record.buffer_keep < draw_list->buffer_length) {
+		size_t n = draw_list->buffer_length - record.buffer_keep;
+		if (n > record.buffer_length - record.buffer_keep)
+			n = record.buffer_length - record.buffer_keep;
+		_xor((uint8_t *)buffer,
+		     (uint8_t *)(draw_list->buffer + record.buffer_keep),
+		     sizeof(double) * n);
+	}
+	memcpy(draw_list->buffer + record.buffer_keep, buffer, buffer_size);
+	draw_list->length = record.length;
+	draw_list->buffer_length = record.buffer_length;
+	_draw_list_changed(draw_list);
+	*source = record.keep == 0 && record.buffer_keep == 0 &&
+				  !(record.flags & RECORD_XOR) ?
+			  (uint64_t)offset :
+			  UINT64_MAX;
+	return 0;
+}
+
+static int _player_edges(player_t *player, size_t index)
+{
+	// children always come later in the frame than their parents, which
+	// rules out cycles
+	uint64_t num;
+	if (_player_read(player, &num, sizeof(num)))
+		return 1;
+	for (uint64_t i = 0; i < num; i++) {
+		if (i == player->edges_capacity) {
+			size_t capacity = i ? i * 2 : 16;
+			draw_list_t **children =
+				realloc(player->children,
+					sizeof(draw_list_t *) * capacity);
+			if (children == NULL)
+				return 1;
+			player->children = children;
+			double *locals = realloc(
+				player->locals, sizeof(double) * 16 * capacity);
+			if (locals == NULL)
+				return 1;
+			player->locals = locals;
+			player->edges_capacity = capacity;
+		}
+		recorder_edge_t edge;
+		if (_player_read(player, &edge, sizeof(edge)) ||
+		    edge.list <= index || edge.list < player->num_top ||
+		    edge.list >= player->num_lists)
+			return 1;
+		player->children[i] = player->draw_lists[edge.list];
+		memcpy(player->locals + 16 * i, edge.local,
+		       sizeof(edge.local));
+	}
+	return _draw_list_children_load(player->draw_lists[index], num,
+					player->children, player->locals);
+}
+
+static int _player_frame(player_t *player, size_t index)
+{
+	recorder_frame_t frame;
+	if (fseek(player->file, player->index[index] & ~RECORDER_KEYFRAME,
+		  SEEK_SET) != 0 ||
+	    _player_read(player, &frame, sizeof(frame)) ||
+	    frame.magic != RECORDER_FRAME_MAGIC)
+		return 1;
+	if (frame.num_lists > player->lists_capacity) {
+		draw_list_t **draw_lists =
+			realloc(player->draw_lists,
+				sizeof(draw_list_t *) * frame.num_lists);
+		if (draw_lists == NULL)
+			return 1;
+		player->draw_lists = draw_lists;
+		uint64_t *sources =
+			realloc(player->sources,
+				sizeof(uint64_t) * frame.num_lists);
+		if (sources == NULL)
+			return 1;
+		player->sources = sources;
+		while (player->lists_capacity < frame.num_lists) {
+			draw_list_t *draw_list = draw_list_create();
+			if (draw_list == NULL)
+				return 1;
+			sources[player->lists_capacity] = UINT64_MAX;
+			draw_lists[player->lists_capacity++] = draw_list;
+		}
+	}
+	uint64_t num_top;
+	if (_player_read(player, &num_top, sizeof(num_top)) ||
+	    num_top > frame.num_lists)
+		return 1;
+	player->num_top = num_top;
+	player->num_lists = frame.num_lists;
+	memcpy(player->camera, frame.camera, sizeof(player->camera));
+	for (size_t i = 0; i < frame.num_lists; i++) {
+		if (_player_list(player, player->draw_lists[i],
+				 &player->sources[i], false) ||
+		    _player_edges(player, i))
+			return 1;
+	}
+	return 0;
+}
+
+int player_seek(player_t *player, size_t frame)
+{
+	if (frame >= player->num_frames)
+		return 1;
+	// replay from the closest keyframe unless playing forward from the
+	// current frame is shorter
+	size_t start = frame;
+	while (start > 0 && !(player->index[start] & RECORDER_KEYFRAME))
+		start--;
+	if (player->frame != SIZE_MAX && player->frame < frame &&
+	    player->frame >= start)
+		start = player->frame + 1;
+	for (size_t i = start; i <= frame; i++) {
+		if (_player_frame(player, i)) {
+			player->frame = SIZE_MAX;
+			return 1;
+		}
+	}
+	player->frame = frame;
+	return 0;
+}
+
+size_t player_draw_list_count(player_t *player)
+{
+	// the lists passed to recorder_frame, their children are reachable
+	// through them
+	return player->num_top;
+}
+
+draw_list_t *player_draw_list_get(player_t *player, size_t index)
+{
+	if (index >= player->num_top)
+		return NULL;
+	return player->draw_lists[index];
+}
+
+int player_camera_get(player_t *player, camera_t *camera)
+{
+	if (player->frame == SIZE_MAX)
+		return 1;
+	return camera_state_set(camera, player->camera);
+}
@@ -0,0 +1,238 @@
+// clock_gettime is not part of iso c
+#define _POSIX_C_SOURCE 200809L
+
+#include "scheduler.h"
+
+#include <string.h>
+#include <time.h>
+
+// weight of the newest measurement in the render cost estimate
+#define SCHEDULER_COST_WEIGHT 0.5
+
+typedef struct {
+	// list drawn at this position last frame and its cached rasterization
+	draw_list_t *source;
+	cairo_surface_t *cache;
+	int width;
+	int height;
+	// estimated render time in seconds and frames since the last render
+	double cost;
+	size_t age;
+	bool render;
+} scheduler_slot_t;
+
+struct scheduler_s {
+	double budget;
+	size_t num_slots;
+	scheduler_slot_t *slots;
+	size_t *order;
+	size_t skipped;
+};
+
+static double _scheduler_now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+scheduler_t *scheduler_create(double budget)
+{
+	if (budget < 0.0)
+		return NULL;
+	scheduler_t *scheduler = calloc(1, sizeof(scheduler_t));
+	if (scheduler == NULL)
+		return NULL;
+	scheduler->budget = budget;
+	return scheduler;
+}
+
+static void _scheduler_slot_reset(scheduler_slot_t *slot)
+{
+	if (slot->cache != NULL)
+		cairo_surface_destroy(slot->cache);
+	memset(slot, 0, sizeof(scheduler_slot_t));
+}
+
+int scheduler_destroy(scheduler_t *scheduler)
+{
+	for (size_t i = 0; i < scheduler->num_slots; i++)
+		_scheduler_slot_reset(&scheduler->slots[i]);
+	free(scheduler->slots);
+	free(scheduler->order);
+	free(scheduler);
+	return 0;
+}
+
+double scheduler_budget_get(scheduler_t *scheduler)
+{
+	return scheduler->budget;
+}
+
+int scheduler_budget_set(scheduler_t *scheduler, double budget)
+{
+	if (budget < 0.0)
+		return 1;
+	scheduler->budget = budget;
+	return 0;
+}
+
+size_t scheduler_skipped_count(scheduler_t *scheduler)
+{
+	return scheduler->skipped;
+}
+
+static int _scheduler_reserve(scheduler_t *scheduler, size_t num)
+{
+	if (num <= scheduler->num_slots)
+		return 0;
+	size_t *order = realloc(scheduler->order, sizeof(size_t) * num);
+	if (order == NULL)
+		return 1;
+	scheduler->order = order;
+	scheduler_slot_t *slots =
+		realloc(scheduler->slots, sizeof(scheduler_slot_t) * num);
+	if (slots == NULL)
+		return 1;
+	memset(slots + scheduler->num_slots, 0,
+	       sizeof(scheduler_slot_t) * (num - scheduler->num_slots));
+	scheduler->slots = slots;
+	scheduler->num_slots = num;
+	return 0;
+}
+
+static long _scheduler_key(scheduler_t *scheduler, const int *priorities,
+			   size_t i)
+{
+	// skipped lists gain one priority level per frame, so that every
+	// optional list is drawn eventually
+	return (long)priorities[i] - (long)scheduler->slots[i].age;
+}
+
+static int _scheduler_cache(scheduler_slot_t *slot, int width, int height)
+{
+	if (slot->cache != NULL && slot->width == width &&
+	    slot->height == height)
+		return 0;
+	if (slot->cache != NULL)
+		cairo_surface_destroy(slot->cache);
+	slot->cache =
+		cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+	slot->width = width;
+	slot->height = height;
+	if (cairo_surface_status(slot->cache) != CAIRO_STATUS_SUCCESS) {
+		cairo_surface_destroy(slot->cache);
+		slot->cache = NULL;
+		return 1;
+	}
+	return 0;
+}
+
+static int _scheduler_draw(scheduler_slot_t *slot, draw_list_t *draw_list,
+			   camera_t *camera)
+{
+	// redraw the list into its transparent cache
+	cairo_t *cr = cairo_create(slot->cache);
+	cairo_set_operator(cr, CAIRO_OPERATOR_CLEAR);
+	cairo_paint(cr);
+	cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
+	int ret = draw_list_render(draw_list, cr, camera);
+	cairo_destroy(cr);
+	return ret;
+}
+
+int scheduler_render(scheduler_t *scheduler, cairo_t *cr, camera_t *camera,
+		     size_t num, draw_list_t **draw_lists,
+		     const int *priorities, bool *skipped)
+{
+	if (_scheduler_reserve(scheduler, num))
+		return 1;
+	int width, height;
+	camera_viewport_get(camera, &width, &height);
+
+	// plan with the costs measured in earlier frames: required lists are
+	// always drawn, optional ones in priority order while they fit
+	double planned = 0.0;
+	size_t num_optional = 0;
+	for (size_t i = 0; i < num; i++) {
+		scheduler_slot_t *slot = &scheduler->slots[i];
+		if (slot->source != draw_lists[i]) {
+			_scheduler_slot_reset(slot);
+			slot->source = draw_lists[i];
+		}
+		if (priorities[i] <= SCHEDULER_PRIORITY_REQUIRED) {
+			// required lists are drawn directly and need no cache
+			if (slot->cache != NULL) {
+				cairo_surface_destroy(slot->cache);
+				slot->cache = NULL;
+			}
+			slot->render = true;
+			planned += slot->cost;
+			continue;
+		}
+		// insertion sort, the number of lists is small
+		long key = _scheduler_key(scheduler, priorities, i);
+		size_t j = num_optional++;
+		for (; j > 0 && _scheduler_key(scheduler, priorities,
+					       scheduler->order[j - 1]) > key;
+		     j--)
+			scheduler->order[j] = scheduler->order[j - 1];
+		scheduler->order[j] = i;
+	}
+	for (size_t j = 0; j < num_optional; j++) {
+		size_t i = scheduler->order[j];
+		scheduler_slot_t *slot = &scheduler->slots[i];
+		bool overdue = _scheduler_key(scheduler, priorities, i) <= 0;
+		// lists without a cache have nothing to show in their place,
+		// and the most urgent list that waited as many frames as its
+		// priority is drawn even over the budget
+		slot->render =
+			slot->cache == NULL || slot->width != width ||
+			slot->height != height ||
+			planned + slot->cost <= scheduler->budget ||
+			(j == 0 && overdue);
+		if (slot->render)
+			planned += slot->cost;
+	}
+
+	// draw in the given order, which is the stacking order
+	int ret = 0;
+	scheduler->skipped = 0;
+	for (size_t i = 0; i < num; i++) {
+		scheduler_slot_t *slot = &scheduler->slots[i];
+		bool optional = priorities[i] > SCHEDULER_PRIORITY_REQUIRED;
+		if (skipped != NULL)
+			skipped[i] = !slot->render;
+		if (slot->render) {
+			double t = _scheduler_now();
+			if (!optional) {
+				ret |= draw_list_render(draw_lists[i], cr,
+							camera);
+			} else if (_scheduler_cache(slot, width, height)) {
+				ret = 1;
+				continue;
+			} else {
+				ret |= _scheduler_draw(slot, draw_lists[i],
+						       camera);
+			}
+			t = _scheduler_now() - t;
+			slot->cost = slot->cost == 0.0 ?
+					     t :
+					     slot->cost +
+						     SCHEDULER_COST_WEIGHT *
+							     (t - slot->cost);
+			slot->age = 0;
+		} else {
+			slot->age++;
+			scheduler->skipped++;
+		}
+		if (optional) {
+			cairo_save(cr);
+			cairo_identity_matrix(cr);
+			cairo_set_source_surface(cr, slot->cache, 0.0, 0.0);
+			cairo_paint(cr);
+			cairo_restore(cr);
+		}
+	}
+	return ret;
+}
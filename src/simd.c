@@ -0,0 +1,122 @@
+#include "simd.h"
+#include "simd_private.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// the baseline variant is built with the flags of the library, which are
+// sse2 on x86_64 and neon on aarch64
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_BASELINE "sse2"
+#elif defined(__aarch64__)
+#define SIMD_BASELINE "neon"
+#else
+#define SIMD_BASELINE "generic"
+#endif
+
+#define SIMD_SUFFIX baseline
+#define SIMD_TARGET
+#define SIMD_ISA_NAME SIMD_BASELINE
+#include "simd_kernels.h"
+#undef SIMD_SUFFIX
+#undef SIMD_TARGET
+#undef SIMD_ISA_NAME
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define SIMD_X86
+
+#define SIMD_SUFFIX avx2
+#define SIMD_TARGET __attribute__((target("avx2,fma")))
+#define SIMD_ISA_NAME "avx2"
+#include "simd_kernels.h"
+#undef SIMD_SUFFIX
+#undef SIMD_TARGET
+#undef SIMD_ISA_NAME
+
+#define SIMD_SUFFIX avx512
+#define SIMD_TARGET __attribute__((target("avx512f,avx512bw,avx512vl")))
+#define SIMD_ISA_NAME "avx512"
+#include "simd_kernels.h"
+#undef SIMD_SUFFIX
+#undef SIMD_TARGET
+#undef SIMD_ISA_NAME
+#endif
+
+// variants from the least to the most capable
+static const simd_kernels_t *_simd_variants[] = {
+	&_simd_kernels_baseline,
+#ifdef SIMD_X86
+	&_simd_kernels_avx2,
+	&_simd_kernels_avx512,
+#endif
+};
+
+#define SIMD_NUM_VARIANTS \
+	(sizeof(_simd_variants) / sizeof(_simd_variants[0]))
+
+const simd_kernels_t *_simd = &_simd_kernels_baseline;
+
+static bool _simd_cpu_supports(const simd_kernels_t *kernels)
+{
+#ifdef SIMD_X86
+	__builtin_cpu_init();
+	if (kernels == &_simd_kernels_avx2)
+		return __builtin_cpu_supports("avx2") &&
+		       __builtin_cpu_supports("fma");
+	if (kernels == &_simd_kernels_avx512)
+		return __builtin_cpu_supports("avx512f") &&
+		       __builtin_cpu_supports("avx512bw") &&
+		       __builtin_cpu_supports("avx512vl");
+#endif
+	return kernels == &_simd_kernels_baseline;
+}
+
+static const simd_kernels_t *_simd_find(const char *isa)
+{
+	for (size_t i = 0; i < SIMD_NUM_VARIANTS; i++) {
+		if (strcmp(_simd_variants[i]->name, isa) == 0)
+			return _simd_variants[i];
+	}
+	return NULL;
+}
+
+#ifdef __GNUC__
+__attribute__((constructor))
+#endif
+static void _simd_init()
+{
+	for (size_t i = SIMD_NUM_VARIANTS; i > 0; i--) {
+		if (_simd_cpu_supports(_simd_variants[i - 1])) {
+			_simd = _simd_variants[i - 1];
+			break;
+		}
+	}
+	const char *isa = getenv("DRAWING3D_ISA");
+	if (isa != NULL && *isa != '\0' && simd_isa_set(isa))
+		fprintf(stderr,
+			"DRAWING3D_ISA: %s is not supported, using %s\n", isa,
+			_simd->name);
+}
+
+const char *simd_isa_get()
+{
+	return _simd->name;
+}
+
+int simd_isa_set(const char *isa)
+{
+	// not synchronized with rendering, switch between frames
+	const simd_kernels_t *kernels = _simd_find(isa);
+	if (kernels == NULL || !_simd_cpu_supports(kernels))
+		return 1;
+	_simd = kernels;
+	return 0;
+}
+
+bool simd_isa_supported(const char *isa)
+{
+	const simd_kernels_t *kernels = _simd_find(isa);
+	return kernels != NULL && _simd_cpu_supports(kernels);
+}
@@ -0,0 +1,49 @@
+// kernel bodies, included by simd.c once per instruction set with
+// SIMD_SUFFIX and SIMD_TARGET defined; written as plain loops for the
+// compiler to vectorize for the target
+
+#define SIMD_CONCAT2(name, suffix) name##_##suffix
+#define SIMD_CONCAT(name, suffix) SIMD_CONCAT2(name, suffix)
+#define SIMD_NAME(name) SIMD_CONCAT(name, SIMD_SUFFIX)
+
+SIMD_TARGET static void SIMD_NAME(_simd_project)(
+	const double *restrict m, size_t num, const double *restrict points,
+	double *restrict q, double *restrict depth, bool *restrict visible)
+{
+	for (size_t i = 0; i < num; i++) {
+		double x = points[i * 3];
+		double y = points[i * 3 + 1];
+		double z = points[i * 3 + 2];
+		double px = m[0] * x + m[1] * y + m[2] * z + m[3];
+		double py = m[4] * x + m[5] * y + m[6] * z + m[7];
+		double pz = m[8] * x + m[9] * y + m[10] * z + m[11];
+		double pw = m[12] * x + m[13] * y + m[14] * z + m[15];
+		q[i * 2] = px / pw;
+		q[i * 2 + 1] = py / pw;
+		depth[i] = pz;
+		visible[i] = pw > 0.0;
+	}
+}
+
+SIMD_TARGET static void SIMD_NAME(_simd_argb_to_rgb)(
+	size_t num, const uint8_t *restrict src, uint8_t *restrict dst)
+{
+	// ARGB32 pixels are native endian words with alpha in the top byte
+	for (size_t i = 0; i < num; i++) {
+		uint32_t p;
+		memcpy(&p, &src[i * 4], sizeof(p));
+		dst[i * 3] = p >> 16;
+		dst[i * 3 + 1] = p >> 8;
+		dst[i * 3 + 2] = p;
+	}
+}
+
+static const simd_kernels_t SIMD_NAME(_simd_kernels) = {
+	.name = SIMD_ISA_NAME,
+	.project = SIMD_NAME(_simd_project),
+	.argb_to_rgb = SIMD_NAME(_simd_argb_to_rgb),
+};
+
+#undef SIMD_NAME
+#undef SIMD_CONCAT
+#undef SIMD_CONCAT2
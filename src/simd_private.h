@@ -0,0 +1,23 @@
+#ifndef SIMD_PRIVATE_H
+#define SIMD_PRIVATE_H
+
+#include "simd.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// one variant of every vector kernel
+typedef struct {
+	const char *name;
+	// project num xyz points with the 4x4 row-major matrix m, writing
+	// screen xy pairs, view depths and whether each point is in front
+	void (*project)(const double *m, size_t num, const double *points,
+			double *q, double *depth, bool *visible);
+	// convert num cairo ARGB32 pixels to packed RGB24
+	void (*argb_to_rgb)(size_t num, const uint8_t *src, uint8_t *dst);
+} simd_kernels_t;
+
+// selected variant, switched only through simd_isa_set
+extern const simd_kernels_t *_simd;
+
+#endif
@@ -0,0 +1,62 @@
+// clock_gettime is not part of iso c
+#define _POSIX_C_SOURCE 200809L
+
+#include "stats.h"
+#include "stats_private.h"
+
+#include <string.h>
+#include <time.h>
+
+#ifndef DRAWING3D_NO_STATS
+
+_Thread_local frame_stats_t *_stats_frame = NULL;
+
+double _stats_now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+double _stats_lap(int timer, double start)
+{
+	double now = _stats_now();
+	if (timer >= 0 && timer < STATS_TIMER_COUNT)
+		_stats_frame->timers[timer] += now - start;
+	return now;
+}
+
+frame_stats_t *_stats_bind(frame_stats_t *stats)
+{
+	frame_stats_t *previous = _stats_frame;
+	_stats_frame = stats;
+	return previous;
+}
+
+int stats_begin(frame_stats_t *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+	_stats_frame = stats;
+	return 0;
+}
+
+int stats_end()
+{
+	_stats_frame = NULL;
+	return 0;
+}
+
+#else
+
+int stats_begin(frame_stats_t *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+	return 1;
+}
+
+int stats_end()
+{
+	return 1;
+}
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef STATS_PRIVATE_H
+#define STATS_PRIVATE_H
+
+#include <stddef.h>
+
+#include "stats.h"
+
+// instrumentation hooks of the library sources, building with
+// -DDRAWING3D_NO_STATS removes them entirely
+
+#ifndef DRAWING3D_NO_STATS
+
+// frame statistics collected on this thread, NULL when not collecting
+extern _Thread_local frame_stats_t *_stats_frame;
+
+double _stats_now();
+double _stats_lap(int timer, double start);
+// collect into stats on this thread, returns the previous target
+frame_stats_t *_stats_bind(frame_stats_t *stats);
+
+#define STATS_NOW() _stats_now()
+#define STATS_START() (_stats_frame != NULL ? _stats_now() : 0.0)
+// add the time since t to the timer (if it is valid) and restart t
+#define STATS_LAP(timer, t) \
+	((t) = _stats_frame != NULL ? _stats_lap((timer), (t)) : 0.0)
+#define STATS_COUNT(counter, n)                              \
+	do {                                                 \
+		if (_stats_frame != NULL)                    \
+			_stats_frame->counters[counter] += (n); \
+	} while (0)
+
+#else
+
+static inline frame_stats_t *_stats_bind(frame_stats_t *stats)
+{
+	(void)stats;
+	return NULL;
+}
+
+#define STATS_NOW() 0.0
+#define STATS_START() 0.0
+#define STATS_LAP(timer, t) ((void)(timer), (void)(t))
+#define STATS_COUNT(counter, n) ((void)(n))
+
+#endif
+
+#endif
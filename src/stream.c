@@ -0,0 +1,531 @@
+#include "stream.h"
+#include "drawlist_private.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+// every record is an 8 byte header followed by its payload: primitive
+// records carry length doubles, control records length bytes padded to 8
+#define STREAM_OP_LAYER 0x100
+#define STREAM_OP_COMMIT 0x101
+#define STREAM_NAME_MAX 255
+#define STREAM_RECEIVE_SIZE 65536
+#define STREAM_SEND_SIZE 65536
+// a primitive record carries at most STREAM_RECORD_MAX doubles (128 MiB) and
+// the primitives staged until a commit at most STREAM_FRAME_MAX doubles
+// (1 GiB) in STREAM_FRAME_PRIMITIVES records; the server drops clients
+// exceeding them, the client refuses to send such records
+#define STREAM_RECORD_MAX ((size_t)1 << 24)
+#define STREAM_FRAME_MAX ((size_t)1 << 27)
+#define STREAM_FRAME_PRIMITIVES ((size_t)1 << 24)
+
+typedef struct {
+	uint32_t op;
+	uint32_t length;
+} stream_record_t;
+
+typedef struct {
+	char *name;
+	draw_list_t *draw_list;
+} stream_layer_t;
+
+typedef struct {
+	int fd;
+	uint8_t *data;
+	size_t begin;
+	size_t end;
+	// record whose payload is being received straight into the list
+	bool payload;
+	stream_record_t record;
+	size_t received;
+	// primitives are staged per connection until committed to the layer
+	size_t layer;
+	draw_list_t *staging;
+} stream_connection_t;
+
+struct stream_server_s {
+	int fd;
+	char *path;
+	size_t budget;
+	size_t num_layers;
+	stream_layer_t *layers;
+	size_t num_connections;
+	stream_connection_t *connections;
+	struct pollfd *fds;
+};
+
+struct stream_client_s {
+	int fd;
+	bool error;
+	size_t length;
+	uint8_t data[STREAM_SEND_SIZE];
+};
+
+static size_t _stream_pad(size_t size)
+{
+	return (size + 7) & ~(size_t)7;
+}
+
+stream_server_t *stream_server_create(const char *path)
+{
+	struct sockaddr_un addr;
+	if (strlen(path) >= sizeof(addr.sun_path))
+		return NULL;
+	stream_server_t *server = calloc(1, sizeof(stream_server_t));
+	if (server == NULL)
+		return NULL;
+	server->budget = 16 << 20;
+	server->path = malloc(strlen(path) + 1);
+	server->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (server->path == NULL || server->fd < 0) {
+		free(server->path);
+		free(server);
+		return NULL;
+	}
+	strcpy(server->path, path);
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+	// a socket left behind by a previous viewer is replaced
+	unlink(path);
+	if (bind(server->fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+	    listen(server->fd, 16) != 0 ||
+	    fcntl(server->fd, F_SETFL, O_NONBLOCK) != 0) {
+		close(server->fd);
+		free(server->path);
+		free(server);
+		return NULL;
+	}
+	return server;
+}
+
+static void _stream_connection_close(stream_server_t *server, size_t index)
+{
+	// uncommitted primitives of a closed connection are dropped
+	stream_connection_t *connection = &server->connections[index];
+	close(connection->fd);
+	free(connection->data);
+	draw_list_destroy(connection->staging);
+	server->connections[index] =
+		server->connections[--server->num_connections];
+}
+
+int stream_server_destroy(stream_server_t *server)
+{
+	while (server->num_connections > 0)
+		_stream_connection_close(server, 0);
+	for (size_t i = 0; i < server->num_layers; i++) {
+		free(server->layers[i].name);
+		draw_list_destroy(server->layers[i].draw_list);
+	}
+	close(server->fd);
+	unlink(server->path);
+	free(server->path);
+	free(server->layers);
+	free(server->connections);
+	free(server->fds);
+	free(server);
+	return 0;
+}
+
+size_t stream_server_budget_get(stream_server_t *server)
+{
+	return server->budget;
+}
+
+int stream_server_budget_set(stream_server_t *server, size_t budget)
+{
+	if (budget < 1)
+		return 1;
+	server->budget = budget;
+	return 0;
+}
+
+size_t stream_server_layer_count(stream_server_t *server)
+{
+	return server->num_layers;
+}
+
+const char *stream_server_layer_name(stream_server_t *server, size_t index)
+{
+	if (index >= server->num_layers)
+		return NULL;
+	return server->layers[index].name;
+}
+
+draw_list_t *stream_server_layer_get(stream_server_t *server, size_t index)
+{
+	if (index >= server->num_layers)
+		return NULL;
+	return server->layers[index].draw_list;
+}
+
+static size_t _stream_layer_index(stream_server_t *server, const char *name,
+				  size_t length)
+{
+	for (size_t i = 0; i < server->num_layers; i++) {
+		if (strlen(server->layers[i].name) == length &&
+		    memcmp(server->layers[i].name, name, length) == 0)
+			return i;
+	}
+	return SIZE_MAX;
+}
+
+draw_list_t *stream_server_layer_find(stream_server_t *server,
+				      const char *name)
+{
+	size_t index = _stream_layer_index(server, name, strlen(name));
+	if (index == SIZE_MAX)
+		return NULL;
+	return server->layers[index].draw_list;
+}
+
+static size_t _stream_layer(stream_server_t *server, const char *name,
+			    size_t length)
+{
+	size_t index = _stream_layer_index(server, name, length);
+	if (index != SIZE_MAX)
+		return index;
+	stream_layer_t *layers =
+		realloc(server->layers,
+			sizeof(stream_layer_t) * (server->num_layers + 1));
+	if (layers == NULL)
+		return SIZE_MAX;
+	server->layers = layers;
+	stream_layer_t *layer = &layers[server->num_layers];
+	layer->name = malloc(length + 1);
+	layer->draw_list = draw_list_create();
+	if (layer->name == NULL || layer->draw_list == NULL) {
+		free(layer->name);
+		if (layer->draw_list != NULL)
+			draw_list_destroy(layer->draw_list);
+		return SIZE_MAX;
+	}
+	memcpy(layer->name, name, length);
+	layer->name[length] = '\0';
+	return server->num_layers++;
+}
+
+static int _stream_accept(stream_server_t *server)
+{
+	for (;;) {
+		int fd = accept(server->fd, NULL, NULL);
+		if (fd < 0)
+			return errno != EAGAIN && errno != EWOULDBLOCK &&
+			       errno != EINTR && errno != ECONNABORTED;
+		size_t num = server->num_connections + 1;
+		stream_connection_t *connections = realloc(
+			server->connections, sizeof(stream_connection_t) * num);
+		if (connections == NULL) {
+			close(fd);
+			return 1;
+		}
+		server->connections = connections;
+		stream_connection_t *connection =
+			&connections[server->num_connections];
+		memset(connection, 0, sizeof(*connection));
+		connection->fd = fd;
+		connection->layer = SIZE_MAX;
+		connection->data = malloc(STREAM_RECEIVE_SIZE);
+		connection->staging = draw_list_create();
+		if (connection->data == NULL || connection->staging == NULL ||
+		    fcntl(fd, F_SETFL, O_NONBLOCK) != 0) {
+			free(connection->data);
+			if (connection->staging != NULL)
+				draw_list_destroy(connection->staging);
+			close(fd);
+			continue;
+		}
+		server->num_connections++;
+	}
+}
+
+static int _stream_decode(stream_server_t *server,
+			  stream_connection_t *connection)
+{
+	// consume the receive buffer, leaving either a pending payload with an
+	// empty buffer or the start of an incomplete record; 1 on a protocol
+	// error
+	for (;;) {
+		if (connection->payload) {
+			draw_list_t *staging = connection->staging;
+			size_t size =
+				sizeof(double) * connection->record.length;
+			size_t num = connection->end - connection->begin;
+			if (num > size - connection->received)
+				num = size - connection->received;
+			memcpy((uint8_t *)(staging->buffer +
+					   staging->buffer_length) +
+				       connection->received,
+			       connection->data + connection->begin, num);
+			connection->begin += num;
+			connection->received += num;
+			if (connection->received < size)
+				return 0;
+			staging->buffer_length += connection->record.length;
+			if (draw_list_append(staging, connection->record.op,
+					     connection->record.length))
+				return 1;
+			connection->payload = false;
+		}
+
+		size_t available = connection->end - connection->begin;
+		if (available < sizeof(stream_record_t))
+			return 0;
+		stream_record_t record;
+		memcpy(&record, connection->data + connection->begin,
+		       sizeof(record));
+		if (record.op == STREAM_OP_LAYER) {
+			size_t size = _stream_pad(record.length);
+			if (record.length < 1 ||
+			    record.length > STREAM_NAME_MAX)
+				return 1;
+			if (available < sizeof(record) + size)
+				return 0;
+			const char *name =
+				(const char *)connection->data +
+				connection->begin + sizeof(record);
+			connection->layer =
+				_stream_layer(server, name, record.length);
+			if (connection->layer == SIZE_MAX)
+				return 1;
+			draw_list_empty(connection->staging);
+			connection->begin += sizeof(record) + size;
+			continue;
+		}
+		if (connection->layer == SIZE_MAX)
+			return 1;
+		connection->begin += sizeof(record);
+		if (record.op == STREAM_OP_COMMIT) {
+			if (record.length != 0)
+				return 1;
+			draw_list_t *draw_list =
+				server->layers[connection->layer].draw_list;
+			if (_draw_list_swap(draw_list, connection->staging))
+				return 1;
+			draw_list_empty(connection->staging);
+			continue;
+		}
+		// children are local to a process and never arrive over a
+		// stream, vertex counts are checked per type
+		draw_list_t *staging = connection->staging;
+		if (record.op >= PRIMITIVE_TYPE_CHILD ||
+		    !_draw_list_length_valid(record.op, record.length) ||
+		    record.length > STREAM_RECORD_MAX ||
+		    record.length > STREAM_FRAME_MAX - staging->buffer_length ||
+		    staging->length >= STREAM_FRAME_PRIMITIVES)
+			return 1;
+		if (draw_list_buffer_allocate(connection->staging,
+					      record.length))
+			return 1;
+		connection->record = record;
+		connection->received = 0;
+		connection->payload = true;
+	}
+}
+
+static int _stream_receive(stream_server_t *server,
+			   stream_connection_t *connection)
+{
+	// read at most the budget per poll, the rest stays in the socket and
+	// eventually blocks the sender
+	size_t budget = server->budget;
+	while (budget > 0) {
+		if (_stream_decode(server, connection))
+			return 1;
+		uint8_t *data;
+		size_t size;
+		if (connection->payload) {
+			// large payloads skip the receive buffer
+			draw_list_t *staging = connection->staging;
+			data = (uint8_t *)(staging->buffer +
+					   staging->buffer_length) +
+			       connection->received;
+			size = sizeof(double) * connection->record.length -
+			       connection->received;
+		} else {
+			memmove(connection->data,
+				connection->data + connection->begin,
+				connection->end - connection->begin);
+			connection->end -= connection->begin;
+			connection->begin = 0;
+			data = connection->data + connection->end;
+			size = STREAM_RECEIVE_SIZE - connection->end;
+		}
+		if (size > budget)
+			size = budget;
+		ssize_t n = read(connection->fd, data, size);
+		if (n == 0)
+			return 1;
+		if (n < 0)
+			return errno != EAGAIN && errno != EWOULDBLOCK &&
+			       errno != EINTR;
+		if (connection->payload)
+			connection->received += n;
+		else
+			connection->end += n;
+		budget -= n;
+	}
+	return _stream_decode(server, connection);
+}
+
+int stream_server_poll(stream_server_t *server, int timeout)
+{
+	size_t num = server->num_connections;
+	struct pollfd *fds =
+		realloc(server->fds, sizeof(struct pollfd) * (num + 1));
+	if (fds == NULL)
+		return 1;
+	server->fds = fds;
+	fds[0].fd = server->fd;
+	fds[0].events = POLLIN;
+	for (size_t i = 0; i < server->num_connections; i++) {
+		fds[i + 1].fd = server->connections[i].fd;
+		fds[i + 1].events = POLLIN;
+	}
+	if (poll(fds, num + 1, timeout) < 0)
+		return errno != EINTR;
+	// walk backwards as closing moves the last connection into the slot
+	for (size_t i = num; i > 0; i--) {
+		if (fds[i].revents == 0)
+			continue;
+		if (_stream_receive(server, &server->connections[i - 1]))
+			_stream_connection_close(server, i - 1);
+	}
+	if (fds[0].revents & POLLIN)
+		return _stream_accept(server);
+	return 0;
+}
+
+stream_client_t *stream_client_connect(const char *path)
+{
+	struct sockaddr_un addr;
+	if (strlen(path) >= sizeof(addr.sun_path))
+		return NULL;
+	stream_client_t *client = malloc(sizeof(stream_client_t));
+	if (client == NULL)
+		return NULL;
+	client->error = false;
+	client->length = 0;
+	client->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+	if (client->fd < 0 ||
+	    connect(client->fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+		if (client->fd >= 0)
+			close(client->fd);
+		free(client);
+		return NULL;
+	}
+	return client;
+}
+
+static int _stream_client_write(stream_client_t *client, const void *data,
+				size_t size)
+{
+	// blocking writes, a busy viewer stalls the client here
+	const uint8_t *p = data;
+	while (size > 0 && !client->error) {
+		ssize_t n = send(client->fd, p, size, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0) {
+			client->error = true;
+			break;
+		}
+		p += n;
+		size -= n;
+	}
+	return client->error;
+}
+
+int stream_client_flush(stream_client_t *client)
+{
+	int ret = _stream_client_write(client, client->data, client->length);
+	client->length = 0;
+	return ret;
+}
+
+int stream_client_destroy(stream_client_t *client)
+{
+	int ret = stream_client_flush(client);
+	ret |= close(client->fd) != 0;
+	free(client);
+	return ret;
+}
+
+static int _stream_client_record(stream_client_t *client, uint32_t op,
+				 uint32_t length, const void *payload,
+				 size_t size)
+{
+	stream_record_t record = { op, length };
+	size_t padded = _stream_pad(size);
+	if (client->length + sizeof(record) + padded > STREAM_SEND_SIZE &&
+	    stream_client_flush(client))
+		return 1;
+	memcpy(client->data + client->length, &record, sizeof(record));
+	client->length += sizeof(record);
+	if (padded > STREAM_SEND_SIZE - client->length) {
+		// payloads larger than the send buffer are written directly
+		return stream_client_flush(client) ||
+		       _stream_client_write(client, payload, size);
+	}
+	if (size > 0)
+		memcpy(client->data + client->length, payload, size);
+	memset(client->data + client->length + size, 0, padded - size);
+	client->length += padded;
+	return client->error;
+}
+
+int stream_client_layer(stream_client_t *client, const char *name)
+{
+	size_t length = strlen(name);
+	if (length < 1 || length > STREAM_NAME_MAX)
+		return 1;
+	return _stream_client_record(client, STREAM_OP_LAYER, length, name,
+				     length);
+}
+
+int stream_client_primitive(stream_client_t *client, primitive_type_t type,
+			    size_t num, double *data)
+{
+	if (type >= PRIMITIVE_TYPE_CHILD || num > STREAM_RECORD_MAX)
+		return 1;
+	return _stream_client_record(client, type, num, data,
+				     sizeof(double) * num);
+}
+
+int stream_client_draw_list(stream_client_t *client, draw_list_t *draw_list)
+{
+	// children are only references into this process, lists with
+	// children are refused before anything is sent
+	if (draw_list->num_children > 0)
+		return 1;
+	for (size_t i = 0; i < draw_list->length; i++) {
+		primitive_t *primitive = &draw_list->primitives[i];
+		if (stream_client_primitive(client, primitive->type,
+					    primitive->length,
+					    draw_list->buffer +
+						    primitive->index))
+			return 1;
+	}
+	return 0;
+}
+
+int stream_client_commit(stream_client_t *client)
+{
+	if (_stream_client_record(client, STREAM_OP_COMMIT, 0, NULL, 0))
+		return 1;
+	return stream_client_flush(client);
+}
@@ -0,0 +1,755 @@
+#include "drawlist.h"
+#include "camera_private.h"
+#include "drawlist_private.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// points projected at once
+#define SVG_BATCH 256
+// coordinates are written in hundredths of a pixel, paths are clipped to
+// the square within the limit so that they fit the integers
+#define SVG_SCALE 100
+#define SVG_LIMIT 1e7
+// one Sutherland-Hodgman stage per side of the limit square
+#define SVG_CLIP_SIDES 4
+#define SVG_FILE_BUFFER (1 << 20)
+// procedural primitives are written at full detail
+#define SVG_CIRCLE_SEGMENTS_MIN 8
+#define PI 3.14159265358979323846
+
+typedef enum {
+	SVG_PATH_NONE,
+	SVG_PATH_STROKE,
+	SVG_PATH_FILL,
+} svg_path_t;
+
+typedef struct {
+	double color[4];
+	double width;
+} svg_style_t;
+
+// state of a clipping stage, fed one polygon vertex at a time
+typedef struct {
+	double first[2];
+	double previous[2];
+	bool first_inside;
+	bool previous_inside;
+	bool started;
+} svg_clip_t;
+
+// streams the projected primitives as path elements, consecutive strokes
+// of one opaque style share an element while every fill gets its own
+typedef struct {
+	FILE *file;
+	camera_t *camera;
+	int width;
+	int height;
+	svg_style_t style;
+	bool round;
+	// open path element, its cap and the last command written to it
+	svg_path_t path;
+	bool path_round;
+	char command;
+	// pen and start of the subpath in hundredths of a pixel, moves are
+	// written with the first line so that lone points add nothing
+	int64_t x;
+	int64_t y;
+	int64_t start_x;
+	int64_t start_y;
+	bool moved;
+	// current point and start of the subpath in pixels before clipping,
+	// whether the written pen is at the current point and whether a
+	// polygon is being fed through the clipping stages
+	double current_x;
+	double current_y;
+	double first_x;
+	double first_y;
+	bool current;
+	bool pen;
+	bool filling;
+	bool emitted;
+	svg_clip_t clip[SVG_CLIP_SIDES];
+	double q[SVG_BATCH * 2];
+	double depth[SVG_BATCH];
+	bool visible[SVG_BATCH];
+} svg_writer_t;
+
+static int64_t _svg_coordinate(double v)
+{
+	return llround(fmin(fmax(v, -SVG_LIMIT), SVG_LIMIT) * SVG_SCALE);
+}
+
+static void _svg_number(svg_writer_t *svg, int64_t v, bool separate)
+{
+	// shortest form of v / 100, a minus sign doubles as the separator
+	char text[32];
+	char digits[24];
+	int n = 0, k = 0;
+	if (v < 0) {
+		text[n++] = '-';
+		v = -v;
+	} else if (separate) {
+		text[n++] = ' ';
+	}
+	int64_t whole = v / SVG_SCALE;
+	int frac = (int)(v % SVG_SCALE);
+	do {
+		digits[k++] = '0' + whole % 10;
+		whole /= 10;
+	} while (whole > 0);
+	if (k == 1 && digits[0] == '0' && frac != 0)
+		k = 0;
+	while (k > 0)
+		text[n++] = digits[--k];
+	if (frac != 0) {
+		text[n++] = '.';
+		text[n++] = '0' + frac / 10;
+		if (frac % 10 != 0)
+			text[n++] = '0' + frac % 10;
+	}
+	fwrite(text, 1, n, svg->file);
+}
+
+static void _svg_end(svg_writer_t *svg)
+{
+	if (svg->path != SVG_PATH_NONE)
+		fputs("\"/>\n", svg->file);
+	svg->path = SVG_PATH_NONE;
+}
+
+static void _svg_open(svg_writer_t *svg, svg_path_t path)
+{
+	double *c = svg->style.color;
+	int rgb[3];
+	for (int k = 0; k < 3; k++)
+		rgb[k] = (int)lround(fmin(fmax(c[k], 0.0), 1.0) * 255.0);
+	double alpha = fmin(fmax(c[3], 0.0), 1.0);
+	_svg_end(svg);
+	if (path == SVG_PATH_STROKE) {
+		fprintf(svg->file,
+			"<path fill=\"none\" stroke=\"#%02x%02x%02x\" "
+			"stroke-width=\"%g\"",
+			rgb[0], rgb[1], rgb[2], svg->style.width);
+		if (alpha < 1.0)
+			fprintf(svg->file, " stroke-opacity=\"%.3g\"", alpha);
+		if (svg->round)
+			fputs(" stroke-linecap=\"round\"", svg->file);
+	} else {
+		fprintf(svg->file, "<path fill=\"#%02x%02x%02x\"", rgb[0],
+			rgb[1], rgb[2]);
+		if (alpha < 1.0)
+			fprintf(svg->file, " fill-opacity=\"%.3g\"", alpha);
+	}
+	fputs(" d=\"", svg->file);
+	svg->path = path;
+	svg->path_round = svg->round;
+	svg->command = 0;
+	svg->x = 0;
+	svg->y = 0;
+}
+
+static void _svg_style(svg_writer_t *svg, const svg_style_t *style)
+{
+	if (memcmp(&svg->style, style, sizeof(*style)) == 0)
+		return;
+	_svg_end(svg);
+	svg->style = *style;
+}
+
+static void _svg_emit_move(svg_writer_t *svg, double x, double y)
+{
+	svg->start_x = _svg_coordinate(x);
+	svg->start_y = _svg_coordinate(y);
+	svg->moved = true;
+}
+
+static void _svg_emit_line(svg_writer_t *svg, svg_path_t path, double x,
+			   double y)
+{
+	if (svg->path != path || svg->path_round != svg->round)
+		_svg_open(svg, path);
+	if (svg->moved) {
+		fputc('m', svg->file);
+		_svg_number(svg, svg->start_x - svg->x, false);
+		_svg_number(svg, svg->start_y - svg->y, true);
+		svg->x = svg->start_x;
+		svg->y = svg->start_y;
+		svg->command = 'm';
+		svg->moved = false;
+	}
+	int64_t px = _svg_coordinate(x), py = _svg_coordinate(y);
+	// pairs after an l repeat it
+	bool repeat = svg->command == 'l';
+	if (!repeat)
+		fputc('l', svg->file);
+	_svg_number(svg, px - svg->x, repeat);
+	_svg_number(svg, py - svg->y, true);
+	svg->x = px;
+	svg->y = py;
+	svg->command = 'l';
+}
+
+static void _svg_emit_close(svg_writer_t *svg)
+{
+	if (!svg->moved && svg->path != SVG_PATH_NONE) {
+		fputc('z', svg->file);
+		svg->x = svg->start_x;
+		svg->y = svg->start_y;
+		svg->command = 'z';
+	}
+}
+
+static bool _svg_clip_inside(int side, const double *p)
+{
+	// sides x >= -limit, x <= limit, y >= -limit and y <= limit
+	double v = p[side / 2];
+	return side % 2 == 0 ? v >= -SVG_LIMIT : v <= SVG_LIMIT;
+}
+
+static void _svg_clip_cross(int side, const double *a, const double *b,
+			    double *p)
+{
+	// where the edge from a to b crosses the side
+	int k = side / 2;
+	double bound = side % 2 == 0 ? -SVG_LIMIT : SVG_LIMIT;
+	double t = (bound - a[k]) / (b[k] - a[k]);
+	p[k] = bound;
+	p[1 - k] = a[1 - k] + t * (b[1 - k] - a[1 - k]);
+}
+
+static void _svg_clip_vertex(svg_writer_t *svg, int side, const double *p)
+{
+	// streamed Sutherland-Hodgman, each stage passes the vertices of the
+	// polygon clipped to its side on to the next one
+	if (side == SVG_CLIP_SIDES) {
+		if (svg->emitted)
+			_svg_emit_line(svg, SVG_PATH_FILL, p[0], p[1]);
+		else
+			_svg_emit_move(svg, p[0], p[1]);
+		svg->emitted = true;
+		return;
+	}
+	svg_clip_t *clip = &svg->clip[side];
+	bool inside = _svg_clip_inside(side, p);
+	if (!clip->started) {
+		memcpy(clip->first, p, sizeof(clip->first));
+		clip->first_inside = inside;
+		clip->started = true;
+	} else if (inside != clip->previous_inside) {
+		double q[2];
+		_svg_clip_cross(side, clip->previous, p, q);
+		_svg_clip_vertex(svg, side + 1, q);
+	}
+	if (inside)
+		_svg_clip_vertex(svg, side + 1, p);
+	memcpy(clip->previous, p, sizeof(clip->previous));
+	clip->previous_inside = inside;
+}
+
+static void _svg_clip_close(svg_writer_t *svg, int side)
+{
+	// the closing edge of each stage, then the next stage closes
+	if (side == SVG_CLIP_SIDES) {
+		_svg_emit_close(svg);
+		svg->emitted = false;
+		return;
+	}
+	svg_clip_t *clip = &svg->clip[side];
+	if (clip->started && clip->first_inside != clip->previous_inside) {
+		double q[2];
+		_svg_clip_cross(side, clip->previous, clip->first, q);
+		_svg_clip_vertex(svg, side + 1, q);
+	}
+	clip->started = false;
+	_svg_clip_close(svg, side + 1);
+}
+
+static void _svg_stroke(svg_writer_t *svg, double x, double y)
+{
+	// the segment from the current point clipped by Liang-Barsky, the
+	// visible part starts a new subpath when the pen is elsewhere
+	double x0 = svg->current_x, y0 = svg->current_y;
+	double dx = x - x0, dy = y - y0;
+	double p[4] = { -dx, dx, -dy, dy };
+	double q[4] = { x0 + SVG_LIMIT, SVG_LIMIT - x0, y0 + SVG_LIMIT,
+			SVG_LIMIT - y0 };
+	double t0 = 0.0, t1 = 1.0;
+	for (int k = 0; k < 4; k++) {
+		if (p[k] == 0.0) {
+			if (q[k] < 0.0)
+				t1 = -1.0;
+		} else if (p[k] < 0.0) {
+			t0 = fmax(t0, q[k] / p[k]);
+		} else {
+			t1 = fmin(t1, q[k] / p[k]);
+		}
+	}
+	if (t0 > t1) {
+		svg->pen = false;
+		return;
+	}
+	if (t0 > 0.0 || !svg->pen)
+		_svg_emit_move(svg, x0 + t0 * dx, y0 + t0 * dy);
+	_svg_emit_line(svg, SVG_PATH_STROKE, x0 + t1 * dx, y0 + t1 * dy);
+	svg->pen = t1 >= 1.0;
+}
+
+static void _svg_fill_end(svg_writer_t *svg)
+{
+	if (svg->filling)
+		_svg_clip_close(svg, 0);
+	svg->filling = false;
+}
+
+static void _svg_move(svg_writer_t *svg, double x, double y)
+{
+	_svg_fill_end(svg);
+	svg->current_x = svg->first_x = x;
+	svg->current_y = svg->first_y = y;
+	svg->current = true;
+	svg->pen = false;
+}
+
+static void _svg_line(svg_writer_t *svg, svg_path_t path, double x, double y)
+{
+	// like cairo, a line without a current point only moves the pen
+	if (!svg->current) {
+		_svg_move(svg, x, y);
+		return;
+	}
+	if (path == SVG_PATH_FILL) {
+		if (!svg->filling) {
+			double first[2] = { svg->current_x, svg->current_y };
+			svg->filling = true;
+			_svg_clip_vertex(svg, 0, first);
+		}
+		double p[2] = { x, y };
+		_svg_clip_vertex(svg, 0, p);
+	} else {
+		_svg_stroke(svg, x, y);
+	}
+	svg->current_x = x;
+	svg->current_y = y;
+}
+
+static void _svg_close(svg_writer_t *svg)
+{
+	if (svg->filling)
+		_svg_fill_end(svg);
+	else if (svg->current && (svg->current_x != svg->first_x ||
+				  svg->current_y != svg->first_y))
+		_svg_stroke(svg, svg->first_x, svg->first_y);
+	svg->current_x = svg->first_x;
+	svg->current_y = svg->first_y;
+}
+
+static void _svg_paint(svg_writer_t *svg)
+{
+	// the end of a cairo stroke or fill, translucent ones keep their own
+	// element so that overlaps blend as they do on screen, and fills so
+	// that the nonzero rule does not cut overlapping polygons apart
+	_svg_fill_end(svg);
+	svg->current = false;
+	svg->pen = false;
+	svg->moved = false;
+	if (svg->style.color[3] < 1.0 || svg->path == SVG_PATH_FILL)
+		_svg_end(svg);
+}
+
+static size_t _svg_project(svg_writer_t *svg, double *points, size_t num,
+			   size_t start)
+{
+	size_t n = num - start;
+	if (n > SVG_BATCH)
+		n = SVG_BATCH;
+	camera_project_points(svg->camera, n, &points[start * 3], svg->q,
+			      svg->depth, svg->visible);
+	return n;
+}
+
+static bool _svg_outside(svg_writer_t *svg, double x0, double y0, double x1,
+			 double y1)
+{
+	// box fully off the page, allowing for the stroke width
+	double r = svg->style.width / 2.0 + 1.0;
+	return fmax(x0, x1) < -r || fmin(x0, x1) > svg->width + r ||
+	       fmax(y0, y1) < -r || fmin(y0, y1) > svg->height + r;
+}
+
+static void _svg_segments(svg_writer_t *svg, double *points,
+			  size_t num_points)
+{
+	num_points -= num_points % 2;
+	// the batch size is even, so both ends of a line share a batch
+	for (size_t i = 0, n; i < num_points; i += n) {
+		n = _svg_project(svg, points, num_points, i);
+		for (size_t j = 0; j < n; j += 2) {
+			double *p1 = &svg->q[j * 2], *p2 = &svg->q[j * 2 + 2];
+			if (!svg->visible[j] || !svg->visible[j + 1] ||
+			    _svg_outside(svg, p1[0], p1[1], p2[0], p2[1]))
+				continue;
+			_svg_move(svg, p1[0], p1[1]);
+			_svg_line(svg, SVG_PATH_STROKE, p2[0], p2[1]);
+			_svg_paint(svg);
+		}
+	}
+}
+
+static void _svg_points(svg_writer_t *svg, double *points, size_t num_points)
+{
+	// squares below full quality as in _draw_list_render_point
+	double w = svg->style.width;
+	for (size_t i = 0, n; i < num_points; i += n) {
+		n = _svg_project(svg, points, num_points, i);
+		for (size_t j = 0; j < n; j++) {
+			double x = svg->q[j * 2], y = svg->q[j * 2 + 1];
+			if (!svg->visible[j] || _svg_outside(svg, x, y, x, y))
+				continue;
+			if (svg->round) {
+				_svg_move(svg, x, y);
+				_svg_line(svg, SVG_PATH_STROKE, x, y);
+			} else {
+				_svg_move(svg, x - w / 2.0, y - w / 2.0);
+				_svg_line(svg, SVG_PATH_FILL, x + w / 2.0,
+					  y - w / 2.0);
+				_svg_line(svg, SVG_PATH_FILL, x + w / 2.0,
+					  y + w / 2.0);
+				_svg_line(svg, SVG_PATH_FILL, x - w / 2.0,
+					  y + w / 2.0);
+				_svg_close(svg);
+			}
+			_svg_paint(svg);
+		}
+	}
+}
+
+static void _svg_run(svg_writer_t *svg, double *points, size_t num_points)
+{
+	// polyline broken at points that are not visible
+	bool b1 = false, b2;
+	for (size_t i = 0, n; i < num_points; i += n) {
+		n = _svg_project(svg, points, num_points, i);
+		if (i == 0)
+			b1 = svg->visible[0];
+		for (size_t j = 0; j < n; j++) {
+			double *p = &svg->q[j * 2];
+			b2 = svg->visible[j];
+			if (!(b1 && b2)) {
+				_svg_paint(svg);
+				if (b2)
+					_svg_move(svg, p[0], p[1]);
+			} else {
+				_svg_line(svg, SVG_PATH_STROKE, p[0], p[1]);
+			}
+			b1 = b2;
+		}
+	}
+	_svg_paint(svg);
+}
+
+static void _svg_polygon(svg_writer_t *svg, double *points,
+			 size_t num_points)
+{
+	// filled when the last point is visible, otherwise the visible points
+	// are stroked, as in _draw_list_render_polygon
+	double q[2], depth;
+	bool closed;
+	camera_project_points(svg->camera, 1, &points[(num_points - 1) * 3], q,
+			      &depth, &closed);
+	svg_path_t path = closed ? SVG_PATH_FILL : SVG_PATH_STROKE;
+	for (size_t i = 0, n; i < num_points; i += n) {
+		n = _svg_project(svg, points, num_points, i);
+		for (size_t j = 0; j < n; j++) {
+			if (svg->visible[j])
+				_svg_line(svg, path, svg->q[j * 2],
+					  svg->q[j * 2 + 1]);
+		}
+	}
+	if (closed)
+		_svg_close(svg);
+	_svg_paint(svg);
+}
+
+static void _svg_grid(svg_writer_t *svg, double *g)
+{
+	if (!(g[9] >= 1.0 && g[9] <= INT_MAX && g[10] >= 1.0 &&
+	      g[10] <= INT_MAX))
+		return;
+	double *o = g, *u = g + 3, *v = g + 6;
+	size_t nu = (size_t)g[9], nv = (size_t)g[10];
+	for (size_t i = 0; i <= nu + nv + 1; i++) {
+		// lines along v first, then along u
+		bool along_v = i <= nu;
+		double t = along_v ? i / (double)nu : (i - nu - 1) / (double)nv;
+		double *a = along_v ? u : v, *b = along_v ? v : u;
+		double line[6];
+		for (int k = 0; k < 3; k++) {
+			line[k] = o[k] + t * a[k];
+			line[k + 3] = line[k] + b[k];
+		}
+		_svg_segments(svg, line, 2);
+	}
+}
+
+static void _svg_circle(svg_writer_t *svg, double *c)
+{
+	double *n = c + 3, radius = c[6];
+	double len = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+	if (!(c[7] >= 3.0 && c[7] <= INT_MAX) || !(len > 0.0))
+		return;
+	size_t segments = (size_t)c[7];
+	if (segments < SVG_CIRCLE_SEGMENTS_MIN)
+		segments = SVG_CIRCLE_SEGMENTS_MIN;
+	// orthonormal basis of the circle plane, as in _draw_list_render_circle
+	double w[3] = { n[0] / len, n[1] / len, n[2] / len };
+	double a[3] = { 1.0, 0.0, 0.0 };
+	if (fabs(w[0]) > 0.9) {
+		a[0] = 0.0;
+		a[1] = 1.0;
+	}
+	double e1[3] = { a[1] * w[2] - a[2] * w[1], a[2] * w[0] - a[0] * w[2],
+			 a[0] * w[1] - a[1] * w[0] };
+	len = sqrt(e1[0] * e1[0] + e1[1] * e1[1] + e1[2] * e1[2]);
+	for (int k = 0; k < 3; k++)
+		e1[k] /= len;
+	double e2[3] = { w[1] * e1[2] - w[2] * e1[1],
+			 w[2] * e1[0] - w[0] * e1[2],
+			 w[0] * e1[1] - w[1] * e1[0] };
+	// written in batches so that large segment counts need no buffer
+	double points[(SVG_BATCH + 1) * 3];
+	bool b1 = false;
+	for (size_t i = 0; i <= segments; i += SVG_BATCH) {
+		size_t m = segments + 1 - i;
+		if (m > SVG_BATCH)
+			m = SVG_BATCH;
+		for (size_t j = 0; j < m; j++) {
+			double t = 2.0 * PI * ((i + j) % segments) / segments;
+			double ct = cos(t) * radius, st = sin(t) * radius;
+			for (int k = 0; k < 3; k++)
+				points[j * 3 + k] =
+					c[k] + ct * e1[k] + st * e2[k];
+		}
+		camera_project_points(svg->camera, m, points, svg->q,
+				      svg->depth, svg->visible);
+		for (size_t j = 0; j < m; j++) {
+			double *p = &svg->q[j * 2];
+			bool b2 = svg->visible[j];
+			if (i + j == 0)
+				b1 = b2;
+			if (!(b1 && b2)) {
+				_svg_paint(svg);
+				if (b2)
+					_svg_move(svg, p[0], p[1]);
+			} else {
+				_svg_line(svg, SVG_PATH_STROKE, p[0], p[1]);
+			}
+			b1 = b2;
+		}
+	}
+	_svg_paint(svg);
+}
+
+static void _svg_box(svg_writer_t *svg, double *b)
+{
+	// corner i takes x, y and z from the max corner for bits 0, 1 and 2
+	static const int edges[12][2] = {
+		{ 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 }, { 0, 2 }, { 1, 3 },
+		{ 4, 6 }, { 5, 7 }, { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 },
+	};
+	double lines[12 * 6];
+	for (int i = 0; i < 12; i++) {
+		for (int j = 0; j < 2; j++) {
+			int corner = edges[i][j];
+			for (int k = 0; k < 3; k++)
+				lines[i * 6 + j * 3 + k] =
+					b[k + ((corner >> k) & 1) * 3];
+		}
+	}
+	_svg_segments(svg, lines, 24);
+}
+
+static void _svg_clear(svg_writer_t *svg)
+{
+	_svg_move(svg, 0.0, 0.0);
+	_svg_line(svg, SVG_PATH_FILL, svg->width, 0.0);
+	_svg_line(svg, SVG_PATH_FILL, svg->width, svg->height);
+	_svg_line(svg, SVG_PATH_FILL, 0.0, svg->height);
+	_svg_close(svg);
+	_svg_paint(svg);
+}
+
+static void _svg_style_read(draw_list_t *draw_list, size_t i,
+			    svg_style_t *style)
+{
+	double *s = draw_list->buffer + draw_list->primitives[i].index;
+	memcpy(style->color, s, sizeof(style->color));
+	style->width = s[4];
+}
+
+static size_t _svg_sorted(svg_writer_t *svg, draw_list_t *draw_list,
+			  size_t start, uint64_t segment,
+			  const svg_style_t *base)
+{
+	// the polygons of one clear segment back to front, as in
+	// _draw_list_render_sorted
+	svg_style_t restore = svg->style, style;
+	size_t j = start;
+	for (; j < draw_list->sort_length; j++) {
+		if (draw_list->sort_keys[j] >> 32 != segment)
+			break;
+		sort_item_t *item =
+			&draw_list->sort_items[draw_list->sort_order[j]];
+		if (item->style == SIZE_MAX) {
+			_svg_style(svg, base);
+		} else {
+			_svg_style_read(draw_list, item->style, &style);
+			_svg_style(svg, &style);
+		}
+		svg_path_t path =
+			item->closed ? SVG_PATH_FILL : SVG_PATH_STROKE;
+		double *q = draw_list->sort_points + item->points;
+		for (size_t k = 0; k < item->num_points; k++)
+			_svg_line(svg, path, q[k * 2], q[k * 2 + 1]);
+		if (item->closed)
+			_svg_close(svg);
+		_svg_paint(svg);
+	}
+	_svg_style(svg, &restore);
+	return j;
+}
+
+static void _svg_contents(svg_writer_t *svg, draw_list_t *draw_list,
+			  const double *world, const double *view)
+{
+	svg_style_t base = svg->style, style;
+	bool round = svg->round;
+	svg->round = draw_list->quality == RENDER_QUALITY_FULL;
+	bool window = _draw_list_time_window_active(draw_list);
+	if (draw_list->depth_sort)
+		_draw_list_depth_sort(draw_list, svg->camera);
+	size_t sorted = 0;
+	uint64_t segment = 0;
+	bool segment_drawn = false;
+	for (size_t i = 0; i < draw_list->length; i++) {
+		primitive_t *primitive = &draw_list->primitives[i];
+		primitive_t trimmed;
+		if (window) {
+			if (!_draw_list_time_visible(draw_list, i)) {
+				if (primitive->type == PRIMITIVE_TYPE_CLEAR) {
+					segment++;
+					segment_drawn = false;
+				}
+				continue;
+			}
+			primitive = _draw_list_time_trim(draw_list, i,
+							 &trimmed);
+			if (primitive == NULL)
+				continue;
+		}
+		double *p = draw_list->buffer + primitive->index;
+		size_t num_points = primitive->length / 3;
+		switch (primitive->type) {
+		case PRIMITIVE_TYPE_LINE:
+			_svg_segments(svg, p, num_points);
+			break;
+		case PRIMITIVE_TYPE_POINT:
+			_svg_points(svg, p, num_points);
+			break;
+		case PRIMITIVE_TYPE_POLYGON:
+			if (!draw_list->depth_sort) {
+				if (num_points > 0)
+					_svg_polygon(svg, p, num_points);
+			} else if (!segment_drawn) {
+				sorted = _svg_sorted(svg, draw_list, sorted,
+						     segment, &base);
+				segment_drawn = true;
+			}
+			break;
+		case PRIMITIVE_TYPE_POLYLINE:
+		case PRIMITIVE_TYPE_POLYLINES:
+			// nan points project as not visible, which breaks
+			// the path
+			_svg_run(svg, p, num_points);
+			break;
+		case PRIMITIVE_TYPE_GRID:
+			_svg_grid(svg, p);
+			break;
+		case PRIMITIVE_TYPE_CIRCLE:
+			_svg_circle(svg, p);
+			break;
+		case PRIMITIVE_TYPE_BOX:
+			_svg_box(svg, p);
+			break;
+		case PRIMITIVE_TYPE_STYLE:
+			_svg_style_read(draw_list, i, &style);
+			_svg_style(svg, &style);
+			break;
+		case PRIMITIVE_TYPE_CLEAR:
+			_svg_clear(svg);
+			segment++;
+			segment_drawn = false;
+			break;
+		case PRIMITIVE_TYPE_CHILD: {
+			double index = p[0];
+			if (!(index >= 0.0 &&
+			      index < (double)draw_list->num_children))
+				break;
+			draw_list_child_t *edge =
+				&draw_list->children[(size_t)index];
+			double child_world[16], m[16], projection[16];
+			_camera_matmul4(world, edge->local, child_world);
+			_camera_matmul4(view, child_world, m);
+			camera_projection_get(svg->camera, projection);
+			camera_projection_set(svg->camera, m);
+			svg_style_t saved = svg->style;
+			_svg_contents(svg, edge->draw_list, child_world, view);
+			_svg_style(svg, &saved);
+			camera_projection_set(svg->camera, projection);
+			break;
+		}
+		default:
+			break;
+		}
+	}
+	svg->round = round;
+}
+
+int draw_list_saves_svg(size_t num, draw_list_t **draw_list,
+			const char *filename, camera_t *camera)
+{
+	// written straight from the primitives in constant memory, cairo's
+	// svg surface keeps every stroke until it is finished
+	static const double identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0,
+					     0, 0, 1, 0, 0, 0, 0, 1 };
+	FILE *file = fopen(filename, "w");
+	if (file == NULL)
+		return 1;
+	setvbuf(file, NULL, _IOFBF, SVG_FILE_BUFFER);
+	svg_writer_t svg = {
+		.file = file,
+		.camera = camera,
+		// cairo defaults to opaque black lines two pixels wide
+		.style = { { 0.0, 0.0, 0.0, 1.0 }, 2.0 },
+	};
+	camera_update(camera);
+	camera_viewport_get(camera, &svg.width, &svg.height);
+	fprintf(file,
+		"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+		"<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%d\" "
+		"height=\"%d\" viewBox=\"0 0 %d %d\">\n",
+		svg.width, svg.height, svg.width, svg.height);
+	double view[16];
+	camera_projection_get(camera, view);
+	for (size_t i = 0; i < num; i++)
+		_svg_contents(&svg, draw_list[i], identity, view);
+	_svg_end(&svg);
+	fputs("</svg>\n", file);
+	bool failed = ferror(file) != 0;
+	if (fclose(file) != 0 || failed)
+		return 1;
+	return 0;
+}
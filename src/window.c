@@ -1,9 +1,30 @@
 #include "window.h"
+#include "drawlist_private.h"
+#include "simd_private.h"
+#include "stats_private.h"
 
 #include <math.h>
+#include <stdatomic.h>
+
+// snapshot of the draw lists of one frame in threaded mode
+typedef struct {
+	size_t length;
+	size_t capacity;
+	draw_list_t **draw_lists;
+	// object pose of window_render_at entries
+	bool *posed;
+	double (*poses)[6];
+	double camera[CAMERA_STATE_LEN];
+	size_t decimation;
+	bool clear;
+} window_frame_t;
 
 struct window_s {
 	char *title;
+	window_backend_t backend;
+	// surface size of the headless backend
+	int width;
+	int height;
 	SDL_Window *window;
 	SDL_Renderer *renderer;
 	SDL_Surface *sdl_surface;
@@ -16,77 +37,284 @@ struct window_s {
 	double mouse_sensitivity;
 	double wheel_sensitivity;
 	double key_sensitivity;
+	// progressive rendering: decimated direct rasterized frames while the
+	// camera is moved by the user, refined over the following frames once
+	// it has been still for the delay
+	bool progressive;
+	double progressive_delay;
+	size_t progressive_step;
+	Uint32 motion_ticks;
+	size_t decimation;
+	// threaded mode: the application thread snapshots frames into a single
+	// producer single consumer ring, the render thread draws and presents
+	// the newest one and counts the others as dropped
+	SDL_Thread *thread;
+	SDL_sem *thread_wake;
+	atomic_int thread_state;
+	atomic_bool thread_stop;
+	atomic_bool thread_resize;
+	camera_t *thread_camera;
+	size_t num_frames;
+	window_frame_t *frames;
+	atomic_size_t frame_head;
+	atomic_size_t frame_tail;
+	window_frame_t *frame;
+	bool frame_dropped;
+	atomic_size_t frames_presented;
+	atomic_size_t frames_dropped;
+	atomic_int surface_width;
+	atomic_int surface_height;
+	// per frame statistics, collected by the thread that renders
+	frame_stats_t stats_current;
+	double stats_frame_start;
+	uint64_t stats_length;
+	frame_stats_t stats[STATS_FRAMES];
+	SDL_mutex *stats_lock;
 };
 
+static int _window_renderer_create(window_t *window)
+{
+	// the headless backend draws into its surface only
+	if (window->backend == WINDOW_BACKEND_HEADLESS)
+		return 0;
+	window->renderer = SDL_CreateRenderer(
+		window->window, -1,
+		SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+	if (window->renderer == NULL) {
+		fprintf(stderr, "SDL_CreateRenderer Error: %s\n",
+			SDL_GetError());
+		return 1;
+	}
+	return 0;
+}
+
 window_t *window_create(int width, int height, char *title)
 {
-	window_t *window = malloc(sizeof(window_t));
+	const char *headless = getenv("DRAWING3D_HEADLESS");
+	window_backend_t backend = WINDOW_BACKEND_SDL;
+	if (headless != NULL && *headless != '\0' && strcmp(headless, "0"))
+		backend = WINDOW_BACKEND_HEADLESS;
+	return window_create2(width, height, title, backend);
+}
+
+window_t *window_create2(int width, int height, char *title,
+			 window_backend_t backend)
+{
+	if (width < 1 || height < 1)
+		return NULL;
+	window_t *window = calloc(1, sizeof(window_t));
+	if (window == NULL) {
+		fprintf(stderr, "Memory allocation error\n");
+		return NULL;
+	}
+	window->backend = backend;
+	window->width = width;
+	window->height = height;
 	window->title = malloc(strlen(title) + 1);
 	if (window->title == NULL) {
 		fprintf(stderr, "Memory allocation error\n");
-		exit(1);
+		goto error;
 	}
 	strcpy(window->title, title);
-	window->window =
-		SDL_CreateWindow(window->title, SDL_WINDOWPOS_CENTERED,
-				 SDL_WINDOWPOS_CENTERED, width, height,
-				 SDL_WINDOW_RESIZABLE | SDL_WINDOW_SHOWN);
-	if (window->window == NULL) {
-		fprintf(stderr, "SDL_CreateWindow Error: %s\n", SDL_GetError());
-		exit(1);
+	if (backend == WINDOW_BACKEND_SDL) {
+		window->window = SDL_CreateWindow(
+			window->title, SDL_WINDOWPOS_CENTERED,
+			SDL_WINDOWPOS_CENTERED, width, height,
+			SDL_WINDOW_RESIZABLE | SDL_WINDOW_SHOWN);
+		if (window->window == NULL) {
+			fprintf(stderr, "SDL_CreateWindow Error: %s\n",
+				SDL_GetError());
+			goto error;
+		}
 	}
-	window->renderer = SDL_CreateRenderer(
-		window->window, -1,
-		SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
-	if (window->renderer == NULL) {
-		fprintf(stderr, "SDL_CreateRenderer Error: %s\n",
-			SDL_GetError());
-		exit(1);
+	if (_window_renderer_create(window))
+		goto error;
+	window->thread = NULL;
+	window->thread_camera = NULL;
+	memset(&window->stats_current, 0, sizeof(frame_stats_t));
+	window->stats_frame_start = STATS_NOW();
+	window->stats_length = 0;
+	window->stats_lock = SDL_CreateMutex();
+	if (window->stats_lock == NULL) {
+		fprintf(stderr, "SDL_CreateMutex Error: %s\n", SDL_GetError());
+		goto error;
 	}
 	window->camera = camera_create();
 	if (window->camera == NULL) {
 		fprintf(stderr, "camera_create Error\n");
-		exit(1);
+		goto error;
 	}
 	if (window_surface_init(window)) {
 		fprintf(stderr, "window_surface_init Error\n");
-		exit(1);
+		goto error;
 	}
 	window->keys = calloc(sizeof(bool), SDL_NUM_SCANCODES);
+	if (window->keys == NULL) {
+		fprintf(stderr, "Memory allocation error\n");
+		goto error;
+	}
 	window->mouse_left = false;
 	window->controllable = true;
 	window->mouse_sensitivity = 0.01;
 	window->wheel_sensitivity = 0.7;
 	window->key_sensitivity = 0.1;
+	window->progressive = true;
+	window->progressive_delay = 0.2;
+	window->progressive_step = 4;
+	window->motion_ticks = 0;
+	window->decimation = 1;
 	return window;
+error:
+	window_destroy(window);
+	return NULL;
 }
 
 int window_destroy(window_t *window)
 {
+	if (window->thread != NULL)
+		window_thread_stop(window);
 	free(window->title);
 	window_surface_destroy(window);
-	SDL_DestroyRenderer(window->renderer);
-	SDL_DestroyWindow(window->window);
+	if (window->renderer != NULL)
+		SDL_DestroyRenderer(window->renderer);
+	if (window->window != NULL)
+		SDL_DestroyWindow(window->window);
 	camera_destroy(window->camera);
+	SDL_DestroyMutex(window->stats_lock);
 	free(window->keys);
 	free(window);
 	return 0;
 }
 
+static int _window_frame_begin(window_t *window)
+{
+	if (window->frame != NULL || window->frame_dropped)
+		return 0;
+	size_t head =
+		atomic_load_explicit(&window->frame_head, memory_order_relaxed);
+	size_t tail =
+		atomic_load_explicit(&window->frame_tail, memory_order_acquire);
+	if (head - tail == window->num_frames) {
+		// the render thread is behind, the whole frame is dropped
+		window->frame_dropped = true;
+		return 0;
+	}
+	window->frame = &window->frames[head % window->num_frames];
+	window->frame->length = 0;
+	window->frame->clear = false;
+	return 0;
+}
+
+static int _window_frame_add(window_t *window, draw_list_t *draw_list,
+			     double *pose)
+{
+	_window_frame_begin(window);
+	window_frame_t *frame = window->frame;
+	if (frame == NULL)
+		return 0;
+	if (frame->length == frame->capacity) {
+		size_t capacity = frame->capacity ? frame->capacity * 2 : 4;
+		draw_list_t **draw_lists = realloc(
+			frame->draw_lists, sizeof(draw_list_t *) * capacity);
+		if (draw_lists == NULL)
+			return 1;
+		frame->draw_lists = draw_lists;
+		bool *posed = realloc(frame->posed, sizeof(bool) * capacity);
+		if (posed == NULL)
+			return 1;
+		frame->posed = posed;
+		double(*poses)[6] =
+			realloc(frame->poses, sizeof(double[6]) * capacity);
+		if (poses == NULL)
+			return 1;
+		frame->poses = poses;
+		for (size_t i = frame->capacity; i < capacity; i++)
+			draw_lists[i] = NULL;
+		frame->capacity = capacity;
+	}
+	size_t i = frame->length;
+	if (frame->draw_lists[i] == NULL) {
+		frame->draw_lists[i] = draw_list_create();
+		if (frame->draw_lists[i] == NULL)
+			return 1;
+	}
+	if (_draw_list_copy(frame->draw_lists[i], draw_list))
+		return 1;
+	frame->posed[i] = pose != NULL;
+	if (pose != NULL)
+		memcpy(frame->poses[i], pose, sizeof(double[6]));
+	frame->length++;
+	return 0;
+}
+
+static int _window_frame_end(window_t *window)
+{
+	_window_frame_begin(window);
+	if (window->frame_dropped) {
+		atomic_fetch_add(&window->frames_dropped, 1);
+		window->frame_dropped = false;
+		return 0;
+	}
+	camera_state_get(window->camera, window->frame->camera);
+	window->frame->decimation = window->decimation;
+	window->frame = NULL;
+	atomic_fetch_add_explicit(&window->frame_head, 1,
+				  memory_order_release);
+	SDL_SemPost(window->thread_wake);
+
+	// pick up the surface size after resizes handled by the render thread
+	int width, height;
+	camera_viewport_get(window->camera, &width, &height);
+	int surface_width = atomic_load(&window->surface_width);
+	int surface_height = atomic_load(&window->surface_height);
+	if (width != surface_width || height != surface_height)
+		camera_viewport_set(window->camera, surface_width,
+				    surface_height);
+	return 0;
+}
+
+static void _window_frame_free(window_frame_t *frame)
+{
+	for (size_t i = 0; i < frame->capacity; i++) {
+		if (frame->draw_lists[i] != NULL)
+			draw_list_destroy(frame->draw_lists[i]);
+	}
+	free(frame->draw_lists);
+	free(frame->posed);
+	free(frame->poses);
+}
+
 int window_clear(window_t *window)
 {
+	if (window->thread != NULL) {
+		_window_frame_begin(window);
+		if (window->frame != NULL)
+			window->frame->clear = true;
+		return 0;
+	}
+	frame_stats_t *previous = _stats_bind(&window->stats_current);
+	double t = STATS_START();
 	memset(window->sdl_surface->pixels, 0,
 	       window->sdl_surface->h * window->sdl_surface->pitch);
-	SDL_SetRenderDrawColor(window->renderer, 0, 0, 0, 0);
-	SDL_RenderClear(window->renderer);
+	if (window->renderer != NULL) {
+		SDL_SetRenderDrawColor(window->renderer, 0, 0, 0, 0);
+		SDL_RenderClear(window->renderer);
+	}
+	STATS_LAP(STATS_TIMER_WINDOW_CLEAR, t);
+	_stats_bind(previous);
 	return 0;
 }
 
 int window_surface_init(window_t *window)
 {
 	int win_w, win_h, rdr_w, rdr_h;
-	SDL_GetWindowSize(window->window, &win_w, &win_h);
-	SDL_GetRendererOutputSize(window->renderer, &rdr_w, &rdr_h);
+	if (window->backend == WINDOW_BACKEND_HEADLESS) {
+		rdr_w = window->width;
+		rdr_h = window->height;
+	} else {
+		SDL_GetWindowSize(window->window, &win_w, &win_h);
+		SDL_GetRendererOutputSize(window->renderer, &rdr_w, &rdr_h);
+	}
 	window->sdl_surface = SDL_CreateRGBSurface(
 		0, rdr_w, rdr_h, 32, 0x00ff0000, 0x0000ff00, 0x000000ff, 0);
 	if (window->sdl_surface == NULL) {
@@ -110,65 +338,370 @@ int window_surface_init(window_t *window)
 		return 1;
 	}
 
+	// in threaded mode this runs on the render thread
+	if (window->thread_camera != NULL) {
+		camera_viewport_set(window->thread_camera, rdr_w, rdr_h);
+		atomic_store(&window->surface_width, rdr_w);
+		atomic_store(&window->surface_height, rdr_h);
+		return 0;
+	}
 	camera_viewport_set(window->camera, rdr_w, rdr_h);
 	return 0;
 }
 
 int window_surface_destroy(window_t *window)
 {
-	cairo_destroy(window->cr);
-	cairo_surface_destroy(window->cr_surface);
+	if (window->cr != NULL)
+		cairo_destroy(window->cr);
+	if (window->cr_surface != NULL)
+		cairo_surface_destroy(window->cr_surface);
 	SDL_FreeSurface(window->sdl_surface);
+	window->cr = NULL;
+	window->cr_surface = NULL;
+	window->sdl_surface = NULL;
 	return 0;
 }
 
+static int _window_draw(window_t *window, draw_list_t *draw_list,
+			camera_t *camera, size_t decimation)
+{
+	if (decimation == 1)
+		return draw_list_render(draw_list, window->cr, camera);
+	// interactive frame, the settings of the list are restored afterwards
+	render_quality_t quality = draw_list->quality;
+	size_t step = draw_list->decimation;
+	draw_list->quality = RENDER_QUALITY_DIRECT;
+	draw_list->decimation = step * decimation;
+	int ret = draw_list_render(draw_list, window->cr, camera);
+	draw_list->quality = quality;
+	draw_list->decimation = step;
+	return ret;
+}
+
 int window_render(window_t *window, draw_list_t *draw_list)
 {
-	return draw_list_render(draw_list, window->cr, window->camera);
+	if (window->thread != NULL)
+		return _window_frame_add(window, draw_list, NULL);
+	frame_stats_t *previous = _stats_bind(&window->stats_current);
+	int ret = _window_draw(window, draw_list, window->camera,
+			       window->decimation);
+	_stats_bind(previous);
+	return ret;
 }
 
 int window_render_at(window_t *window, draw_list_t *draw_list, double x,
 		     double y, double z, double rx, double ry, double rz)
 {
+	if (window->thread != NULL) {
+		double pose[6] = { x, y, z, rx, ry, rz };
+		return _window_frame_add(window, draw_list, pose);
+	}
 	// write object position and rotation and restore later
 	double tx, ty, tz, trx, try, trz;
 	camera_object_position_get(window->camera, &tx, &ty, &tz);
 	camera_object_rotation_get(window->camera, &trx, &try, &trz);
 	camera_object_position_set(window->camera, x, y, z);
 	camera_object_rotation_set(window->camera, rx, ry, rz);
-	int ret = draw_list_render(draw_list, window->cr, window->camera);
+	frame_stats_t *previous = _stats_bind(&window->stats_current);
+	int ret = _window_draw(window, draw_list, window->camera,
+			       window->decimation);
+	_stats_bind(previous);
 	camera_object_position_set(window->camera, tx, ty, tz);
 	camera_object_rotation_set(window->camera, trx, try, trz);
 	return ret;
 }
 
-int window_render_end(window_t *window)
+int window_render_scheduled(window_t *window, scheduler_t *scheduler,
+			    size_t num, draw_list_t **draw_lists,
+			    const int *priorities, bool *skipped)
 {
+	// the caches are drawn into on the calling thread only
+	if (window->thread != NULL)
+		return 1;
+	frame_stats_t *previous = _stats_bind(&window->stats_current);
+	int ret = scheduler_render(scheduler, window->cr, window->camera, num,
+				   draw_lists, priorities, skipped);
+	_stats_bind(previous);
+	return ret;
+}
+
+static void _window_stats_push(window_t *window)
+{
+#ifndef DRAWING3D_NO_STATS
+	frame_stats_t *stats = &window->stats_current;
+	double now = _stats_now();
+	stats->timers[STATS_TIMER_FRAME] = now - window->stats_frame_start;
+	window->stats_frame_start = now;
+	SDL_LockMutex(window->stats_lock);
+	stats->frame = window->stats_length;
+	window->stats[window->stats_length % STATS_FRAMES] = *stats;
+	window->stats_length++;
+	SDL_UnlockMutex(window->stats_lock);
+	memset(stats, 0, sizeof(frame_stats_t));
+#else
+	(void)window;
+#endif
+}
+
+static int _window_present(window_t *window)
+{
+	if (window->backend == WINDOW_BACKEND_HEADLESS) {
+		// nothing to present, the frame stays in the surface
+		_window_stats_push(window);
+		return 0;
+	}
+	frame_stats_t *previous = _stats_bind(&window->stats_current);
+	double t = STATS_START();
 	SDL_Texture *texture = SDL_CreateTextureFromSurface(
 		window->renderer, window->sdl_surface);
 	if (texture == NULL) {
 		fprintf(stderr, "SDL_CreateTextureFromSurface Error: %s\n",
 			SDL_GetError());
+		_stats_bind(previous);
 		return 1;
 	}
+	STATS_LAP(STATS_TIMER_UPLOAD, t);
 	SDL_RenderCopy(window->renderer, texture, NULL, NULL);
 	SDL_RenderPresent(window->renderer);
 	SDL_DestroyTexture(texture);
+	STATS_LAP(STATS_TIMER_PRESENT, t);
+	_stats_bind(previous);
+	_window_stats_push(window);
+	return 0;
+}
+
+static void _window_progressive_update(window_t *window)
+{
+	// halve the decimation every frame once the camera is still
+	if (window->decimation > 1 &&
+	    SDL_GetTicks() - window->motion_ticks >=
+		    window->progressive_delay * 1000.0)
+		window->decimation /= 2;
+}
+
+int window_render_end(window_t *window)
+{
+	int ret;
+	if (window->thread != NULL)
+		ret = _window_frame_end(window);
+	else
+		ret = _window_present(window);
+	_window_progressive_update(window);
+	return ret;
+}
+
+static void _window_thread_render(window_t *window, window_frame_t *frame)
+{
+	camera_t *camera = window->thread_camera;
+	camera_state_set(camera, frame->camera);
+	camera_viewport_set(camera, window->sdl_surface->w,
+			    window->sdl_surface->h);
+	double x, y, z, rx, ry, rz;
+	camera_object_position_get(camera, &x, &y, &z);
+	camera_object_rotation_get(camera, &rx, &ry, &rz);
+	frame_stats_t *previous = _stats_bind(&window->stats_current);
+	double t = STATS_START();
+	if (frame->clear)
+		memset(window->sdl_surface->pixels, 0,
+		       window->sdl_surface->h * window->sdl_surface->pitch);
+	STATS_LAP(STATS_TIMER_WINDOW_CLEAR, t);
+	for (size_t i = 0; i < frame->length; i++) {
+		if (frame->posed[i]) {
+			double *pose = frame->poses[i];
+			camera_object_position_set(camera, pose[0], pose[1],
+						   pose[2]);
+			camera_object_rotation_set(camera, pose[3], pose[4],
+						   pose[5]);
+		}
+		_window_draw(window, frame->draw_lists[i], camera,
+			     frame->decimation);
+		if (frame->posed[i]) {
+			camera_object_position_set(camera, x, y, z);
+			camera_object_rotation_set(camera, rx, ry, rz);
+		}
+	}
+	_stats_bind(previous);
+}
+
+static int _window_thread(void *data)
+{
+	// sdl renderers are used from the thread that created them
+	window_t *window = data;
+	if (_window_renderer_create(window) || window_surface_init(window)) {
+		atomic_store(&window->thread_state, -1);
+		return 1;
+	}
+	atomic_store(&window->thread_state, 1);
+	while (!atomic_load(&window->thread_stop)) {
+		SDL_SemWaitTimeout(window->thread_wake, 100);
+		if (atomic_exchange(&window->thread_resize, false)) {
+			window_surface_destroy(window);
+			window_surface_init(window);
+		}
+		size_t head = atomic_load_explicit(&window->frame_head,
+						   memory_order_acquire);
+		size_t tail = atomic_load_explicit(&window->frame_tail,
+						   memory_order_relaxed);
+		if (head == tail)
+			continue;
+		// only the newest frame is presented
+		atomic_fetch_add(&window->frames_dropped, head - tail - 1);
+		size_t index = (head - 1) % window->num_frames;
+		_window_thread_render(window, &window->frames[index]);
+		_window_present(window);
+		atomic_store_explicit(&window->frame_tail, head,
+				      memory_order_release);
+		atomic_fetch_add(&window->frames_presented, 1);
+	}
+	window_surface_destroy(window);
+	SDL_DestroyRenderer(window->renderer);
+	window->renderer = NULL;
 	return 0;
 }
 
+static void _window_thread_free(window_t *window)
+{
+	for (size_t i = 0; i < window->num_frames; i++)
+		_window_frame_free(&window->frames[i]);
+	free(window->frames);
+	window->frames = NULL;
+	window->num_frames = 0;
+	if (window->thread_camera != NULL)
+		camera_destroy(window->thread_camera);
+	window->thread_camera = NULL;
+	if (window->thread_wake != NULL)
+		SDL_DestroySemaphore(window->thread_wake);
+	window->thread_wake = NULL;
+}
+
+int window_thread_start(window_t *window, size_t queue_length)
+{
+	if (window->thread != NULL || queue_length < 1)
+		return 1;
+	window->frames = calloc(queue_length, sizeof(window_frame_t));
+	window->num_frames = queue_length;
+	window->thread_camera = camera_create();
+	window->thread_wake = SDL_CreateSemaphore(0);
+	if (window->frames == NULL || window->thread_camera == NULL ||
+	    window->thread_wake == NULL) {
+		_window_thread_free(window);
+		return 1;
+	}
+	window->frame = NULL;
+	window->frame_dropped = false;
+	atomic_store(&window->thread_state, 0);
+	atomic_store(&window->thread_stop, false);
+	atomic_store(&window->thread_resize, false);
+	atomic_store(&window->frame_head, 0);
+	atomic_store(&window->frame_tail, 0);
+	atomic_store(&window->frames_presented, 0);
+	atomic_store(&window->frames_dropped, 0);
+
+	// hand the surface and the renderer over to the render thread
+	window_surface_destroy(window);
+	SDL_DestroyRenderer(window->renderer);
+	window->renderer = NULL;
+	window->thread =
+		SDL_CreateThread(_window_thread, "drawing3d render", window);
+	while (window->thread != NULL &&
+	       atomic_load(&window->thread_state) == 0)
+		SDL_Delay(1);
+	if (window->thread == NULL || atomic_load(&window->thread_state) < 0) {
+		if (window->thread != NULL)
+			SDL_WaitThread(window->thread, NULL);
+		window->thread = NULL;
+		_window_thread_free(window);
+		if (window->renderer == NULL)
+			_window_renderer_create(window);
+		window_surface_init(window);
+		return 1;
+	}
+	camera_viewport_set(window->camera,
+			    atomic_load(&window->surface_width),
+			    atomic_load(&window->surface_height));
+	return 0;
+}
+
+int window_thread_stop(window_t *window)
+{
+	if (window->thread == NULL)
+		return 1;
+	atomic_store(&window->thread_stop, true);
+	SDL_SemPost(window->thread_wake);
+	SDL_WaitThread(window->thread, NULL);
+	window->thread = NULL;
+	_window_thread_free(window);
+	if (_window_renderer_create(window) || window_surface_init(window))
+		return 1;
+	return 0;
+}
+
+window_backend_t window_backend_get(window_t *window)
+{
+	return window->backend;
+}
+
+bool window_threaded_get(window_t *window)
+{
+	return window->thread != NULL;
+}
+
+size_t window_frames_presented_get(window_t *window)
+{
+	return atomic_load(&window->frames_presented);
+}
+
+size_t window_frames_dropped_get(window_t *window)
+{
+	return atomic_load(&window->frames_dropped);
+}
+
+size_t window_stats_get(window_t *window, size_t num, frame_stats_t *stats)
+{
+	// copies the newest num frames, oldest first
+	SDL_LockMutex(window->stats_lock);
+	size_t available = window->stats_length < STATS_FRAMES ?
+				   window->stats_length :
+				   STATS_FRAMES;
+	if (num > available)
+		num = available;
+	for (size_t i = 0; i < num; i++)
+		stats[i] = window->stats[(window->stats_length - num + i) %
+					 STATS_FRAMES];
+	SDL_UnlockMutex(window->stats_lock);
+	return num;
+}
+
 int window_handle_events(window_t *window, event_list_t *event_list)
 {
 	SDL_Event event;
 	int num_events = event_list_length(event_list);
-	bool focus = SDL_GetWindowFlags(window->window) &
-		     SDL_WINDOW_INPUT_FOCUS;
+	double before[CAMERA_STATE_LEN], after[CAMERA_STATE_LEN];
+	camera_state_get(window->camera, before);
+	bool focus = window->backend == WINDOW_BACKEND_HEADLESS ||
+		     (SDL_GetWindowFlags(window->window) &
+		      SDL_WINDOW_INPUT_FOCUS);
 	for (int i = 0; i < num_events; i++) {
 		event_list_get(event_list, i, &event);
 		switch (event.type) {
 		case SDL_WINDOWEVENT:
 			switch (event.window.event) {
 			case SDL_WINDOWEVENT_RESIZED:
+				if (window->backend ==
+				    WINDOW_BACKEND_HEADLESS) {
+					// scripted resizes carry the size
+					if (event.window.data1 < 1 ||
+					    event.window.data2 < 1)
+						break;
+					window->width = event.window.data1;
+					window->height = event.window.data2;
+				}
+				if (window->thread != NULL) {
+					atomic_store(&window->thread_resize,
+						     true);
+					SDL_SemPost(window->thread_wake);
+					break;
+				}
 				window_surface_destroy(window);
 				window_surface_init(window);
 				break;
@@ -223,6 +756,11 @@ int window_handle_events(window_t *window, event_list_t *event_list)
 			window_do_key_action(window, key->action);
 		}
 	}
+	camera_state_get(window->camera, after);
+	if (window->progressive && memcmp(before, after, sizeof(before))) {
+		window->motion_ticks = SDL_GetTicks();
+		window->decimation = window->progressive_step;
+	}
 	return 0;
 }
 
@@ -282,6 +820,11 @@ camera_t *window_camera_get(window_t *window)
 
 int window_save_png(window_t *window, char *filename)
 {
+	// the renderer belongs to the render thread in threaded mode
+	if (window->thread != NULL)
+		return 1;
+	if (window->backend == WINDOW_BACKEND_HEADLESS)
+		return SDL_SaveBMP(window->sdl_surface, filename) != 0;
 	SDL_Surface *surface = SDL_CreateRGBSurface(0, window->sdl_surface->w,
 						    window->sdl_surface->h, 32,
 						    0x00ff0000, 0x0000ff00,
@@ -295,8 +838,19 @@ int window_save_png(window_t *window, char *filename)
 
 int window_save(window_t *window, uint8_t *buffer, size_t size)
 {
+	if (window->thread != NULL)
+		return 1;
 	if ((int)size < window->sdl_surface->w * window->sdl_surface->h * 3)
 		return 1;
+	if (window->backend == WINDOW_BACKEND_HEADLESS) {
+		SDL_Surface *surface = window->sdl_surface;
+		for (int y = 0; y < surface->h; y++)
+			_simd->argb_to_rgb(surface->w,
+					   (uint8_t *)surface->pixels +
+						   y * surface->pitch,
+					   buffer + y * surface->w * 3);
+		return 0;
+	}
 	SDL_Surface *surface = SDL_CreateRGBSurfaceFrom(
 		buffer, window->sdl_surface->w, window->sdl_surface->h, 24,
 		window->sdl_surface->w * 3, 0x00ff0000, 0x0000ff00, 0x000000ff,
@@ -349,4 +903,48 @@ int window_key_sensitivity_set(window_t *window, double sensitivity)
 {
 	window->key_sensitivity = sensitivity;
 	return 0;
-}
\ No newline at end of file
+}
+
+bool window_progressive_get(window_t *window)
+{
+	return window->progressive;
+}
+
+int window_progressive_set(window_t *window, bool progressive)
+{
+	window->progressive = progressive;
+	if (!progressive)
+		window->decimation = 1;
+	return 0;
+}
+
+double window_progressive_delay_get(window_t *window)
+{
+	return window->progressive_delay;
+}
+
+int window_progressive_delay_set(window_t *window, double delay)
+{
+	if (delay < 0.0)
+		return 1;
+	window->progressive_delay = delay;
+	return 0;
+}
+
+size_t window_progressive_step_get(window_t *window)
+{
+	return window->progressive_step;
+}
+
+int window_progressive_step_set(window_t *window, size_t step)
+{
+	if (step < 1)
+		return 1;
+	window->progressive_step = step;
+	return 0;
+}
+
+size_t window_decimation_get(window_t *window)
+{
+	return window->decimation;
+}